@@ -0,0 +1,49 @@
+/*
+** bench_checksum: throughput of each checksum kernel, in GB/s, for payload
+** sizes from an empty echo request up to the largest one (-s 65507).
+*/
+#include "ft_ping.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const size_t g_sizes[] = {0, 8, 64, 576, 1500, 9000, 16384, 65507 + 8};
+
+static volatile uint32_t g_sink;
+
+int main(void) {
+    const size_t max = g_sizes[sizeof(g_sizes) / sizeof(g_sizes[0]) - 1];
+    unsigned char *buf = malloc(max + 1);
+
+    if (!buf)
+        return 1;
+    for (size_t i = 0; i < max + 1; i++)
+        buf[i] = (unsigned char) (i * 131 + 7);
+
+    for (size_t s = 0; s < sizeof(g_sizes) / sizeof(g_sizes[0]); s++) {
+        const size_t len = g_sizes[s];
+        /* ~64 MB of data per measurement, at least 1000 calls */
+        size_t iters = len ? (64u << 20) / len : 1000000;
+        if (iters < 1000)
+            iters = 1000;
+
+        for (int k = 0; g_csum_impls[k].name; k++) {
+            const t_csum_impl *impl = &g_csum_impls[k];
+            if (!impl->supported())
+                continue;
+
+            /* Odd start address: the receive path never gets aligned data */
+            uint64_t t0 = now_ns();
+            for (size_t i = 0; i < iters; i++)
+                g_sink = impl->fn(buf + 1, len, 0);
+            uint64_t t1 = now_ns();
+
+            const double ns = (double) (t1 - t0) / (double) iters;
+            printf("bench=checksum impl=%s size=%zu ns=%.1f gbps=%.2f\n",
+                   impl->name, len, ns, ns > 0 ? (double) len / ns : 0.0);
+        }
+    }
+
+    free(buf);
+    return 0;
+}
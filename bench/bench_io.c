@@ -0,0 +1,99 @@
+/*
+** bench_io: the epoll loop against the io_uring loop, flooding 127.0.0.1.
+** Reports the syscalls made per packet (sent or read) and the CPU time per
+** packet, user + system, from getrusage(). The last run reads the replies
+** from the packet ring (--rx-ring) and needs a raw socket. Needs an ICMP
+** socket (cap_net_raw or ping_group_range), skipped otherwise; uring is
+** skipped where the kernel cannot run it.
+*/
+#include "ft_ping.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+
+#define BENCH_PROBES 200000
+
+static int have_icmp_socket(void) {
+    int fd = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+    if (fd < 0)
+        fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_ICMP);
+    if (fd < 0)
+        return 0;
+    close(fd);
+    return 1;
+}
+
+static uint64_t cpu_ns(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t) (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * NS_PER_SEC
+           + (uint64_t) (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000;
+}
+
+static void run(const char *name, int io, int sock, int id, int quiet_fd) {
+    stats_thread_init();
+    g_stats = (t_stats){.hist = g_stats.hist};
+    g_targets[0].stats = (t_target_stats){.min = INT64_MAX};
+    g_targets[0].seq = 0;   /* -c counts the probes each target was sent */
+    g_rx_reads = 0;
+    g_io_syscalls = 0;
+    should_stop = 0;
+
+    const uint64_t c0 = cpu_ns();
+    const uint64_t t0 = now_ns();
+    if (io == IO_URING) {
+        if (uring_loop(sock, id, quiet_fd) < 0) {
+            printf("bench=io loop=%s skipped (no io_uring)\n", name);
+            return;
+        }
+    } else {
+        ping_loop(sock, id, quiet_fd);
+    }
+    const double s = (double) (now_ns() - t0) / NS_PER_SEC;
+    const double cpu = (double) (cpu_ns() - c0);
+    const long packets = g_stats.tx + g_rx_reads;
+
+    printf("bench=io loop=%s probes=%ld replies=%ld pps=%.0f syscalls/pkt=%.3f cpu_ns/pkt=%.0f\n",
+           name, g_stats.tx, g_stats.rx, s > 0 ? (double) g_stats.tx / s : 0.0,
+           packets ? (double) g_io_syscalls / (double) packets : 0.0,
+           packets ? cpu / (double) packets : 0.0);
+}
+
+int main(void) {
+    if (!have_icmp_socket()) {
+        printf("bench=io skipped (no ICMP socket)\n");
+        return 0;
+    }
+
+    t_target *t = target_add("127.0.0.1");
+    t->addr.sin_family = AF_INET;
+    t->addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    flags.quiet = 1;
+    flags.flood = 1;
+    flags.ttl = 64;
+    flags.payload_size = 56;
+    flags.wait_ms = 10000;
+    flags.interval_ns = 0;
+    flags.count = BENCH_PROBES;
+
+    int id;
+    const int sock = transport_socket(0, &id);
+    /* Stands in for the signalfd: never readable */
+    const int quiet_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    run("epoll", IO_EPOLL, sock, id, quiet_fd);
+    run("uring", IO_URING, sock, id, quiet_fd);
+    /* Last: the ring leaves the socket filtering everything out */
+    if (g_transport == &g_transport_raw) {
+        flags.rx_ring = 1;
+        run("epoll+ring", IO_EPOLL, sock, id, quiet_fd);
+    }
+
+    close(quiet_fd);
+    close(sock);
+    return 0;
+}
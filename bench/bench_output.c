@@ -0,0 +1,69 @@
+/*
+** bench_output: reply lines per second, the old way (vfprintf() of the
+** table format plus "\n" to an unbuffered stream, as stderr was) against
+** ping_msg() through the buffered sink. Both write to /dev/null, so this
+** is formatting plus syscalls, not terminal speed.
+*/
+#include "ft_ping.h"
+#include "ft_messages.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BENCH_LINES 500000
+
+static void old_msg(FILE *stream, const char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    flockfile(stream);
+    vfprintf(stream, fmt, args);
+    fprintf(stream, "\n");
+    funlockfile(stream);
+    va_end(args);
+}
+
+static void report(const char *path, uint64_t ns, long writes) {
+    const double s = (double) ns / NS_PER_SEC;
+    printf("bench=output path=%s lines=%d lines_per_s=%.0f writes_per_line=%.4f\n",
+           path, BENCH_LINES, s > 0 ? BENCH_LINES / s : 0.0, (double) writes / BENCH_LINES);
+}
+
+int main(void) {
+    const int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    FILE *null_unbuf = fdopen(dup(null_fd), "w");
+    if (null_fd < 0 || !null_unbuf)
+        return 1;
+    setvbuf(null_unbuf, NULL, _IONBF, 0);
+
+    /* 1. Old path: printf parsing, two write() per line */
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < BENCH_LINES; i++)
+        old_msg(null_unbuf, "%ld bytes from %s: icmp_seq=%d ttl=%d time=%.3f ms%s",
+                64L, "192.168.100.200", i & 0xFFFF, 64, (double) (i % 100000) / 1000.0, "");
+    report("vfprintf", now_ns() - t0, 2L * BENCH_LINES);
+
+    /* 2. Sink: compiled template, one write() per 64 KiB */
+    fflush(stdout);
+    const int saved = dup(STDOUT_FILENO);
+    dup2(null_fd, STDOUT_FILENO);
+    char from[INET_ADDRSTRLEN];
+    struct in_addr a = {.s_addr = htonl(0xC0A864C8)};
+    g_io_syscalls = 0;
+    t0 = now_ns();
+    for (int i = 0; i < BENCH_LINES; i++) {
+        fmt_ipv4(from, a);
+        ping_msg(MSG_PING_REPLY, 64L, from, i & 0xFFFF, 64, (double) (i % 100000) / 1000.0, "");
+    }
+    out_flush();
+    const uint64_t ns = now_ns() - t0;
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    report("sink", ns, g_io_syscalls);
+
+    fclose(null_unbuf);
+    close(null_fd);
+    return 0;
+}
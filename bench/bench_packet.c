@@ -0,0 +1,75 @@
+/*
+** bench_packet: per-send cost of building an echo request, by payload size.
+**
+** "template" is the current send path (pkt_stamp() on a prebuilt template,
+** incremental checksum). "rebuild" is the previous one: clear the packet,
+** rewrite the pattern and checksum everything. The template column should
+** stay flat as -s grows.
+*/
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "libft/libft.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <arpa/inet.h>
+
+static const int g_sizes[] = {0, 56, 512, 1472, 8192, 65507};
+
+static volatile uint16_t g_sink;
+
+static void rebuild(char *packet, size_t pack_size, uint16_t seq, int pid) {
+    ft_memset(packet, 0, pack_size);
+
+    struct my_icmp_header *icmp = (struct my_icmp_header *) packet;
+    icmp->type = ICMP_ECHO;
+    icmp->id = htons(pid & 0xFFFF);
+    icmp->sequence = htons(seq);
+
+    size_t offset = sizeof(struct my_icmp_header);
+    if (pack_size >= offset + sizeof(uint64_t)) {
+        uint64_t sent_ns = now_ns();
+        ft_memcpy(packet + offset, &sent_ns, sizeof(sent_ns));
+    }
+    for (size_t i = offset + sizeof(uint64_t); i < pack_size; i++)
+        packet[i] = (char) ('!' + (i % 56));
+
+    icmp->checksum = checksum(packet, (int) pack_size);
+}
+
+int main(void) {
+    const int iters = 20000;
+    const int pid = 4242;
+    char *packet = malloc(sizeof(struct my_icmp_header) + 65507);
+    uint8_t hdr[PKT_HDR_LEN];
+
+    if (!packet)
+        return 1;
+
+    for (size_t k = 0; k < sizeof(g_sizes) / sizeof(g_sizes[0]); k++) {
+        t_pkt_template tpl;
+
+        flags.payload_size = g_sizes[k];
+        pkt_template_init(&tpl, pid);
+        const size_t pack_size = sizeof(struct my_icmp_header) + (size_t) flags.payload_size;
+
+        uint64_t t0 = now_ns();
+        for (int i = 0; i < iters; i++) {
+            pkt_stamp(&tpl, hdr, (uint16_t) i);
+            g_sink = ((struct my_icmp_header *) hdr)->checksum;
+        }
+        uint64_t t1 = now_ns();
+        for (int i = 0; i < iters; i++) {
+            rebuild(packet, pack_size, (uint16_t) i, pid);
+            g_sink = ((struct my_icmp_header *) packet)->checksum;
+        }
+        uint64_t t2 = now_ns();
+
+        printf("bench=packet_build size=%d template_ns=%.1f rebuild_ns=%.1f\n",
+               g_sizes[k], (double) (t1 - t0) / iters, (double) (t2 - t1) / iters);
+        pkt_template_free(&tpl);
+    }
+
+    free(packet);
+    return 0;
+}
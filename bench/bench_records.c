@@ -0,0 +1,107 @@
+/*
+** bench_records: reply events per second and bytes per event for the text
+** line, a JSON Lines object and a binary record, all written to /dev/null
+** through the sink. Then the reader's side: the RTT pulled back out of each
+** text line with sscanf() (what a scraper does) against reading it from an
+** array of records.
+*/
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "ft_records.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#define BENCH_EVENTS 500000
+
+static t_probe g_probe = {.target = 0};
+
+static void reply(int i, struct in_addr from) {
+    const int64_t rtt = 100000 + i % 100000;
+
+    g_probe.seq = (uint16_t) i;
+    if (flags.format == FORMAT_TEXT) {
+        char from_str[INET_ADDRSTRLEN];
+        fmt_ipv4(from_str, from);
+        ping_msg(MSG_PING_REPLY, 64L, from_str, g_probe.seq, 64, (double) rtt / NS_PER_MS, "");
+    } else {
+        record_reply(&g_probe, REPLY_OK, from, 64, 64, rtt, -1, now_ns());
+    }
+}
+
+static void produce(const char *name, int format, int out_fd) {
+    const struct in_addr from = {.s_addr = htonl(0xC0A864C8)};
+    const int saved = dup(STDOUT_FILENO);
+    const off_t start = lseek(out_fd, 0, SEEK_CUR);
+
+    fflush(stdout);
+    dup2(out_fd, STDOUT_FILENO);
+    flags.format = format;
+    const uint64_t t0 = now_ns();
+    for (int i = 0; i < BENCH_EVENTS; i++)
+        reply(i, from);
+    out_flush();
+    const double s = (double) (now_ns() - t0) / NS_PER_SEC;
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    const off_t bytes = lseek(out_fd, 0, SEEK_CUR) - start;
+    printf("bench=records format=%s events=%d events_per_s=%.0f bytes_per_event=%.1f\n",
+           name, BENCH_EVENTS, s > 0 ? BENCH_EVENTS / s : 0.0, (double) bytes / BENCH_EVENTS);
+}
+
+int main(void) {
+    t_target *t = target_add("192.168.100.200");
+    t->addr.sin_family = AF_INET;
+    t->addr.sin_addr.s_addr = htonl(0xC0A864C8);
+
+    /* A file, so the offset tells how much each format wrote */
+    char path[] = "/tmp/bench_records.XXXXXX";
+    const int fd = mkstemp(path);
+    if (fd < 0)
+        return 1;
+    unlink(path);
+
+    produce("text", FORMAT_TEXT, fd);
+    produce("jsonl", FORMAT_JSONL, fd);
+    produce("binary", FORMAT_BINARY, fd);
+
+    /* Reader: RTTs back out of text lines, then out of records */
+    char line[128];
+    double sum = 0;
+    uint64_t parse_ns = 0;
+    for (int i = 0; i < BENCH_EVENTS; i++) {
+        double ms;
+        int seq;
+        snprintf(line, sizeof(line), "64 bytes from 192.168.100.200: icmp_seq=%d ttl=64 time=%.3f ms",
+                 i & 0xFFFF, (double) (100000 + i % 100000) / NS_PER_MS);
+        const uint64_t p0 = now_ns();
+        if (sscanf(line, "%*d bytes from %*[^:]: icmp_seq=%d ttl=%*d time=%lf ms", &seq, &ms) == 2)
+            sum += ms;
+        parse_ns += now_ns() - p0;   /* the parse only, not building the line */
+    }
+    const double text_ns = (double) parse_ns / BENCH_EVENTS;
+
+    t_record *recs = calloc(BENCH_EVENTS, sizeof(*recs));
+    if (!recs)
+        return 1;
+    for (int i = 0; i < BENCH_EVENTS; i++)
+        recs[i] = (t_record){.type = REC_REPLY, .version = REC_VERSION,
+                             .probe = {.rtt_ns = 100000 + i % 100000}};
+    const uint64_t t0 = now_ns();
+    int64_t rsum = 0;
+    for (int i = 0; i < BENCH_EVENTS; i++)
+        if (recs[i].type == REC_REPLY)
+            rsum += recs[i].probe.rtt_ns;
+    const double bin_ns = (double) (now_ns() - t0) / BENCH_EVENTS;
+
+    printf("bench=records reader=sscanf ns_per_event=%.1f (sum %.0f)\n", text_ns, sum);
+    printf("bench=records reader=binary ns_per_event=%.2f (sum %lld)\n", bin_ns, (long long) rsum);
+
+    free(recs);
+    close(fd);
+    return 0;
+}
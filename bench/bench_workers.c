@@ -0,0 +1,61 @@
+/*
+** bench_workers: probes/second of the worker pool against loopback targets
+** (127.1.x.y) for 1, 2, 4 ... threads up to the number of CPUs. Sweeps are
+** back to back (-i 0) so the rate is bounded by the probers, not the timer.
+** Needs an ICMP socket (cap_net_raw or ping_group_range), skipped otherwise.
+*/
+#include "ft_ping.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#define BENCH_TARGETS 8192
+#define BENCH_SWEEPS  20
+
+static int have_icmp_socket(void) {
+    int fd = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+    if (fd < 0)
+        fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_ICMP);
+    if (fd < 0)
+        return 0;
+    close(fd);
+    return 1;
+}
+
+int main(void) {
+    if (!have_icmp_socket()) {
+        printf("bench=workers skipped (no ICMP socket)\n");
+        return 0;
+    }
+
+    for (int i = 0; i < BENCH_TARGETS; i++) {
+        t_target *t = target_add("bench");
+        t->addr.sin_family = AF_INET;
+        t->addr.sin_addr.s_addr = htonl(0x7F010000u + (uint32_t) i + 1);
+    }
+
+    flags.quiet = 1;
+    flags.ttl = 64;
+    flags.payload_size = 56;
+    flags.wait_ms = 10000;
+    flags.interval_ns = 0;
+    flags.count = BENCH_SWEEPS;
+
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int n = 1; n <= (cpus > 1 ? cpus : 1) && n <= WORKERS_MAX; n *= 2) {
+        stats_thread_init();
+        g_stats = (t_stats){.hist = g_stats.hist};
+        flags.threads = n;
+
+        workers_init();
+        const uint64_t t0 = now_ns();
+        workers_run(-1);
+        const double s = (double) (now_ns() - t0) / NS_PER_SEC;
+
+        printf("bench=workers threads=%d targets=%d probes=%ld replies=%ld pps=%.0f\n",
+               n, BENCH_TARGETS, g_stats.tx, g_stats.rx, s > 0 ? (double) g_stats.tx / s : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+#!/bin/bash
+# End-to-end benchmarks: ft_ping itself against 127.0.0.1 and against a
+# veth pair into a network namespace, the latter also with delay and loss
+# from tc netem. No network is needed.
+#
+# One line per scenario, key=value like the microbenchmarks:
+#   bench=suite scenario=<name> probes= replies= pps= cpu_ns_per_probe=
+#               rtt_avg_ms= overhead_avg_ms= [jitter_p99_ms=]
+#   bench=suite scenario=output_<fmt> events= events_per_s= bytes_per_event=
+# pps is probes sent per second of wall time. cpu_ns_per_probe is the user
+# and system time of the process over the probes sent. overhead_avg_ms is
+# the RTT measured in userspace minus the kernel-timestamped one
+# (--kernel-ts).
+#
+# Usage: bench/suite.sh [BIN] [--compare BASELINE]
+#   BENCH_PROBES=N   probes per scenario (default 20000)
+#   BENCH_TOLERANCE  allowed regression against the baseline, percent (10)
+# With --compare, a scenario whose pps (or events_per_s) drops or whose
+# cpu_ns_per_probe rises by more than the tolerance is reported as a
+# regression and the exit status is 1. Save a run's output as the baseline.
+#
+# The namespace scenarios need root (ip netns), netem needs sch_netem;
+# what cannot run is reported as skipped.
+
+set -u
+
+ROOT_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BIN="$ROOT_DIR/ft_ping"
+BASELINE=""
+while (( $# > 0 )); do
+  case "$1" in
+    --compare) BASELINE="$2"; shift 2 ;;
+    *) BIN="$1"; shift ;;
+  esac
+done
+
+PROBES=${BENCH_PROBES:-20000}
+TOLERANCE=${BENCH_TOLERANCE:-10}
+NS=ftping_bench
+VETH_HOST=ftpb0
+VETH_NS=ftpb1
+HOST_IP=10.254.0.1
+NS_IP=10.254.0.2
+OUT=$(mktemp)
+RESULTS=$(mktemp)
+
+cleanup() {
+  ip link del "$VETH_HOST" 2>/dev/null
+  ip netns del "$NS" 2>/dev/null
+  rm -f "$OUT" "$RESULTS"
+}
+trap cleanup EXIT
+
+if [[ ! -x "$BIN" ]]; then
+  echo "bench=suite skipped (no binary: $BIN)"
+  exit 0
+fi
+
+emit() {
+  echo "$@" | tee -a "$RESULTS"
+}
+
+# Runs ft_ping with the rest of the arguments and prints the scenario line
+# from its summary and the CPU time bash measured
+probe() {
+  local name="$1"; shift
+  local TIMEFORMAT='%3R %3U %3S'
+  local times
+
+  times=$( { time "$BIN" -q --kernel-ts "$@" > "$OUT" 2>&1 ; } 2>&1 )
+  if ! grep -q "packets transmitted" "$OUT"; then
+    echo "bench=suite scenario=$name skipped ($(head -n 1 "$OUT"))"
+    return
+  fi
+  emit "$(awk -v name="$name" -v times="$times" '
+    BEGIN { split(times, t, " "); wall = t[1]; cpu = t[2] + t[3] }
+    / packets transmitted/ { tx = $1; rx = $4 }
+    /^rtt min/ { split($4, r, "/"); rtt = r[2] }
+    /^userspace overhead/ { split($5, o, "/"); ovh = o[2] }
+    /^pacing:/ { split($NF == "ms" ? $(NF - 1) : $NF, j, "/"); jit = j[4] }
+    END {
+      line = sprintf("bench=suite scenario=%s probes=%d replies=%d pps=%.0f cpu_ns_per_probe=%.0f rtt_avg_ms=%s overhead_avg_ms=%s",
+                     name, tx, rx, wall > 0 ? tx / wall : 0, tx > 0 ? cpu * 1e9 / tx : 0,
+                     rtt == "" ? "-" : rtt, ovh == "" ? "-" : ovh)
+      if (jit != "")
+        line = line " jitter_p99_ms=" jit
+      print line
+    }' "$OUT")"
+}
+
+# Structured output written to a file: records per second and their size
+output() {
+  local fmt="$1"
+  local TIMEFORMAT='%3R'
+  local wall
+
+  wall=$( { time "$BIN" -f -c "$PROBES" --format "$fmt" 127.0.0.1 > "$OUT" 2>/dev/null ; } 2>&1 )
+  local bytes
+  bytes=$(wc -c < "$OUT")
+  emit "$(awk -v fmt="$fmt" -v wall="$wall" -v bytes="$bytes" -v n="$PROBES" 'BEGIN {
+    printf "bench=suite scenario=output_%s events=%d events_per_s=%.0f bytes_per_event=%.1f\n",
+           fmt, n, (wall > 0 ? n / wall : 0), bytes / n }')"
+}
+
+netns_up() {
+  ip netns add "$NS" 2>/dev/null || return 1
+  ip link add "$VETH_HOST" type veth peer name "$VETH_NS" netns "$NS" || return 1
+  ip addr add "$HOST_IP/30" dev "$VETH_HOST" && ip link set "$VETH_HOST" up || return 1
+  ip -n "$NS" addr add "$NS_IP/30" dev "$VETH_NS" && ip -n "$NS" link set "$VETH_NS" up || return 1
+  ip -n "$NS" link set lo up
+}
+
+# --- loopback ---
+probe loopback_flood -f -c "$PROBES" 127.0.0.1
+probe loopback_paced --rate 10000 --burst 16 -c "$((PROBES / 4))" 127.0.0.1
+probe loopback_uring -f --io uring -c "$PROBES" 127.0.0.1
+output jsonl
+output binary
+
+# --- veth pair into a namespace, then with delay and loss ---
+if netns_up; then
+  probe veth_flood -f -c "$PROBES" "$NS_IP"
+  if tc -n "$NS" qdisc add dev "$VETH_NS" root netem delay 1ms loss 1% 2>/dev/null; then
+    probe veth_netem_flood -f -W 1 -c "$PROBES" "$NS_IP"
+    probe veth_netem_paced --rate 1000 -W 1 -c "$((PROBES / 10))" "$NS_IP"
+  else
+    echo "bench=suite scenario=veth_netem skipped (no netem qdisc)"
+  fi
+else
+  echo "bench=suite scenario=veth skipped (cannot create a network namespace)"
+fi
+
+[[ -z "$BASELINE" ]] && exit 0
+
+# --- regressions against a saved run ---
+awk -v tol="$TOLERANCE" '
+  function field(line, key,    m) {
+    return match(line, " " key "=[^ ]+") ? substr(line, RSTART + length(key) + 2, RLENGTH - length(key) - 2) : ""
+  }
+  /^bench=suite scenario=/ {
+    split($2, s, "=")
+    if (FILENAME == ARGV[1]) { base[s[2]] = $0; next }
+    if (!(s[2] in base))
+      next
+    n = split("pps events_per_s cpu_ns_per_probe", keys, " ")
+    for (k = 1; k <= n; k++) {
+      key = keys[k]
+      was = field(base[s[2]], key) + 0
+      now = field($0, key) + 0
+      if (was <= 0)
+        continue
+      change = (now - was) * 100 / was
+      if ((key != "cpu_ns_per_probe" && change < -tol) || (key == "cpu_ns_per_probe" && change > tol)) {
+        printf "bench=suite regression scenario=%s %s=%g baseline=%g change=%+.1f%%\n", s[2], key, now, was, change
+        bad = 1
+      }
+    }
+  }
+  END { exit bad }' "$BASELINE" "$RESULTS"
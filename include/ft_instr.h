@@ -0,0 +1,87 @@
+/* include/ft_instr.h */
+#ifndef FT_INSTR_H
+#define FT_INSTR_H
+
+#include <stdint.h>
+
+/*
+** Hot-path instrumentation
+** ------------------------
+** Built in with `make INSTRUMENT=1` (-DFT_INSTRUMENT): each thread counts
+** the work done in every stage of a probe's life and the time spent there,
+** and the packets it threw away, by reason. SIGQUIT prints the totals after
+** the status line, and -v at the end of the run. Without FT_INSTRUMENT the
+** macros expand to nothing and none of it is compiled.
+**
+** Times are read from the TSC on x86 and converted to nanoseconds against
+** CLOCK_MONOTONIC when printed; elsewhere they are CLOCK_MONOTONIC. A stage
+** includes the stages it calls: parse covers the checksum, stats and output
+** of what it parses. The count is packets for build, send, recv and parse,
+** calls for the others.
+*/
+
+typedef enum e_stage {
+    STAGE_BUILD,      /* stamping probes into a send batch */
+    STAGE_CHECKSUM,   /* verifying a reply's checksum */
+    STAGE_SEND,       /* sendmmsg() */
+    STAGE_WAIT,       /* blocked in epoll_wait() or io_uring_enter() */
+    STAGE_RECV,       /* recvmmsg() */
+    STAGE_PARSE,      /* parsing and validating what was read */
+    STAGE_STATS,      /* matching a reply to its probe, updating the stats */
+    STAGE_OUTPUT,     /* formatting a reply, error or record */
+    STAGE_COUNT
+} t_stage;
+
+typedef enum e_drop {
+    DROP_SHORT,       /* too short for the headers it claims */
+    DROP_CHECKSUM,    /* bad ICMP checksum */
+    DROP_FOREIGN_ID,  /* another process's echo reply, or an error about its probe */
+    DROP_ICMP_TYPE,   /* neither an echo reply nor an error */
+    DROP_UNMATCHED,   /* no probe in flight with that sequence and address */
+    DROP_COUNT
+} t_drop;
+
+#ifdef FT_INSTRUMENT
+
+# if defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#  define INSTR_TICKS() __rdtsc()
+# else
+#  define INSTR_TICKS() now_ns()
+# endif
+
+/* One per thread, on its own cache lines */
+typedef struct s_instr {
+    uint64_t count[STAGE_COUNT];
+    uint64_t ticks[STAGE_COUNT];
+    uint64_t drops[DROP_COUNT];
+} __attribute__((aligned(64))) t_instr;
+
+extern _Thread_local t_instr *g_instr;
+
+/* Only the owning thread writes; a snapshot may read from another */
+static inline void instr_add(uint64_t *counter, uint64_t v) {
+    __atomic_store_n(counter, *counter + v, __ATOMIC_RELAXED);
+}
+
+# define INSTR_START(t)           const uint64_t t = INSTR_TICKS()
+# define INSTR_STOP(stage, t, n)  do { \
+        instr_add(&g_instr->ticks[stage], INSTR_TICKS() - (t)); \
+        instr_add(&g_instr->count[stage], (uint64_t) (n)); \
+    } while (0)
+# define INSTR_DROP(reason)       instr_add(&g_instr->drops[reason], 1)
+
+void instr_thread_init(void);
+void instr_print(void);
+
+#else
+
+# define INSTR_START(t)           ((void) 0)
+# define INSTR_STOP(stage, t, n)  ((void) 0)
+# define INSTR_DROP(reason)       ((void) 0)
+# define instr_thread_init()      ((void) 0)
+# define instr_print()            ((void) 0)
+
+#endif
+
+#endif
@@ -27,27 +27,109 @@ typedef enum e_msg_id {
 
     MSG_ERR_INVALID_INTERVAL, /* "invalid interval: '%s'" */
     MSG_ERR_INTERVAL_SHORT,   /* "interval too short: '%s'" */
+    MSG_ERR_INVALID_WAIT,     /* "invalid wait time: '%s'" */
+    MSG_ERR_INVALID_TRANSPORT, /* "invalid transport: '%s' (raw, dgram, sim or auto)" */
+    MSG_ERR_INVALID_SIM,      /* "invalid simulator setting: '%s'" */
+    MSG_ERR_SIM_URING,        /* "--io uring cannot be used with the simulator" */
+    MSG_ERR_INVALID_THREADS,  /* "invalid thread count: '%s'" */
+    MSG_ERR_THREADS_FLOOD,    /* "--threads cannot be used with flood mode" */
+    MSG_ERR_THREAD,           /* "pthread_create: %s" */
+    MSG_ERR_EVENTFD,          /* "eventfd: %s" */
+    MSG_ERR_INVALID_IO,       /* "invalid I/O backend: '%s' (epoll or uring)" */
+    MSG_ERR_IO_THREADS,       /* "--io uring cannot be used with --threads" */
+    MSG_ERR_RXRING_THREADS,   /* "--rx-ring cannot be used with --threads" */
+    MSG_ERR_INVALID_FORMAT,   /* "invalid output format: '%s' (text, jsonl or binary)" */
+    MSG_ERR_INVALID_RATE,     /* "invalid rate: '%s'" */
+    MSG_ERR_INVALID_BURST,    /* "invalid burst: '%s'" */
+    MSG_ERR_RATE_INTERVAL,    /* "--rate cannot be used with -i" */
+    MSG_ERR_INVALID_RESOLVE_LIMIT, /* "invalid resolver concurrency: '%s'" */
+    MSG_ERR_INVALID_RESOLVE_TTL,   /* "invalid resolver TTL: '%s'" */
+    MSG_ERR_INVALID_SUMMARY,  /* "invalid summary interval: '%s'" */
+    MSG_ERR_INVALID_WINDOW,   /* "invalid summary window: '%s'" */
+    MSG_ERR_WINDOW_SUMMARY,   /* "--window needs --summary" */
+    MSG_ERR_PMTU_WITH,        /* "--pmtu cannot be used with %s" */
+    MSG_ERR_INVALID_SWEEP,    /* "invalid hop count: '%s'" */
+    MSG_ERR_SWEEP_WITH,       /* "--sweep cannot be used with %s" */
 
     MSG_ERR_INVALID_TYPE,     /* "invalid type: '%s'" */
 
+    MSG_ERR_TARGETS_FILE,     /* "%s: %s" */
+    MSG_ERR_STATS_FILE,       /* "%s: %s" */
+    MSG_ERR_NO_TARGETS,       /* "no valid destinations" */
+    MSG_ERR_OUT_OF_MEMORY,    /* "out of memory" */
+
     /* \-\-\- runtime/info \-\-\- */
     MSG_ERR_UNKNOWN_HOST,     /* "unknown host: %s" */
+    MSG_ERR_RESOLVER,         /* "getaddrinfo\_a: %s" */
+    MSG_RESOLVE_CHANGED,      /* "%s: address changed to %s" */
     MSG_ERR_SOCKET,           /* "socket: %s" */
     MSG_ERR_SENDTO,           /* "sendto: %s" */
+    MSG_PROBES_FULL,          /* "%d probes in flight: sending waits for replies or -W" */
     MSG_ERR_RECVMSG,          /* "recvmsg: %s" */
-    MSG_ERR_SETSOCKOPT_TIMEOUT, /* "setsockopt(SO\_RCVTIMEO): %s" */
+    MSG_ERR_EPOLL,            /* "epoll: %s" */
+    MSG_ERR_TIMERFD,          /* "timerfd: %s" */
+    MSG_ERR_SIGNALFD,         /* "signalfd: %s" */
     MSG_ERR_SETSOCKOPT_TTL,     /* "setsockopt(IP\_TTL): %s" */
+    MSG_ERR_SETSOCKOPT_TSTAMP,  /* "setsockopt(SO\_TIMESTAMPING): %s" */
+    MSG_ERR_SETSOCKOPT_FILTER,  /* "setsockopt(SO\_ATTACH\_FILTER): %s" */
+    MSG_ERR_SETSOCKOPT_RECVTTL, /* "setsockopt(IP\_RECVTTL): %s" */
+    MSG_ERR_SETSOCKOPT_RECVERR, /* "setsockopt(IP\_RECVERR): %s" */
+    MSG_ERR_SETSOCKOPT_PMTUDISC, /* "setsockopt(IP\_MTU\_DISCOVER): %s" */
+    MSG_ERR_BIND,               /* "bind: %s" */
+    MSG_TRANSPORT_FALLBACK,     /* "raw socket: %s, using an ICMP datagram socket" */
+    MSG_DGRAM_GROUP_HINT,       /* "ICMP datagram sockets are limited to net.ipv4.ping\_group\_range ..." */
+    MSG_ERR_URING,              /* "io\_uring: %s" */
+    MSG_IO_FALLBACK,            /* "io\_uring: %s, using epoll" */
+    MSG_ERR_PACKET_SOCKET,      /* "packet socket: %s" */
+    MSG_ERR_RXRING_RAW,         /* "--rx-ring needs a raw socket" */
 
     MSG_PING_HEADER,          /* "PING %s (%s): %d data bytes" */
-    MSG_PING_REPLY,           /* "%ld bytes from %s: icmp\_seq\=%d ttl\=%d time\=%.3f ms" */
+    MSG_PING_HEADER_MULTI,    /* "PING %zu targets: %d data bytes" */
+    MSG_PING_REPLY,           /* "%ld bytes from %s: icmp\_seq\=%d ttl\=%d time\=%.3f ms%s" */
+    MSG_PING_REPLY_KTS,       /* "... time\=%.3f ms ktime\=%.3f ms%s" */
     MSG_PING_FROM,            /* "From %s: icmp\_seq\=%d %s" */
+    MSG_PING_TIMEOUT,         /* "no answer from %s: icmp_seq=%d after %.3f ms" (--rto) */
+    MSG_PING_FRAG,            /* "From %s: icmp\_seq\=%d Frag needed and DF set (mtu \= %d)" */
+    MSG_PMTU_HEADER,          /* "PMTU %s (%s): %d to %d bytes" */
+    MSG_PMTU_ROUND,           /* "round %d: path mtu %d to %d (sizes tried: %d)" */
+    MSG_PMTU_RESULT,          /* "path mtu to %s: %d bytes, found in round %d" */
+    MSG_PMTU_PARTIAL,         /* "path mtu to %s: %d to %d bytes, interrupted in round %d" */
+    MSG_PMTU_NONE,            /* "path mtu to %s: no reply even at %d bytes" */
+    MSG_SWEEP_HEADER,         /* "SWEEP %s (%s): %d hops max, %d data bytes" */
+    MSG_SWEEP_HOP,            /* "%3d  %s  %.3f ms%s" */
+    MSG_SWEEP_STATS_HEADER,   /* "--- %s hop statistics ---" */
+    MSG_SWEEP_COLUMNS,        /* "hop  address ... loss  sent  recv  last  avg  best  worst  mdev" */
+    MSG_SWEEP_ROW,            /* "%3d  %-15s %5.1f%% %5ld %5ld %8.3f ... %s" */
+    MSG_SWEEP_ROW_NORTT,      /* "%3d  %-15s %5.1f%% %5ld %5ld" */
+    MSG_SWEEP_UNREACHED,      /* "%s not reached within %d hops" */
 
     MSG_STATS_HEADER,         /* "--- %s ping statistics ---" */
+    MSG_STATS_HEADER_MULTI,   /* "--- %zu targets ping statistics ---" */
+    MSG_STATS_TARGET,         /* "%s : xmt/rcv/%%loss = %ld/%ld/%.0f%%, min/avg/max = ..." */
+    MSG_STATS_TARGET_NORTT,   /* "%s : xmt/rcv/%%loss = %ld/%ld/%.0f%%" */
     MSG_STATS_SUMMARY,        /* "%ld packets transmitted, %ld received, %.0f%% packet loss, time %.0fms" */
     MSG_STATS_RTT,            /* "rtt min\/avg\/max\/mdev \= %.3f\/%.3f\/%.3f\/%.3f ms" */
+    MSG_STATS_SEQ,            /* "%ld duplicates, %ld out of order, %ld late, %ld timed out, %ld errors" */
+    MSG_STATS_READS,          /* "%ld packets read from the socket, %ld I/O syscalls" */
+    MSG_STATS_RING,           /* "receive ring: %lu packets, %lu dropped, %lu times full" */
+    MSG_STATS_PACING,         /* "pacing: %ld sends at %.0f/s, jitter min\/avg\/max\/p99 \= ..." */
+    MSG_STATS_PCTL,           /* "rtt p50\/p90\/p99\/p99.9 \= ..." */
+    MSG_STATS_KRTT,           /* "kernel rtt min\/avg\/max\/mdev \= ..." */
+    MSG_STATS_OVERHEAD,       /* "userspace overhead min\/avg\/max \= ..." */
+    MSG_STATS_RTO,            /* "rto %.3f ms (srtt %.3f ms, rttvar %.3f ms)" */
+
+    MSG_STATUS,               /* "%ld/%ld packets, %.0f%% loss" (SIGQUIT) */
+    MSG_STATUS_RTT,           /* "..., min\/avg\/max \= %.3f\/%.3f\/%.3f ms" */
+    MSG_WINDOW,               /* "[%ld] last %lds: %ld sent, %ld received, %.1f%% loss" (--summary) */
+    MSG_WINDOW_RTT,           /* "..., rtt min\/p50\/p90\/p99\/max \= ... ms, jitter %.3f ms" */
+    MSG_INSTR_HEADER,         /* "stage ... count ... total ms ... avg ns" */
+    MSG_INSTR_STAGE,          /* "%-8s %12lu %12.3f %10.1f" */
+    MSG_INSTR_DROPS,          /* "dropped: %lu short, %lu bad checksum, ..." */
 
     MSG_USAGE_OPTIONS_HEADER, /* "Options:" */
     MSG_USAGE_OPTION_LINE,    /* "%-35s %s" */
+
+    MSG_COUNT
 } t_msg_id;
 
 /*
@@ -57,6 +139,9 @@ void    ping_msg(t_msg_id id, ...);
 void    ping_fatal(t_msg_id id, ...);
 
 /* \-\-\- Runtime output (messages.c) \-\-\- */
-void    print_stats(const t_stats *stats);
+void    print_stats(const char *name, const t_stats *stats);
+void    print_summary(void);
+void    print_status(void);
+void    flood_mark(char c);
 
 #endif
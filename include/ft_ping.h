@@ -2,9 +2,14 @@
 #ifndef HEADER_H
 #define HEADER_H
 
+#include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdatomic.h>
 #include <signal.h>
 #include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 
 /* Custom ICMP defines if not available */
@@ -20,6 +25,9 @@
 #ifndef ICMP_TIME_EXCEEDED
 # define ICMP_TIME_EXCEEDED 11
 #endif
+#ifndef ICMP_FRAG_NEEDED
+# define ICMP_FRAG_NEEDED 4
+#endif
 
 /* Re-definition of ICMP header to avoid dependency issues */
 struct my_icmp_header {
@@ -33,41 +41,502 @@ struct my_icmp_header {
 /* Globals & Structs */
 typedef struct s_flags {
     int count;
-    int interval_ms;
+    int64_t interval_ns;  /* between two probes to the same target (-i, --rate) */
     int timeout;
     int verbose;
     int ttl;
     int payload_size;
+    int size_set;      /* -s given */
     int quiet;
+    int multi;
+    const char *targets_file;
+    int flood;
+    int interval_set;
+    const char *interval_short; /* interval below the non-flood limit, if any */
+    int kernel_ts;
+    int wait_ms;       /* how long a probe may stay unanswered (-W) */
+    int no_filter;     /* skip the in-kernel socket filter */
+    int transport;     /* t_transport_kind */
+    int threads;       /* worker threads (--threads), 0 or 1 for none */
+    int io;            /* t_io_kind: event loop backend (--io) */
+    int rx_ring;       /* read replies from a packet ring (--rx-ring) */
+    int format;        /* t_format_kind: what stdout carries (--format) */
+    double rate;       /* probes per second over all targets (--rate), 0 if unset */
+    int burst;         /* most late probes sent at once to catch up (--burst) */
+    int resolve_limit; /* host name lookups in flight at once (--resolve-limit) */
+    int64_t resolve_ttl_ns; /* how long a looked-up address is used, 0 for ever (--resolve-ttl) */
+    const char *stats_file; /* live statistics file (--stats-file), NULL for none */
+    int summary_s;     /* seconds between interval summaries (--summary), 0 for none */
+    int window_s;      /* seconds each one covers (--window), --summary by default */
+    int rto;           /* give up on probes after an adaptive timeout (--rto) */
+    int pmtu;          /* search for the path MTU instead of pinging (--pmtu) */
+    int sweep;         /* probe every hop up to this TTL each round (--sweep), 0 if unset */
 } t_flags;
 
 /* Global variables */
-extern char *target;
 extern t_flags flags;
-extern struct sockaddr_in dest_addr;
 extern volatile sig_atomic_t should_stop;
 
-/* Stats structure */
+#define NS_PER_SEC 1000000000LL
+#define NS_PER_MS  1000000.0
+
+/* Log-bucketed RTT histogram (histogram.c); values in nanoseconds */
+#define HIST_SUB_BITS  7
+#define HIST_MAX_VALUE (1ULL << 40)   /* ~18 minutes, larger values are clamped */
+#define HIST_BUCKETS   ((40 - HIST_SUB_BITS + 1) * (1 << (HIST_SUB_BITS - 1)) + (1 << (HIST_SUB_BITS - 1)))
+
+typedef struct s_hist {
+    uint64_t total;
+    uint64_t counts[HIST_BUCKETS];
+} t_hist;
+
+/* Stats structure; RTTs are CLOCK_MONOTONIC nanoseconds */
 typedef struct s_stats {
-    long    tx;
-    long    rx;
-    double  min;
-    double  max;
-    double  sum;
-    double  sq_sum;
-    struct  timeval start_tv;
+    long     tx;
+    long     rx;
+    long     dup;       /* replies to a probe already answered */
+    long     reorder;   /* replies older than one already received */
+    long     late;      /* replies after the -W wait time */
+    long     timeouts;  /* probes unanswered after the -W wait time */
+    long     errors;    /* probes answered by an ICMP error instead */
+    int64_t  min;
+    int64_t  max;
+    double   mean;    /* running mean and sum of squared deviations (Welford) */
+    double   m2;
+    uint64_t start_ns;
+    t_hist  *hist;    /* optional percentile histogram */
 } t_stats;
 
-extern t_stats g_stats;
+/*
+** Accumulators are per thread: each worker (--threads) updates its own and
+** they are merged into the main thread's once the workers have exited.
+*/
+extern _Thread_local t_stats g_stats;
+extern _Thread_local long    g_rx_reads;  /* datagrams read from the socket, ours or not */
+extern _Thread_local long    g_io_syscalls; /* syscalls made by the event loop and socket I/O */
+
+/* ICMP errors about our probes, by type (0 to 18); only the stats file shows them */
+#define ICMP_TYPES 19
+
+extern _Thread_local long    g_icmp_errors[ICMP_TYPES];
+
+/* Kernel-timestamped RTT and the userspace time on top of it (--kernel-ts) */
+typedef struct s_kts_stats {
+    t_stats rtt;
+    t_stats overhead;
+} t_kts_stats;
+
+extern _Thread_local t_kts_stats g_kts;
+
+void stats_thread_init(void);
+
+/* Shared counters bumped from any thread; nothing orders on them */
+#define STAT_INC(x) atomic_fetch_add_explicit(&(x), 1, memory_order_relaxed)
+
+/* Per-target counters: any worker may send a target's probes or get its replies */
+typedef struct s_target_stats {
+    _Atomic long    tx;
+    _Atomic long    rx;
+    _Atomic long    dup;
+    _Atomic long    reorder;
+    _Atomic long    late;
+    _Atomic long    timeouts;
+    _Atomic int64_t min;       /* INT64_MAX before the first reply */
+    _Atomic int64_t max;
+    _Atomic int64_t sum;       /* for the mean */
+    _Atomic int64_t last_rtt;  /* latest reply, for the --summary jitter; 0 before one */
+} t_target_stats;
+
+/*
+** Adaptive probe timeout of a target (rto.c), ns: 0 before its first reply.
+** Workers update it without a lock; a race only loses one sample.
+*/
+typedef struct s_rto {
+    _Atomic int64_t srtt;      /* smoothed RTT */
+    _Atomic int64_t rttvar;    /* its mean deviation */
+    _Atomic int64_t rto;       /* what the next probe gets, backed off after a loss */
+} t_rto;
+
+/* Whether a target can be probed: its name may still be looked up (resolver.c) */
+typedef enum { TARGET_READY, TARGET_PENDING, TARGET_FAILED } t_target_state;
+
+/* Per-destination state; the index into g_targets identifies a target */
+typedef struct s_target {
+    const char         *name;
+    struct sockaddr_in  addr;      /* s_addr may change under a re-resolution */
+    _Atomic uint32_t    seq;       /* probes scheduled; the low 16 bits are the sequence */
+    _Atomic uint32_t    last_seq;  /* highest sequence answered + 1, 0 before any */
+    _Atomic uint8_t     state;     /* t_target_state */
+    t_target_stats      stats;
+    t_rto               rto;
+} t_target;
+
+extern t_target *g_targets;
+extern size_t    g_ntargets;
+extern size_t    g_targets_failed;  /* names that did not resolve */
+
+/* In-flight probe ring, indexed by the sequence number put on the wire */
+#define PROBE_MAP_SIZE 65536
+
+typedef enum { PROBE_FREE, PROBE_PENDING, PROBE_REPLIED, PROBE_EXPIRED } t_probe_state;
+typedef enum { REPLY_OK, REPLY_DUP, REPLY_REORDERED, REPLY_LATE } t_reply_kind;
+
+typedef struct s_probe {
+    uint64_t sent_ns;  /* CLOCK_MONOTONIC send time */
+    int64_t  ktx_ns;   /* kernel TX timestamp (CLOCK_REALTIME), 0 if none */
+    uint32_t target;   /* index into g_targets */
+    uint16_t seq;      /* per-target sequence number */
+    uint8_t  state;    /* t_probe_state */
+    uint32_t heap;     /* index in the deadline heap while pending */
+} t_probe;
+
+extern _Thread_local t_probe g_probes[PROBE_MAP_SIZE];
+
+/* Send schedule: which target and wire sequence number come next */
+typedef struct s_sched {
+    int       id;      /* ICMP id: our pid (raw) or kernel-assigned (dgram) */
+    uint16_t  wire_seq;
+    size_t    first;   /* targets [first, end) are probed round-robin */
+    size_t    end;
+    size_t    next;    /* index of the next target to probe */
+    long long sent;
+    long long limit;   /* total probes to send, -1 for unlimited */
+} t_sched;
+
+/* Number of messages moved per sendmmsg()/recvmmsg() call */
+#define IO_BATCH 64
+
+/* The ICMP header is the only part written per probe */
+#define PKT_HDR_LEN sizeof(struct my_icmp_header)
+
+/* Echo request built once; see pkt_template_init() */
+typedef struct s_pkt_template {
+    uint8_t   hdr[PKT_HDR_LEN];  /* header with seq and checksum zero */
+    size_t    hdr_len;           /* min(packet length, PKT_HDR_LEN) */
+    char     *payload;           /* pattern after the header, shared by all sends */
+    size_t    payload_len;
+    uint32_t  partial;           /* one's complement sum of the constant bytes */
+} t_pkt_template;
+
+typedef struct s_tx_batch {
+    struct mmsghdr  msgs[IO_BATCH];
+    struct iovec    iov[IO_BATCH][2];
+    uint8_t         hdrs[IO_BATCH][PKT_HDR_LEN] __attribute__((aligned(8)));
+    t_target       *targets[IO_BATCH];
+    uint16_t        seqs[IO_BATCH];
+    t_pkt_template  tpl;
+} t_tx_batch;
+
+/* Room for an SCM_TIMESTAMPING cmsg per received message */
+#define RX_CTRL_LEN 128
+
+typedef struct s_rx_batch {
+    struct mmsghdr  msgs[IO_BATCH];
+    struct iovec    iov[IO_BATCH];
+    char            ctrl[IO_BATCH][RX_CTRL_LEN] __attribute__((aligned(8)));
+    struct sockaddr_in names[IO_BATCH];
+    char           *bufs;
+    size_t          buf_len;
+} t_rx_batch;
 
 /* Functions */
+uint64_t now_ns(void);
 double   get_time_ms(void);
-void     update_stats(double rtt);
-uint16_t checksum(void *data, int len);
-void     resolve_destination(const char *hostname);
+void     update_stats(t_stats *stats, int64_t rtt_ns);
+void     stats_merge(t_stats *dst, const t_stats *src);
+void     target_stats_add(t_target_stats *ts, int64_t rtt_ns);
+void     hist_merge(t_hist *dst, const t_hist *src);
+void     hist_record(t_hist *h, int64_t value);
+size_t   hist_bucket(int64_t value);
+int64_t  hist_percentile(const t_hist *h, double q);
+int64_t  hist_clamp(int64_t v, int64_t lo, int64_t hi);
+int64_t  stats_percentile(const t_stats *s, double q);
+int      resolve_destination(const char *hostname, struct sockaddr_in *out);
 void     ft_usage(int exit_code);
 void     parse_args(int argc, char **argv);
 
+/* Event loop helpers (events.c) */
+struct timespec ns_to_timespec(uint64_t ns);
+int      timer_open(int abs, const struct timespec *value, const struct timespec *interval);
+uint64_t timer_drain(int fd);
+void     epoll_watch(int epfd, int fd);
+int      signal_read(int sig_fd);
+
+/* Event loops: epoll (loop.c) and io_uring (uring.c) */
+typedef enum { IO_EPOLL, IO_URING } t_io_kind;
+
+/* Flood without an interval: probes kept in flight, and how long to wait
+ * for a reply before sending anyway (the same 10 ms iputils ping uses) */
+#define FLOOD_WINDOW   IO_BATCH
+#define FLOOD_WAIT_MS  10
+
+void     ping_loop(int sock, int id, int sig_fd);
+int      uring_loop(int sock, int id, int sig_fd);
+
+/* Send pacing (pacer.c): when probes are due, and how late they went out */
+#define PACE_BURST_MAX 1024
+
+typedef struct s_pacer {
+    uint64_t period_ns;   /* between two sends */
+    uint64_t next_ns;     /* when the next probe is due (CLOCK_MONOTONIC) */
+    int      burst;       /* token bucket depth */
+} t_pacer;
+
+typedef struct s_pace_stats {
+    t_stats  jitter;      /* actual minus planned send time, ns */
+    long     sends;
+    uint64_t first_ns;    /* first and last paced send */
+    uint64_t last_ns;
+} t_pace_stats;
+
+extern t_pace_stats g_pace;
+
+void     pacer_init(t_pacer *p, uint64_t start_ns);
+int      pacer_due(t_pacer *p, uint64_t now);
+int      pacer_send(t_pacer *p, int sock, t_sched *s, t_tx_batch *tx);
+int      pacer_finished(const t_pacer *p, const t_sched *s, uint64_t now);
+double   pace_rate(void);
+
+/* Checksums (checksum.c) */
+typedef uint32_t (*t_csum_fn)(const void *data, size_t len, uint32_t sum);
+
+typedef struct s_csum_impl {
+    const char *name;
+    t_csum_fn   fn;
+    int       (*supported)(void);
+} t_csum_impl;
+
+extern const t_csum_impl g_csum_impls[];
+
+uint16_t checksum(void *data, int len);
+uint32_t csum_partial(const void *data, size_t len, uint32_t sum);
+uint16_t csum_fold(uint32_t sum);
+
+/* Packets (packet.c) */
+void     pkt_template_init(t_pkt_template *tpl, int id);
+void     pkt_template_free(t_pkt_template *tpl);
+void     pkt_stamp(const t_pkt_template *tpl, uint8_t *hdr, uint16_t seq);
+void     io_batch_init(t_tx_batch *tx, t_rx_batch *rx, int id);
+void     io_batch_free(t_tx_batch *tx, t_rx_batch *rx);
+int      send_probes(int sock, t_sched *s, t_tx_batch *tx, int want);
+int      sched_done(const t_sched *s);
+void     recv_packets(int sock, int id, t_rx_batch *rx);
+void     pkt_parse_ip(const char *buf, size_t bytes, int id, int64_t krx_ns, uint64_t rx_ns);
+void     pkt_parse_raw(const struct msghdr *msg, size_t bytes, int id);
+void     pkt_parse_dgram(const struct msghdr *msg, size_t bytes, int id);
+void     pkt_report_error(struct in_addr from, uint8_t type, uint8_t code, struct in_addr orig_dst,
+                          uint16_t wire_seq, uint16_t next_mtu);
+
+/* Transports (transport.c): how probes and replies move through the socket */
+typedef enum { TRANSPORT_AUTO, TRANSPORT_RAW, TRANSPORT_DGRAM, TRANSPORT_SIM } t_transport_kind;
+
+typedef struct s_transport {
+    const char *name;
+    int  (*open)(void);                   /* socket(), -1 with errno set */
+    int  (*setup)(int sock, int index);   /* socket options; returns the ICMP id */
+    int  (*send)(int sock, struct mmsghdr *msgs, unsigned int n);
+    int  (*recv)(int sock, struct mmsghdr *msgs, unsigned int n);
+    void (*parse)(const struct msghdr *msg, size_t bytes, int id);
+} t_transport;
+
+extern const t_transport  g_transport_raw;
+extern const t_transport  g_transport_dgram;
+extern const t_transport  g_transport_sim;
+extern const t_transport *g_transport;
+
+int      transport_open(void);
+int      transport_socket(int index, int *id);
+int      transport_drain_errqueue(int sock);
+
+/* Network simulator (sim.c): replies made up in-process (--sim) */
+typedef enum { SIM_DIST_UNIFORM, SIM_DIST_EXP, SIM_DIST_NORMAL } t_sim_dist;
+
+typedef struct s_sim_conf {
+    int64_t  delay_ns;      /* round-trip time before the jitter */
+    int64_t  jitter_ns;     /* spread on top of it, shaped by dist */
+    int      dist;          /* t_sim_dist */
+    double   loss;          /* odds per probe, 0 to 1 */
+    double   dup;
+    double   reorder;
+    double   ttl_exceeded;
+    double   unreach;
+    uint64_t seed;
+    int      mtu;           /* path MTU: larger probes get Frag Needed, 0 for none */
+    int      ifmtu;         /* interface MTU: larger sends fail, 0 for none */
+    int      blackhole;     /* routers drop probes over mtu without a word */
+    int      hops;          /* routers to the target: lower TTLs get Time Exceeded, 0 for none */
+} t_sim_conf;
+
+extern t_sim_conf g_sim;
+
+int      sim_configure(const char *spec);
+
+/* Kernel timestamps (timestamp.c) */
+int      kts_enable(int sock);
+void     kts_on_sent(uint16_t wire_seq);
+int64_t  kts_from_msg(const struct msghdr *msg);
+void     kts_on_tx_stamp(uint32_t key, int64_t ts);
+
+/* Output sink (output.c): stdout lines are buffered, errors written at once */
+typedef enum { OUT_STDOUT, OUT_STDERR } t_out_stream;
+
+void     out_msg(t_out_stream stream, int id, const char *fmt, va_list args);
+void     out_write(const char *s, size_t n);
+void     out_flush(void);
+void     out_poll(uint64_t idle_ns);
+size_t   fmt_u64(char *dst, uint64_t v);
+size_t   fmt_fixed(char *dst, double v, int decimals);
+size_t   fmt_ipv4(char *dst, struct in_addr addr);
+
+/* Interval summaries (window.c): the last --window seconds every --summary seconds */
+#define WINDOW_MAX 3600
+
+typedef struct s_window_stats {
+    uint64_t end_ns;     /* CLOCK_MONOTONIC end of the window, on a second */
+    long     seconds;    /* covered: fewer than --window early in the run */
+    long     tx;
+    long     rx;
+    long     dup;
+    long     timeouts;
+    int64_t  rtt_min;    /* RTTs of the replies in rx, 0 if none */
+    int64_t  rtt_avg;
+    int64_t  rtt_p50;
+    int64_t  rtt_p90;
+    int64_t  rtt_p99;
+    int64_t  rtt_max;
+    int64_t  jitter;     /* mean RTT change between two replies of a target, -1 if none */
+} t_window_stats;
+
+void     window_init(uint64_t now);
+void     window_advance(uint64_t now);
+void     window_collect(uint64_t now, t_window_stats *w);
+void     window_start(void);
+void     window_stop(void);
+void     window_sent(long n, uint64_t now);
+void     window_reply(t_target *t, int64_t rtt, uint64_t now);
+void     window_dup(uint64_t now);
+void     window_timeout(uint64_t now);
+
+/* Structured output (records.c): one record per probe event, see ft_records.h */
+typedef enum { FORMAT_TEXT, FORMAT_JSONL, FORMAT_BINARY } t_format_kind;
+
+void     records_start(void);
+void     record_reply(const t_probe *p, t_reply_kind kind, struct in_addr from, int ttl,
+                      size_t bytes, int64_t rtt_ns, int64_t krtt_ns, uint64_t now);
+void     record_timeout(const t_probe *p, uint64_t now);
+void     record_error(const t_probe *p, struct in_addr from, uint8_t type, uint8_t code,
+                      uint16_t next_mtu);
+void     records_summary(void);
+void     record_window(const t_window_stats *w);
+
+/* Socket filter (filter.c) */
+int      filter_attach(int sock, int id, int check_proto);
+int      filter_drop_all(int sock);
+
+/* Packet ring receive path (rxring.c) */
+typedef struct s_rxring_stats {
+    unsigned long packets;   /* seen by the ring, dropped ones included */
+    unsigned long drops;     /* lost because every block was in use */
+    unsigned long freezes;   /* times the ring filled up */
+    int           used;
+} t_rxring_stats;
+
+extern t_rxring_stats g_rxring_stats;
+
+int      rxring_open(int sock, int id);
+void     rxring_drain(int id);
+void     rxring_close(void);
+
+/* Targets (targets.c) */
+t_target *target_add(const char *name);
+void      targets_load_file(const char *path);
+void      targets_resolve(void);
+
+/* Background name resolution (resolver.c) */
+#define RESOLVE_LIMIT_DEFAULT 32
+#define RESOLVE_LIMIT_MAX     1024
+#define RESOLVE_TTL_DEFAULT   (300 * NS_PER_SEC)
+
+void      resolver_start(void);
+int       resolver_fd(void);
+void      resolver_poll(void);
+
+/* Live statistics file (statsfile.c), layout in ft_statsfile.h */
+void      statsfile_open(void);
+void      statsfile_attach(int index);
+void      statsfile_poll(uint64_t idle_ns);
+void      statsfile_flush(void);
+void      statsfile_close(void);
+
+/* Probe ring (probes.c) */
+void         probe_track(uint16_t wire_seq, size_t target_idx, uint16_t seq, uint64_t sent_ns);
+t_probe     *probe_lookup(uint16_t wire_seq, struct in_addr src);
+t_reply_kind probe_reply(t_probe *p, uint64_t now);
+void         probes_expire(uint64_t now);
+int64_t      probes_until(uint64_t now);
+void         probe_forget(uint16_t wire_seq);
+int          probes_wait_ms(int wait_ms, uint64_t now);
+void         probes_reset(void);
+void         probes_thread_free(void);
+
+/* Adaptive probe timeouts (rto.c) */
+/* A floor of our own: RFC 6298's 1 s (200 ms in Linux TCP) is far above LAN RTTs */
+#define RTO_MIN_NS         (10 * 1000000LL)
+#define RTO_GRANULARITY_NS (1000000LL)       /* G of RFC 6298: the loop's wake-up slack */
+
+void         rto_sample(t_rto *r, int64_t rtt);
+void         rto_backoff(t_rto *r, int64_t used);
+int64_t      rto_get(const t_rto *r);
+
+/* Path MTU discovery (pmtu.c); sizes are whole IP datagrams */
+#define PMTU_MIN     68      /* every IPv4 link carries this much (RFC 791) */
+#define PMTU_MAX     65535
+#define PMTU_PROBES  8       /* sizes spread over the range each round */
+#define PMTU_SIZES   (PMTU_PROBES + 2)   /* plus PMTU_MIN and the next-hop hint */
+
+typedef enum { PMTU_WAIT, PMTU_FITS, PMTU_TOO_BIG, PMTU_LOST } t_pmtu_verdict;
+
+typedef struct s_pmtu {
+    int      lo;       /* largest size answered, PMTU_MIN - 1 before one */
+    int      hi;       /* largest size that may still get through */
+    int      hint;     /* next-hop MTU of the latest Frag Needed, 0 for none */
+    int      rounds;
+    int      nsizes;   /* this round's probes */
+    int      sizes[PMTU_SIZES];
+    uint16_t wire_seqs[PMTU_SIZES];
+    uint8_t  verdicts[PMTU_SIZES];   /* t_pmtu_verdict */
+    uint16_t next_mtus[PMTU_SIZES];  /* what each Frag Needed said */
+} t_pmtu;
+
+void     pmtu_init(t_pmtu *m, int hi);
+int      pmtu_plan(t_pmtu *m);
+void     pmtu_update(t_pmtu *m);
+void     pmtu_error(uint16_t wire_seq, uint8_t type, uint8_t code, uint16_t next_mtu);
+int      pmtu_run(int sock, int id, int sig_fd);
+void     record_pmtu(const t_pmtu *m, int done);
+
+/* TTL sweep (sweep.c); hops are numbered by the TTL that reaches them */
+#define SWEEP_HOPS_MAX 255
+
+typedef struct s_hop {
+    struct in_addr addr;       /* latest router or target that answered, 0 before one */
+    int            changes;    /* times another address answered (ECMP, route changes) */
+    int64_t        last_rtt;
+    t_stats        stats;      /* tx and rx settled probes, RTTs of the answers */
+} t_hop;
+
+void         sweep_answer(const t_probe *p, uint16_t wire_seq, struct in_addr from, int last,
+                          uint64_t now);
+const t_hop *sweep_hop(int ttl);
+int          sweep_run(int sock, int id, int sig_fd);
+void         record_hop(int ttl, const t_hop *h);
+
+/* Worker pool (workers.c) */
+#define WORKERS_MAX 256
+
+void     workers_init(void);
+void     workers_run(int sig_fd);
+
 /* Option Handlers */
 typedef void (*t_opt_handler)(const char *val);
 typedef enum { ARG_NONE, ARG_REQ } t_arg_type;
@@ -91,5 +560,27 @@ void handle_ttl(const char *val);
 void handle_size(const char *val);
 void handle_timeout(const char *val);
 void handle_interval(const char *val);
+void handle_multi(const char *val);
+void handle_file(const char *val);
+void handle_flood(const char *val);
+void handle_kernel_ts(const char *val);
+void handle_wait(const char *val);
+void handle_no_filter(const char *val);
+void handle_transport(const char *val);
+void handle_threads(const char *val);
+void handle_io(const char *val);
+void handle_rx_ring(const char *val);
+void handle_format(const char *val);
+void handle_rate(const char *val);
+void handle_burst(const char *val);
+void handle_resolve_limit(const char *val);
+void handle_resolve_ttl(const char *val);
+void handle_stats_file(const char *val);
+void handle_summary(const char *val);
+void handle_window(const char *val);
+void handle_rto(const char *val);
+void handle_pmtu(const char *val);
+void handle_sweep(const char *val);
+void handle_sim(const char *val);
 
 #endif
\ No newline at end of file
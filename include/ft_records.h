@@ -0,0 +1,133 @@
+/* include/ft_records.h */
+#ifndef FT_RECORDS_H
+#define FT_RECORDS_H
+
+#include <stdint.h>
+
+/*
+** Binary record stream (--format binary)
+** --------------------------------------
+** stdout is a sequence of fixed-size t_record: a REC_START record first, then
+** one record per probe event, a REC_WINDOW record every --summary seconds,
+** a REC_PMTU record per --pmtu round and the REC_SUMMARY records (REC_HOP
+** records with --sweep) at the end. Every record is REC_SIZE bytes, in host
+** byte order except for addresses (network order, as in struct in_addr), so
+** a file of them can be mmap()ed and indexed as an array. A reader checks
+** the magic and the version of the first record and skips records whose
+** type it does not know.
+**
+** A new field goes into reserved space and keeps REC_VERSION; moving or
+** resizing an existing one bumps it.
+*/
+
+#define REC_MAGIC    "FTPING\0R"
+#define REC_VERSION  1
+#define REC_SIZE     64
+#define REC_ALL      UINT32_MAX   /* target of the run totals */
+
+typedef enum e_rec_type {
+    REC_START = 1,     /* stream header */
+    REC_REPLY,         /* first echo reply to a probe */
+    REC_DUPLICATE,     /* another reply to an answered probe */
+    REC_TIMEOUT,       /* no reply within the -W wait time */
+    REC_ERROR,         /* ICMP error about a probe */
+    REC_SUMMARY,       /* per-target and total statistics */
+    REC_WINDOW,        /* statistics of the last --window seconds (--summary) */
+    REC_PMTU,          /* where the path MTU search stands after a round (--pmtu) */
+    REC_HOP            /* statistics of one hop (--sweep) */
+} t_rec_type;
+
+/* REC_REPLY flags */
+#define REC_F_REORDERED 0x1   /* older than a reply already received */
+#define REC_F_LATE      0x2   /* after the -W wait time (also counted as a timeout) */
+
+/* REC_PMTU flags */
+#define REC_F_DONE      0x1   /* the search is over: low is the path MTU, 0 if nothing answered */
+
+typedef struct s_record {
+    uint8_t  type;        /* t_rec_type */
+    uint8_t  version;     /* REC_VERSION */
+    uint16_t flags;       /* REC_F_* */
+    uint32_t target;      /* index of the target (command line/file order), or REC_ALL */
+    uint64_t time_ns;     /* CLOCK_REALTIME of the event */
+    union {
+        struct {
+            char     magic[8];      /* REC_MAGIC */
+            uint32_t record_size;   /* REC_SIZE */
+            uint32_t ntargets;
+            uint32_t data_bytes;    /* -s */
+            uint32_t interval_ms;
+            uint32_t wait_ms;
+            uint32_t reserved0;
+            uint64_t interval_ns;   /* interval_ms before rounding (-i, --rate) */
+            uint8_t  reserved[8];
+        } start;
+        struct {
+            int64_t  rtt_ns;        /* -1 for timeouts and errors */
+            int64_t  krtt_ns;       /* kernel-timestamped RTT, -1 without --kernel-ts */
+            uint32_t addr;          /* reply or error source, the target for timeouts */
+            uint16_t seq;           /* icmp_seq of the probe */
+            uint16_t bytes;         /* ICMP bytes received */
+            uint8_t  ttl;
+            uint8_t  icmp_type;     /* REC_ERROR only */
+            uint8_t  icmp_code;
+            uint8_t  reserved0;
+            uint16_t next_mtu;      /* REC_ERROR: next-hop MTU of a Frag Needed, 0 if none */
+            uint8_t  reserved[18];
+        } probe;
+        struct {
+            uint64_t tx;
+            uint64_t rx;
+            uint32_t dup;           /* 32-bit counters saturate */
+            uint32_t reorder;
+            uint32_t late;
+            uint32_t timeouts;
+            float    rtt_min_ns;    /* RTTs of the replies in rx, 0 if none */
+            float    rtt_avg_ns;
+            float    rtt_max_ns;
+            float    rtt_mdev_ns;   /* -1 for one target out of several */
+            /* No room for the probes answered by an ICMP error (the JSON
+             * totals have "errors"): count the REC_ERROR records, which
+             * -q leaves out */
+        } summary;
+        struct {
+            uint32_t seconds;       /* covered: fewer than --window early in the run */
+            uint32_t tx;            /* 32-bit counters saturate */
+            uint32_t rx;
+            uint32_t dup;
+            uint32_t timeouts;      /* loss is timeouts / (rx + timeouts) */
+            float    rtt_min_ns;    /* RTTs of the replies in rx, 0 if none */
+            float    rtt_avg_ns;
+            float    rtt_p50_ns;
+            float    rtt_p90_ns;
+            float    rtt_p99_ns;
+            float    rtt_max_ns;
+            float    rtt_jitter_ns; /* mean RTT change between replies of a target, -1 if none */
+        } window;
+        struct {
+            uint32_t round;
+            uint32_t sizes;         /* probed in the round */
+            uint32_t low;           /* largest IP datagram answered, 0 before one */
+            uint32_t high;          /* largest that may still get through */
+            uint32_t next_mtu;      /* from the latest Frag Needed, 0 if none */
+            uint8_t  reserved[28];
+        } pmtu;
+        struct {
+            uint32_t ttl;           /* that reaches the hop */
+            uint32_t addr;          /* latest to answer, 0 if none did */
+            uint32_t tx;            /* settled probes; 32-bit counters saturate */
+            uint32_t rx;
+            uint32_t changes;       /* times another address answered */
+            float    rtt_min_ns;    /* RTTs of the answers in rx, 0 if none */
+            float    rtt_avg_ns;
+            float    rtt_max_ns;
+            float    rtt_mdev_ns;
+            float    rtt_last_ns;
+            uint8_t  reserved[8];
+        } hop;
+    };
+} t_record;
+
+_Static_assert(sizeof(t_record) == REC_SIZE, "t_record must stay REC_SIZE bytes");
+
+#endif
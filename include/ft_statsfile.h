@@ -0,0 +1,76 @@
+/* include/ft_statsfile.h */
+#ifndef FT_STATSFILE_H
+#define FT_STATSFILE_H
+
+#include <stdint.h>
+
+/*
+** Live statistics file (--stats-file)
+** -----------------------------------
+** A t_sf_header followed by `nblocks` t_sf_block, `block_size` bytes apart:
+** one block per thread sending probes (one, or --threads). Each block holds
+** that thread's counters and RTT histogram and is rewritten at most every
+** SF_PERIOD_NS while they change. The file appears complete (it is built
+** under another name and renamed into place) and stays after the run with
+** the final counts and `state` set to SF_FINISHED.
+**
+** Readers mmap() it read-only and never block the writer: a block is under
+** a seqlock whose `seq` is odd while the block is being written. Copy the
+** block between two reads of `seq` (acquire) and retry unless both read the
+** same even value. The run's totals are the sums over the blocks; min and
+** max are the smallest and largest of the blocks that have replies.
+**
+** The histogram is the one behind ft_ping's percentiles: bucket i < 2^S
+** holds the value i (ns), then every power of two is split into 2^(S-1)
+** linear sub-buckets, S = hist_sub_bits. Values are host byte order.
+**
+** A new field goes into reserved space and keeps SF_VERSION; moving or
+** resizing an existing one bumps it.
+*/
+
+#define SF_MAGIC      "FTPINGS\0"
+#define SF_VERSION    1
+#define SF_ICMP_TYPES 19               /* ICMP types 0 to 18 */
+#define SF_PERIOD_NS  100000000ULL     /* 100 ms */
+
+typedef enum e_sf_state {
+    SF_RUNNING = 1,
+    SF_FINISHED
+} t_sf_state;
+
+typedef struct s_sf_header {
+    char     magic[8];        /* SF_MAGIC */
+    uint32_t version;         /* SF_VERSION */
+    uint32_t header_size;     /* offset of the first block */
+    uint32_t block_size;      /* distance between blocks */
+    uint32_t nblocks;
+    uint32_t hist_buckets;    /* entries in t_sf_block.hist */
+    uint32_t hist_sub_bits;
+    uint32_t pid;
+    uint32_t ntargets;
+    uint32_t state;           /* t_sf_state, written last */
+    uint32_t reserved0;
+    uint64_t start_ns;        /* CLOCK_REALTIME when the run started */
+    uint8_t  reserved[8];
+} t_sf_header;
+
+typedef struct s_sf_block {
+    uint64_t seq;             /* seqlock: odd while the block is written */
+    uint64_t update_ns;       /* CLOCK_REALTIME of this snapshot */
+    uint64_t tx;
+    uint64_t rx;
+    uint64_t dup;
+    uint64_t reorder;
+    uint64_t late;
+    uint64_t timeouts;
+    int64_t  min_ns;          /* min_ns and max_ns are -1 before the first reply */
+    int64_t  max_ns;
+    double   mean_ns;
+    double   mdev_ns;
+    uint64_t errors[SF_ICMP_TYPES];   /* ICMP errors about our probes, by type */
+    uint64_t hist_total;
+    uint8_t  reserved[16];
+    uint64_t hist[];          /* hist_buckets counts */
+} t_sf_block;
+
+#endif
@@ -58,6 +58,7 @@ void handle_size(const char *val) {
         ping_fatal(MSG_ERR_INVALID_SIZE, val);
 
     flags.payload_size = (int) size;
+    flags.size_set = 1;
 }
 
 void handle_timeout(const char *val) {
@@ -79,11 +80,180 @@ void handle_interval(const char *val) {
     if (isnan(d) || isinf(d))
         ping_fatal(MSG_ERR_INVALID_INTERVAL, val);
 
-    if (d < 0.002 && d != 0.0) /* Safety limit for non-flood */
-        ping_fatal(MSG_ERR_INTERVAL_SHORT, val);
+    /* Safety limit for non-flood; checked once all options are known */
+    flags.interval_short = (d < 0.002 && d != 0.0) ? val : NULL;
 
     if (d > INT_MAX / 1000.0)
         ping_fatal(MSG_ERR_INVALID_INTERVAL, val);
 
-    flags.interval_ms = (int) (d * 1000.0);
+    flags.interval_ns = llround(d * (double) NS_PER_SEC);
+    flags.interval_set = 1;
+}
+
+void handle_wait(const char *val) {
+    if (!ft_str_is_double(val))
+        ping_fatal(MSG_ERR_INVALID_WAIT, val);
+
+    double d = ft_atof(val);
+
+    if (isnan(d) || isinf(d) || d <= 0.0 || d > INT_MAX / 1000.0)
+        ping_fatal(MSG_ERR_INVALID_WAIT, val);
+
+    flags.wait_ms = (int) (d * 1000.0);
+    if (flags.wait_ms == 0)
+        flags.wait_ms = 1;
+}
+
+void handle_rto(const char *val) {
+    (void) val;
+    flags.rto = 1;
+}
+
+void handle_pmtu(const char *val) {
+    (void) val;
+    flags.pmtu = 1;
+}
+
+void handle_sweep(const char *val) {
+    const long long n = parse_ll_or_fatal(val, MSG_ERR_INVALID_SWEEP);
+
+    if (n < 1 || n > SWEEP_HOPS_MAX)
+        ping_fatal(MSG_ERR_INVALID_SWEEP, val);
+    flags.sweep = (int) n;
+}
+
+void handle_multi(const char *val) {
+    (void) val;
+    flags.multi = 1;
+}
+
+void handle_file(const char *val) {
+    flags.multi = 1;
+    flags.targets_file = val;
+}
+
+void handle_stats_file(const char *val) {
+    flags.stats_file = val;
+}
+
+void handle_flood(const char *val) {
+    (void) val;
+    flags.flood = 1;
+}
+
+void handle_kernel_ts(const char *val) {
+    (void) val;
+    flags.kernel_ts = 1;
+}
+
+void handle_no_filter(const char *val) {
+    (void) val;
+    flags.no_filter = 1;
+}
+
+void handle_transport(const char *val) {
+    if (ft_strcmp(val, "auto") == 0)
+        flags.transport = TRANSPORT_AUTO;
+    else if (ft_strcmp(val, "raw") == 0)
+        flags.transport = TRANSPORT_RAW;
+    else if (ft_strcmp(val, "dgram") == 0)
+        flags.transport = TRANSPORT_DGRAM;
+    else if (ft_strcmp(val, "sim") == 0)
+        flags.transport = TRANSPORT_SIM;
+    else
+        ping_fatal(MSG_ERR_INVALID_TRANSPORT, val);
+}
+
+/* --sim SPEC: the simulator's network, see sim.c; implies --transport sim */
+void handle_sim(const char *val) {
+    if (sim_configure(val) < 0)
+        ping_fatal(MSG_ERR_INVALID_SIM, val);
+    flags.transport = TRANSPORT_SIM;
+}
+
+void handle_threads(const char *val) {
+    const long long n = parse_ll_or_fatal(val, MSG_ERR_INVALID_THREADS);
+
+    if (n < 1 || n > WORKERS_MAX)
+        ping_fatal(MSG_ERR_INVALID_THREADS, val);
+    flags.threads = (int) n;
+}
+
+void handle_io(const char *val) {
+    if (ft_strcmp(val, "epoll") == 0)
+        flags.io = IO_EPOLL;
+    else if (ft_strcmp(val, "uring") == 0)
+        flags.io = IO_URING;
+    else
+        ping_fatal(MSG_ERR_INVALID_IO, val);
+}
+
+void handle_rx_ring(const char *val) {
+    (void) val;
+    flags.rx_ring = 1;
+}
+
+void handle_rate(const char *val) {
+    if (!ft_str_is_double(val))
+        ping_fatal(MSG_ERR_INVALID_RATE, val);
+
+    double d = ft_atof(val);
+
+    if (isnan(d) || isinf(d) || d <= 0.0 || d > (double) NS_PER_SEC)
+        ping_fatal(MSG_ERR_INVALID_RATE, val);
+    flags.rate = d;
+}
+
+void handle_burst(const char *val) {
+    const long long n = parse_ll_or_fatal(val, MSG_ERR_INVALID_BURST);
+
+    if (n < 1 || n > PACE_BURST_MAX)
+        ping_fatal(MSG_ERR_INVALID_BURST, val);
+    flags.burst = (int) n;
+}
+
+void handle_resolve_limit(const char *val) {
+    const long long n = parse_ll_or_fatal(val, MSG_ERR_INVALID_RESOLVE_LIMIT);
+
+    if (n < 1 || n > RESOLVE_LIMIT_MAX)
+        ping_fatal(MSG_ERR_INVALID_RESOLVE_LIMIT, val);
+    flags.resolve_limit = (int) n;
+}
+
+void handle_resolve_ttl(const char *val) {
+    if (!ft_str_is_double(val))
+        ping_fatal(MSG_ERR_INVALID_RESOLVE_TTL, val);
+
+    double d = ft_atof(val);
+
+    if (isnan(d) || isinf(d) || d < 0.0 || d > (double) INT32_MAX)
+        ping_fatal(MSG_ERR_INVALID_RESOLVE_TTL, val);
+    flags.resolve_ttl_ns = llround(d * (double) NS_PER_SEC);
+}
+
+void handle_summary(const char *val) {
+    const long long n = parse_ll_or_fatal(val, MSG_ERR_INVALID_SUMMARY);
+
+    if (n < 1 || n > WINDOW_MAX)
+        ping_fatal(MSG_ERR_INVALID_SUMMARY, val);
+    flags.summary_s = (int) n;
+}
+
+void handle_window(const char *val) {
+    const long long n = parse_ll_or_fatal(val, MSG_ERR_INVALID_WINDOW);
+
+    if (n < 1 || n > WINDOW_MAX)
+        ping_fatal(MSG_ERR_INVALID_WINDOW, val);
+    flags.window_s = (int) n;
+}
+
+void handle_format(const char *val) {
+    if (ft_strcmp(val, "text") == 0)
+        flags.format = FORMAT_TEXT;
+    else if (ft_strcmp(val, "jsonl") == 0)
+        flags.format = FORMAT_JSONL;
+    else if (ft_strcmp(val, "binary") == 0)
+        flags.format = FORMAT_BINARY;
+    else
+        ping_fatal(MSG_ERR_INVALID_FORMAT, val);
 }
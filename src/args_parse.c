@@ -1,6 +1,7 @@
 #include "ft_ping.h"
 #include "ft_messages.h"
 #include "libft/libft.h"
+#include <math.h>
 
 
 static int match_long(const char *arg, const t_ping_opt *opt, char **val_out) {
@@ -34,25 +35,27 @@ static int match_long(const char *arg, const t_ping_opt *opt, char **val_out) {
 /* --- Main Engine --- */
 
 void parse_args(int argc, char **argv) {
-    flags = (t_flags){.interval_ms = 1000, .ttl = 64, .payload_size = 56, .timeout = 1000, .count = -1};
-    target = NULL;
+    flags = (t_flags){.interval_ns = NS_PER_SEC, .ttl = 64, .payload_size = 56, .timeout = 1000, .count = -1,
+                     .wait_ms = 10000, .resolve_limit = RESOLVE_LIMIT_DEFAULT,
+                     .resolve_ttl_ns = RESOLVE_TTL_DEFAULT};
+    g_ntargets = 0;
 
     for (int i = 1; i < argc; ++i) {
         char *arg = argv[i];
 
         /* 1. Positional */
         if (arg[0] != '-' || arg[1] == '\0') {
-            if (target) {
-                ping_fatal(MSG_ERR_MULTIPLE_DEST, arg);
-            }
-            target = arg;
+            target_add(arg);
             continue;
         }
 
         /* 2. Terminator */
         if (ft_strcmp(arg, "--") == 0) {
             i++;
-            if (i < argc && !target) target = argv[i++];
+            if (flags.multi) {
+                while (i < argc) target_add(argv[i++]);
+            }
+            if (i < argc && g_ntargets == 0) target_add(argv[i++]);
             if (i < argc) {
                 ping_fatal(MSG_ERR_UNEXPECTED_ARG, argv[i]);
             }
@@ -122,7 +125,53 @@ void parse_args(int argc, char **argv) {
         }
     }
 
-    if (!target) {
+    /* Several destinations are only accepted in multi-target mode */
+    if (g_ntargets > 1 && !flags.multi) {
+        ping_fatal(MSG_ERR_MULTIPLE_DEST, g_targets[1].name);
+    }
+    if (flags.targets_file) targets_load_file(flags.targets_file);
+
+    if (flags.rate > 0 && flags.interval_set) ping_fatal(MSG_ERR_RATE_INTERVAL);
+    if (flags.interval_short && !flags.flood) {
+        ping_fatal(MSG_ERR_INTERVAL_SHORT, flags.interval_short);
+    }
+    /* --rate is over all targets: each one is probed every targets/rate seconds */
+    if (flags.rate > 0) {
+        flags.interval_ns = llround((double) g_ntargets * (double) NS_PER_SEC / flags.rate);
+        if (flags.interval_ns == 0) flags.interval_ns = 1;
+        flags.interval_set = 1;
+    }
+    /* Flood without -i: send as fast as replies come back */
+    if (flags.flood && !flags.interval_set) flags.interval_ns = 0;
+    if (flags.flood && flags.threads > 1) ping_fatal(MSG_ERR_THREADS_FLOOD);
+    if (flags.io == IO_URING && flags.threads > 1) ping_fatal(MSG_ERR_IO_THREADS);
+    if (flags.rx_ring && flags.threads > 1) ping_fatal(MSG_ERR_RXRING_THREADS);
+    if (flags.io == IO_URING && flags.transport == TRANSPORT_SIM) ping_fatal(MSG_ERR_SIM_URING);
+    if (flags.window_s && !flags.summary_s) ping_fatal(MSG_ERR_WINDOW_SUMMARY);
+    if (!flags.window_s) flags.window_s = flags.summary_s;
+    /* --pmtu runs its own rounds against one target on the epoll loop */
+    if (flags.pmtu) {
+        if (g_ntargets > 1) ping_fatal(MSG_ERR_PMTU_WITH, "several destinations");
+        if (flags.flood) ping_fatal(MSG_ERR_PMTU_WITH, "flood mode");
+        if (flags.threads > 1) ping_fatal(MSG_ERR_PMTU_WITH, "--threads");
+        if (flags.io == IO_URING) ping_fatal(MSG_ERR_PMTU_WITH, "--io uring");
+        if (flags.rx_ring) ping_fatal(MSG_ERR_PMTU_WITH, "--rx-ring");
+        if (flags.summary_s) ping_fatal(MSG_ERR_PMTU_WITH, "--summary");
+        if (flags.size_set && flags.payload_size + 28 < PMTU_MIN) ping_fatal(MSG_ERR_PMTU_WITH, "-s below 40");
+    }
+    /* --sweep too; its rounds come every -i */
+    if (flags.sweep) {
+        if (g_ntargets > 1) ping_fatal(MSG_ERR_SWEEP_WITH, "several destinations");
+        if (flags.flood) ping_fatal(MSG_ERR_SWEEP_WITH, "flood mode");
+        if (flags.threads > 1) ping_fatal(MSG_ERR_SWEEP_WITH, "--threads");
+        if (flags.io == IO_URING) ping_fatal(MSG_ERR_SWEEP_WITH, "--io uring");
+        if (flags.rx_ring) ping_fatal(MSG_ERR_SWEEP_WITH, "--rx-ring");
+        if (flags.summary_s) ping_fatal(MSG_ERR_SWEEP_WITH, "--summary");
+        if (flags.rate > 0) ping_fatal(MSG_ERR_SWEEP_WITH, "--rate");
+        if (flags.pmtu) ping_fatal(MSG_ERR_SWEEP_WITH, "--pmtu");
+    }
+
+    if (g_ntargets == 0) {
         ping_msg(MSG_ERR_DEST_REQ);
         ft_usage(1);
     }
@@ -0,0 +1,252 @@
+#include "ft_ping.h"
+#include "libft/libft.h"
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <immintrin.h>
+# define CSUM_X86 1
+#endif
+
+/*
+** Function: checksum
+** ------------------
+** Calculates the 16-bit One's Complement checksum for ICMP/IP headers.
+**
+** This implementation is designed for safety and portability:
+** 1. Alignment Safety: Instead of casting `void *data` directly to `uint16_t*`
+** (which causes undefined behavior or SIGBUS on non-aligned memory on
+** strict architectures like ARM/SPARC), we use `ft_memcpy` to copy
+** bytes into a local `uint16_t` variable.
+** 2. Endianness: The logic handles both Big and Little Endian architectures
+** correctly by processing the buffer as a stream of bytes.
+**
+** @param data  Pointer to the buffer to checksum.
+** @param len   Length of the buffer in bytes.
+**
+** @return      The 1's complement of the 1's complement sum (network byte order).
+*/
+uint16_t checksum(void *b, int len) {
+    unsigned char *buf = b;
+    unsigned int sum = 0;
+    uint16_t word;
+
+    while (len > 1) {
+        ft_memcpy(&word, buf, 2);
+        sum += word;
+        buf += 2;
+        len -= 2;
+    }
+
+    if (len == 1) {
+        word = 0;
+        ft_memcpy(&word, buf, 1);
+        sum += word;
+    }
+
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+
+    return (uint16_t) (~sum);
+}
+
+/*
+** Fast one's complement sums
+** --------------------------
+** All kernels below return a running (unfolded, uncomplemented) sum that
+** folds to the same 16 bits as checksum(): a one's complement sum can be
+** accumulated in words of any width as long as carries wrap around.
+**
+** - ref:   16 bits at a time, the portable reference.
+** - word64: 8 bytes at a time with end-around carry.
+** - sse2/avx2: 16/32 bytes per step, words widened to 32-bit lanes.
+**
+** csum_partial() picks the best kernel the CPU supports on first use and
+** keeps short buffers on word64.
+** Loads go through memcpy()/loadu so any alignment is fine; the fixed-size
+** memcpy() compiles down to a single load.
+*/
+
+static uint32_t fold64(uint64_t acc) {
+    acc = (acc & 0xFFFFFFFF) + (acc >> 32);
+    acc = (acc & 0xFFFFFFFF) + (acc >> 32);
+    return (uint32_t) acc;
+}
+
+static uint32_t csum_ref(const void *b, size_t len, uint32_t sum) {
+    const unsigned char *buf = b;
+    uint64_t acc = sum;
+    uint16_t word;
+
+    while (len > 1) {
+        ft_memcpy(&word, buf, 2);
+        acc += word;
+        buf += 2;
+        len -= 2;
+    }
+
+    if (len == 1) {
+        word = 0;
+        ft_memcpy(&word, buf, 1);
+        acc += word;
+    }
+    return fold64(acc);
+}
+
+static inline uint64_t add_carry(uint64_t acc, uint64_t w) {
+    acc += w;
+    return acc + (acc < w);
+}
+
+static uint32_t csum_word64(const void *b, size_t len, uint32_t sum) {
+    const unsigned char *p = b;
+    uint64_t acc = sum;
+    uint64_t w0, w1, w2, w3;
+
+    while (len >= 32) {
+        memcpy(&w0, p, 8);
+        memcpy(&w1, p + 8, 8);
+        memcpy(&w2, p + 16, 8);
+        memcpy(&w3, p + 24, 8);
+        acc = add_carry(acc, w0);
+        acc = add_carry(acc, w1);
+        acc = add_carry(acc, w2);
+        acc = add_carry(acc, w3);
+        p += 32;
+        len -= 32;
+    }
+    while (len >= 8) {
+        memcpy(&w0, p, 8);
+        acc = add_carry(acc, w0);
+        p += 8;
+        len -= 8;
+    }
+    /* The tail starts on a word boundary, so it keeps its byte positions */
+    if (len) {
+        w0 = 0;
+        memcpy(&w0, p, len);
+        acc = add_carry(acc, w0);
+    }
+    return fold64(acc);
+}
+
+#ifdef CSUM_X86
+
+/* Each step adds at most 2 * 0xFFFF per 32-bit lane: flush well before overflow */
+#define SIMD_FLUSH_STEPS 16384
+
+__attribute__((target("sse2")))
+static uint32_t csum_sse2(const void *b, size_t len, uint32_t sum) {
+    const unsigned char *p = b;
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t acc = sum;
+
+    while (len >= 16) {
+        size_t steps = len / 16;
+        if (steps > SIMD_FLUSH_STEPS)
+            steps = SIMD_FLUSH_STEPS;
+
+        __m128i vacc = zero;
+        for (size_t i = 0; i < steps; i++) {
+            const __m128i v = _mm_loadu_si128((const __m128i *) p);
+            vacc = _mm_add_epi32(vacc, _mm_unpacklo_epi16(v, zero));
+            vacc = _mm_add_epi32(vacc, _mm_unpackhi_epi16(v, zero));
+            p += 16;
+        }
+        len -= steps * 16;
+
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i *) lanes, vacc);
+        acc += (uint64_t) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    return csum_word64(p, len, fold64(acc));
+}
+
+__attribute__((target("avx2")))
+static uint32_t csum_avx2(const void *b, size_t len, uint32_t sum) {
+    const unsigned char *p = b;
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t acc = sum;
+
+    while (len >= 32) {
+        size_t steps = len / 32;
+        if (steps > SIMD_FLUSH_STEPS)
+            steps = SIMD_FLUSH_STEPS;
+
+        __m256i vacc = zero;
+        for (size_t i = 0; i < steps; i++) {
+            const __m256i v = _mm256_loadu_si256((const __m256i *) p);
+            vacc = _mm256_add_epi32(vacc, _mm256_unpacklo_epi16(v, zero));
+            vacc = _mm256_add_epi32(vacc, _mm256_unpackhi_epi16(v, zero));
+            p += 32;
+        }
+        len -= steps * 32;
+
+        uint32_t lanes[8];
+        _mm256_storeu_si256((__m256i *) lanes, vacc);
+        for (int i = 0; i < 8; i++)
+            acc += lanes[i];
+    }
+    return csum_word64(p, len, fold64(acc));
+}
+
+static int has_sse2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+
+static int has_avx2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+static int always(void) {
+    return 1;
+}
+
+/* Best kernel first; NULL-terminated like g_options */
+const t_csum_impl g_csum_impls[] = {
+#ifdef CSUM_X86
+    { "avx2",   csum_avx2,   has_avx2 },
+    { "sse2",   csum_sse2,   has_sse2 },
+#endif
+    { "word64", csum_word64, always },
+    { "ref",    csum_ref,    always },
+    { NULL, NULL, NULL }
+};
+
+static t_csum_fn g_csum_fn = NULL;
+
+static t_csum_fn csum_select(void) {
+    for (int i = 0; g_csum_impls[i].name; i++) {
+        if (g_csum_impls[i].supported())
+            return g_csum_impls[i].fn;
+    }
+    return csum_ref;
+}
+
+/*
+** Function: csum_partial
+** ----------------------
+** Adds `data` to a running (unfolded, uncomplemented) one's complement sum.
+** Sums of separate buffers can be combined as long as every buffer but the
+** last has an even length.
+*/
+uint32_t csum_partial(const void *data, size_t len, uint32_t sum) {
+    /* Vector setup does not pay off for headers and timestamps */
+    if (len < 64)
+        return csum_word64(data, len, sum);
+    if (!g_csum_fn)
+        g_csum_fn = csum_select();
+    return g_csum_fn(data, len, sum);
+}
+
+/* Folds a running sum to 16 bits and complements it */
+uint16_t csum_fold(uint32_t sum) {
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t) (~sum);
+}
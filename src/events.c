@@ -0,0 +1,59 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+struct timespec ns_to_timespec(uint64_t ns) {
+    return (struct timespec){.tv_sec = (time_t) (ns / NS_PER_SEC), .tv_nsec = (long) (ns % NS_PER_SEC)};
+}
+
+/* Arms a CLOCK_MONOTONIC timerfd; `interval` may be zero for one-shot timers */
+int timer_open(int abs, const struct timespec *value, const struct timespec *interval) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0)
+        ping_fatal(MSG_ERR_TIMERFD, strerror(errno));
+
+    struct itimerspec its = {.it_value = *value, .it_interval = *interval};
+    if (timerfd_settime(fd, abs ? TFD_TIMER_ABSTIME : 0, &its, NULL) < 0)
+        ping_fatal(MSG_ERR_TIMERFD, strerror(errno));
+    return fd;
+}
+
+void epoll_watch(int epfd, int fd) {
+    struct epoll_event ev = {.events = EPOLLIN, .data.fd = fd};
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        ping_fatal(MSG_ERR_EPOLL, strerror(errno));
+}
+
+/* Drains a timerfd, returns the number of expirations since the last read */
+uint64_t timer_drain(int fd) {
+    uint64_t expirations = 0;
+    g_io_syscalls++;
+    if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        return 0;
+    return expirations;
+}
+
+/*
+** Reads a signal off the signalfd. SIGQUIT prints the status line and the
+** run goes on; returns 1 when the run must stop (SIGINT).
+*/
+int signal_read(int sig_fd) {
+    struct signalfd_siginfo si;
+
+    if (read(sig_fd, &si, sizeof(si)) != sizeof(si))
+        return 0;
+    if (si.ssi_signo == SIGQUIT) {
+        print_status();
+        return 0;
+    }
+    if (flags.format == FORMAT_TEXT)
+        out_write("\n", 1);
+    return 1;
+}
@@ -0,0 +1,76 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+#include <netinet/ip_icmp.h>
+
+/*
+** Socket filter (SO_ATTACH_FILTER)
+** --------------------------------
+** A raw ICMP socket gets a copy of every ICMP packet the host receives,
+** including the replies of every other ping running on it. This classic
+** BPF program runs in the kernel before the packet is queued and keeps
+** only what pkt_parse_raw() would look at:
+**
+**   - echo replies whose id is ours
+**   - time exceeded / destination unreachable errors whose embedded
+**     original ICMP header carries our id (the handle_error_packet() check)
+**
+** The packet starts at the IP header. X holds the outer header length,
+** then outer + inner header length for the embedded request. Loads past
+** the end of the packet abort the program, which drops it.
+**
+** A packet socket (--rx-ring) gets every IP packet, not only ICMP: with
+** `check_proto` two more instructions drop anything else first.
+*/
+
+#define ACCEPT 0xFFFFFFFFU
+#define PROTO_CHECK_LEN 2
+
+static int attach(int sock, struct sock_filter *code, size_t len) {
+    const struct sock_fprog prog = {.len = (unsigned short) len, .filter = code};
+
+    if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0) {
+        ping_msg(MSG_ERR_SETSOCKOPT_FILTER, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int filter_attach(int sock, int ident, int check_proto) {
+    const uint16_t id = (uint16_t) (ident & 0xFFFF);
+    struct sock_filter code[] = {
+        /* IP protocol check, skipped unless check_proto */
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 9),                       /* A = ip protocol */
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_ICMP, 0, 15),      /* else to 15: drop */
+        /* 0 */ BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),               /* X = outer IHL * 4 */
+        /* 1 */ BPF_STMT(BPF_LD | BPF_B | BPF_IND, 0),                /* A = icmp type */
+        /* 2 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_ECHOREPLY, 0, 2),
+        /* 3 */ BPF_STMT(BPF_LD | BPF_H | BPF_IND, 4),                /* A = icmp id */
+        /* 4 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, id, 9, 10),
+        /* 5 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_DEST_UNREACH, 1, 0),
+        /* 6 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_TIME_EXCEEDED, 0, 8),
+        /* 7 */ BPF_STMT(BPF_LD | BPF_B | BPF_IND, 8),                /* A = inner ver/IHL */
+        /* 8 */ BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0x0F),
+        /* 9 */ BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 2),
+        /* 10 */ BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+        /* 11 */ BPF_STMT(BPF_MISC | BPF_TAX, 0),                     /* X = outer + inner IHL */
+        /* 12 */ BPF_STMT(BPF_LD | BPF_H | BPF_IND, 8 + 4),           /* A = original icmp id */
+        /* 13 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, id, 0, 1),
+        /* 14 */ BPF_STMT(BPF_RET | BPF_K, ACCEPT),
+        /* 15 */ BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+    const size_t skip = check_proto ? 0 : PROTO_CHECK_LEN;
+
+    return attach(sock, code + skip, sizeof(code) / sizeof(code[0]) - skip);
+}
+
+/* Keeps a socket from queueing anything: replies are read elsewhere */
+int filter_drop_all(int sock) {
+    struct sock_filter code[] = {BPF_STMT(BPF_RET | BPF_K, 0)};
+
+    return attach(sock, code, 1);
+}
@@ -1,13 +1,30 @@
 #include "ft_ping.h"
+#include "ft_instr.h"
 #include <stddef.h>
 
 // definitions (storage) for the globals declared as extern in `ft_ping.h`
 t_flags flags = {0};
-struct sockaddr_in dest_addr = {0};
 volatile sig_atomic_t should_stop = 0;
-char *target = NULL;
 
-t_stats g_stats = {0, 0, 0.0, 0.0, 0.0, 0.0, {0, 0}};
+static _Thread_local t_hist g_hist;
+_Thread_local t_stats g_stats;
+_Thread_local long g_rx_reads = 0;
+_Thread_local long g_io_syscalls = 0;
+_Thread_local long g_icmp_errors[ICMP_TYPES];
+_Thread_local t_kts_stats g_kts;
+
+/* The address of a thread-local is only known at run time */
+void stats_thread_init(void) {
+    g_stats.hist = &g_hist;
+    instr_thread_init();
+}
+
+t_target *g_targets = NULL;
+size_t g_ntargets = 0;
+size_t g_targets_failed = 0;
+
+t_rxring_stats g_rxring_stats = {0};
+_Thread_local t_probe g_probes[PROBE_MAP_SIZE];
 
 const t_ping_opt g_options[] = {
     { "verbose",  'v', ARG_NONE, handle_verbose,  "verbose output", NULL },
@@ -16,7 +33,29 @@ const t_ping_opt g_options[] = {
     { "ttl",       0,  ARG_REQ,  handle_ttl,      "define time to live", "N" },
     { "count",    'c', ARG_REQ,  handle_count,    "stop after <N> replies", "N" },
     { "interval", 'i', ARG_REQ,  handle_interval, "wait <SEC> seconds", "SEC" },
+    { "flood",    'f', ARG_NONE, handle_flood,    "flood ping", NULL },
+    { "rate",      0,  ARG_REQ,  handle_rate,     "send <PPS> probes per second in all", "PPS" },
+    { "burst",     0,  ARG_REQ,  handle_burst,    "send up to <N> late probes at once", "N" },
+    { "kernel-ts", 0,  ARG_NONE, handle_kernel_ts, "also report kernel-timestamped RTT", NULL },
+    { "no-filter", 0,  ARG_NONE, handle_no_filter, "read every ICMP packet (no socket filter)", NULL },
+    { "transport", 0,  ARG_REQ,  handle_transport, "socket type: raw, dgram, sim or auto", "TYPE" },
+    { "sim",       0,  ARG_REQ,  handle_sim,      "simulate the network: delay=MS,loss=PCT,...", "SPEC" },
+    { "threads",   0,  ARG_REQ,  handle_threads,  "probe with <N> worker threads", "N" },
+    { "io",        0,  ARG_REQ,  handle_io,       "event loop: epoll or uring", "TYPE" },
+    { "rx-ring",   0,  ARG_NONE, handle_rx_ring,  "read replies from a packet ring (AF_PACKET)", NULL },
+    { "format",    0,  ARG_REQ,  handle_format,   "output: text, jsonl or binary records", "FMT" },
     { "size",     's', ARG_REQ,  handle_size,     "data size", "N" },
     { "timeout",  'w', ARG_REQ,  handle_timeout,  "timeout", "N" },
+    { "linger",   'W', ARG_REQ,  handle_wait,     "time to wait for a response", "SEC" },
+    { "rto",       0,  ARG_NONE, handle_rto,      "give up on a probe after an adaptive timeout (at most -W)", NULL },
+    { "pmtu",      0,  ARG_NONE, handle_pmtu,     "find the path MTU (-s: largest data size to try)", NULL },
+    { "sweep",     0,  ARG_REQ,  handle_sweep,    "probe every hop up to TTL <N> at once, -c rounds", "N" },
+    { "multi",     0,  ARG_NONE, handle_multi,    "ping every destination given", NULL },
+    { "resolve-limit", 0, ARG_REQ, handle_resolve_limit, "look up at most <N> host names at once", "N" },
+    { "resolve-ttl",   0, ARG_REQ, handle_resolve_ttl,   "look host names up again every <SEC> seconds (0: never)", "SEC" },
+    { "file",      0,  ARG_REQ,  handle_file,     "read destinations from <FILE>", "FILE" },
+    { "stats-file", 0, ARG_REQ,  handle_stats_file, "keep live statistics in <FILE> (mmap)", "FILE" },
+    { "summary",   0,  ARG_REQ,  handle_summary,  "print the latest statistics every <SEC> seconds", "SEC" },
+    { "window",    0,  ARG_REQ,  handle_window,   "seconds those cover (default: --summary)", "SEC" },
     { NULL, 0, ARG_NONE, NULL, NULL, NULL }
 };
@@ -0,0 +1,84 @@
+#include "ft_ping.h"
+#include "libft/libft.h"
+
+/*
+** Latency histogram
+** -----------------
+** Log-bucketed in the style of HdrHistogram: values below 128 ns get a
+** bucket each, above that every power of two is split into 64 linear
+** sub-buckets, so any recorded value is known to within 1/64 (~1.6%).
+** Recording is a count-leading-zeros and an increment, memory is a fixed
+** HIST_BUCKETS counters however many probes are recorded, and the 64-bit
+** counts do not overflow for any realistic run.
+*/
+
+#define HIST_HALF (1u << (HIST_SUB_BITS - 1))
+
+static size_t hist_index(uint64_t v) {
+    if (v >= HIST_MAX_VALUE)
+        return HIST_BUCKETS - 1;
+    if (v < (1u << HIST_SUB_BITS))
+        return (size_t) v;
+
+    const unsigned msb = 63u - (unsigned) __builtin_clzll(v);
+    const unsigned shift = msb - (HIST_SUB_BITS - 1);
+    return (size_t) shift * HIST_HALF + (size_t) (v >> shift);
+}
+
+/* Midpoint of the range of values that land in bucket `idx` */
+static uint64_t hist_value(size_t idx) {
+    if (idx < (1u << HIST_SUB_BITS))
+        return idx;
+
+    const unsigned shift = (unsigned) (idx / HIST_HALF) - 1;
+    const uint64_t sub = idx % HIST_HALF + HIST_HALF;
+    return (sub << shift) + ((1ULL << shift) >> 1);
+}
+
+void hist_record(t_hist *h, int64_t value) {
+    h->counts[hist_bucket(value)]++;
+    h->total++;
+}
+
+/* Index of the bucket `value` falls in, for counts kept elsewhere (window.c) */
+size_t hist_bucket(int64_t value) {
+    return hist_index(value < 0 ? 0 : (uint64_t) value);
+}
+
+void hist_merge(t_hist *dst, const t_hist *src) {
+    for (size_t i = 0; i < HIST_BUCKETS; i++)
+        dst->counts[i] += src->counts[i];
+    dst->total += src->total;
+}
+
+/* Value at quantile q (0..1); 0 for an empty histogram */
+int64_t hist_percentile(const t_hist *h, double q) {
+    if (h->total == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t) (q * (double) h->total + 0.5);
+    if (rank < 1)
+        rank = 1;
+    if (rank > h->total)
+        rank = h->total;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank)
+            return (int64_t) hist_value(i);
+    }
+    return (int64_t) hist_value(HIST_BUCKETS - 1);
+}
+
+/* Percentiles are bucket midpoints: keep them within the exact extremes */
+int64_t hist_clamp(int64_t v, int64_t lo, int64_t hi) {
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+/* Value at quantile q of `s`'s RTTs, never outside its min and max */
+int64_t stats_percentile(const t_stats *s, double q) {
+    if (!s->hist || s->hist->total == 0)
+        return 0;
+    return hist_clamp(hist_percentile(s->hist, q), s->min, s->max);
+}
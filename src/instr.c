@@ -0,0 +1,81 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "ft_instr.h"
+
+#ifdef FT_INSTRUMENT
+
+/*
+** Per-thread counters (ft_instr.h)
+** --------------------------------
+** The counters live in a static array rather than in thread-local storage
+** so a worker's are still there to print after it has exited. A thread
+** claims a slot the first time it calls instr_thread_init(); until then,
+** and once the slots run out, it counts into the shared slot 0.
+*/
+
+#define INSTR_SLOTS (WORKERS_MAX + 2)
+
+static t_instr g_slots[INSTR_SLOTS];
+static _Atomic int g_nslots = 1;
+_Thread_local t_instr *g_instr = &g_slots[0];
+
+/* Where the tick counter and the clock were when counting started */
+static uint64_t g_ticks0 = 0;
+static uint64_t g_ns0 = 0;
+
+static const char *g_stage_names[STAGE_COUNT] = {
+    [STAGE_BUILD] = "build", [STAGE_CHECKSUM] = "checksum", [STAGE_SEND] = "send",
+    [STAGE_WAIT] = "wait", [STAGE_RECV] = "recv", [STAGE_PARSE] = "parse",
+    [STAGE_STATS] = "stats", [STAGE_OUTPUT] = "output"
+};
+
+void instr_thread_init(void) {
+    static _Thread_local int claimed = 0;
+
+    if (claimed)
+        return;
+    claimed = 1;
+    if (!g_ns0) {
+        g_ns0 = now_ns();
+        g_ticks0 = INSTR_TICKS();
+    }
+
+    const int k = atomic_fetch_add_explicit(&g_nslots, 1, memory_order_relaxed);
+    if (k < INSTR_SLOTS)
+        g_instr = &g_slots[k];
+}
+
+static uint64_t load(const uint64_t *counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+/* Every thread's counters added up; safe while the workers run */
+void instr_print(void) {
+    t_instr sum = {0};
+    int n = atomic_load_explicit(&g_nslots, memory_order_relaxed);
+
+    if (n > INSTR_SLOTS)
+        n = INSTR_SLOTS;
+    for (int k = 0; k < n; k++) {
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            sum.count[s] += load(&g_slots[k].count[s]);
+            sum.ticks[s] += load(&g_slots[k].ticks[s]);
+        }
+        for (int d = 0; d < DROP_COUNT; d++)
+            sum.drops[d] += load(&g_slots[k].drops[d]);
+    }
+
+    const uint64_t ticks = INSTR_TICKS() - g_ticks0;
+    const double ns_per_tick = ticks ? (double) (now_ns() - g_ns0) / (double) ticks : 1.0;
+
+    ping_msg(MSG_INSTR_HEADER);
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const double ns = (double) sum.ticks[s] * ns_per_tick;
+        ping_msg(MSG_INSTR_STAGE, g_stage_names[s], sum.count[s], ns / NS_PER_MS,
+                 sum.count[s] ? ns / (double) sum.count[s] : 0.0);
+    }
+    ping_msg(MSG_INSTR_DROPS, sum.drops[DROP_SHORT], sum.drops[DROP_CHECKSUM],
+             sum.drops[DROP_FOREIGN_ID], sum.drops[DROP_ICMP_TYPE], sum.drops[DROP_UNMATCHED]);
+}
+
+#endif
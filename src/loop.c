@@ -0,0 +1,158 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "ft_instr.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+
+/*
+ * Event loop: the process sleeps in epoll_wait() until either the socket has
+ * data, the send timer ticks, the -w deadline expires or a signal arrives.
+ * The send timer is periodic on the pacer's absolute CLOCK_MONOTONIC
+ * schedule, so sends do not drift no matter how long a wake-up takes to
+ * process; the pacer decides how many probes are due (pacer.c).
+ *
+ * With several targets the interval is split evenly between them and each
+ * tick probes the next target round-robin, so every target is still probed
+ * once per interval but the sends (and replies) are spread out.
+ *
+ * In flood mode every probe due goes out, in one batch. Flooding with no
+ * interval does not use the timer at all: the window of outstanding
+ * probes is refilled as replies drain it.
+ *
+ * With --rx-ring the replies come from the packet ring's socket instead.
+ * Host names still being looked up are collected as their answers arrive.
+ */
+void ping_loop(int sock, int id, int sig_fd) {
+    t_sched sched = {
+        .id = id,
+        .end = g_ntargets,
+        .limit = flags.count > 0 ? (long long) flags.count * (long long) g_ntargets : -1
+    };
+    const int adaptive = flags.flood && flags.interval_ns == 0;
+    t_tx_batch tx;
+    t_rx_batch rx;
+
+    io_batch_init(&tx, &rx, sched.id);
+
+    g_stats.start_ns = now_ns();
+
+    t_pacer pacer;
+    pacer_init(&pacer, now_ns());
+    const struct timespec start = ns_to_timespec(pacer.next_ns);
+    const struct timespec period = ns_to_timespec(pacer.period_ns);
+
+    const struct timespec none = {0, 0};
+    int tick_fd = -1;
+    int deadline_fd = -1;
+    int ring_fd = -1;
+    const int resolve_fd = resolver_fd();
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0)
+        ping_fatal(MSG_ERR_EPOLL, strerror(errno));
+    epoll_watch(epfd, sock);
+    epoll_watch(epfd, sig_fd);
+    if (flags.rx_ring) {
+        ring_fd = rxring_open(sock, sched.id);
+        epoll_watch(epfd, ring_fd);
+    }
+    if (resolve_fd >= 0)
+        epoll_watch(epfd, resolve_fd);
+    if (!adaptive) {
+        tick_fd = timer_open(1, &start, &period);
+        epoll_watch(epfd, tick_fd);
+    }
+
+    /* Handle Timeout (-w): a one-shot timer stops the loop cleanly */
+    if (flags.timeout > 0) {
+        const struct timespec deadline = {.tv_sec = flags.timeout, .tv_nsec = 0};
+        deadline_fd = timer_open(0, &deadline, &none);
+        epoll_watch(epfd, deadline_fd);
+    }
+
+    while (!should_stop) {
+        int wait_ms = -1;
+
+        probes_expire(now_ns());
+        if (!adaptive && pacer_finished(&pacer, &sched, now_ns()))
+            break;
+
+        if (adaptive) {
+            const int done = sched_done(&sched);
+            /* Probes given up on (-W) or refused (ICMP error) no longer hold a window slot */
+            const long outstanding = g_stats.tx - g_stats.rx - g_stats.timeouts - g_stats.errors;
+
+            if (done && outstanding <= 0)
+                break;
+            if (!done && outstanding < FLOOD_WINDOW)
+                send_probes(sock, &sched, &tx, FLOOD_WINDOW - (int) outstanding);
+            wait_ms = FLOOD_WAIT_MS;
+        }
+        out_poll(wait_ms >= 0 ? (uint64_t) wait_ms * NS_PER_MS : pacer.period_ns);
+        statsfile_poll(wait_ms >= 0 ? (uint64_t) wait_ms * NS_PER_MS : pacer.period_ns);
+
+        struct epoll_event events[6];
+        INSTR_START(t_wait);
+        int n = epoll_wait(epfd, events, 6, probes_wait_ms(wait_ms, now_ns()));
+        INSTR_STOP(STAGE_WAIT, t_wait, 1);
+        g_io_syscalls++;
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            ping_fatal(MSG_ERR_EPOLL, strerror(errno));
+        }
+
+        /* Flood: nothing came back in time, send anyway (or give up at the end) */
+        if (n == 0 && adaptive) {
+            if (sched_done(&sched))
+                break;
+            send_probes(sock, &sched, &tx, 1);
+            continue;
+        }
+
+        for (int i = 0; i < n && !should_stop; i++) {
+            int fd = events[i].data.fd;
+
+            if (fd == sock) {
+                /* Error queue first (TX timestamps, dgram ICMP errors), then replies */
+                if (events[i].events & EPOLLERR)
+                    transport_drain_errqueue(sock);
+                recv_packets(sock, sched.id, &rx);
+            } else if (fd == ring_fd) {
+                rxring_drain(sched.id);
+            } else if (fd == tick_fd) {
+                if (timer_drain(tick_fd) == 0)
+                    continue;
+                /* Past the last probe the ticks only time the linger */
+                if (!sched_done(&sched))
+                    pacer_send(&pacer, sock, &sched, &tx);
+            } else if (fd == resolve_fd) {
+                resolver_poll();
+            } else if (fd == deadline_fd) {
+                should_stop = 1;
+            } else if (fd == sig_fd) {
+                if (signal_read(sig_fd))
+                    should_stop = 1;
+            }
+        }
+    }
+
+    if (flags.flood)
+        flood_mark('\n');
+    out_flush();
+    statsfile_flush();
+    io_batch_free(&tx, &rx);
+    close(epfd);
+    if (tick_fd >= 0)
+        close(tick_fd);
+    if (deadline_fd >= 0)
+        close(deadline_fd);
+    if (ring_fd >= 0)
+        rxring_close();
+}
@@ -1,5 +1,6 @@
 #include "ft_ping.h"
 #include "ft_messages.h"
+#include "ft_instr.h"
 #include "libft/libft.h"
 #include <math.h>
 #include <stdarg.h>
@@ -11,7 +12,7 @@
 \*\* The order MUST match the t\_msg\_id enum.
 */
 static const char *g_msg_table[] = {
-    [MSG_USAGE_TITLE] = "Usage: ft_ping [options] <destination>",
+    [MSG_USAGE_TITLE] = "Usage: ft_ping [options] <destination> [destination...]",
     [MSG_ERR_DEST_REQ] = "destination required",
     [MSG_ERR_MULTIPLE_DEST] = "multiple destinations provided: '%s'",
     [MSG_ERR_UNEXPECTED_ARG] = "unexpected argument: '%s'",
@@ -33,44 +34,140 @@ static const char *g_msg_table[] = {
 
     [MSG_ERR_INVALID_INTERVAL] = "invalid interval: '%s'",
     [MSG_ERR_INTERVAL_SHORT] = "interval too short: '%s'",
+    [MSG_ERR_INVALID_WAIT] = "invalid wait time: '%s'",
+    [MSG_ERR_INVALID_TRANSPORT] = "invalid transport: '%s' (raw, dgram, sim or auto)",
+    [MSG_ERR_INVALID_SIM] = "invalid simulator setting: '%s'",
+    [MSG_ERR_SIM_URING] = "--io uring cannot be used with the simulator",
+    [MSG_ERR_INVALID_THREADS] = "invalid thread count: '%s'",
+    [MSG_ERR_THREADS_FLOOD] = "--threads cannot be used with flood mode",
+    [MSG_ERR_THREAD] = "pthread_create: %s",
+    [MSG_ERR_EVENTFD] = "eventfd: %s",
+    [MSG_ERR_INVALID_IO] = "invalid I/O backend: '%s' (epoll or uring)",
+    [MSG_ERR_IO_THREADS] = "--io uring cannot be used with --threads",
+    [MSG_ERR_RXRING_THREADS] = "--rx-ring cannot be used with --threads",
+    [MSG_ERR_INVALID_FORMAT] = "invalid output format: '%s' (text, jsonl or binary)",
+    [MSG_ERR_INVALID_RATE] = "invalid rate: '%s'",
+    [MSG_ERR_INVALID_BURST] = "invalid burst: '%s'",
+    [MSG_ERR_RATE_INTERVAL] = "--rate cannot be used with -i",
+    [MSG_ERR_INVALID_RESOLVE_LIMIT] = "invalid resolver concurrency: '%s'",
+    [MSG_ERR_INVALID_RESOLVE_TTL] = "invalid resolver TTL: '%s'",
+    [MSG_ERR_INVALID_SUMMARY] = "invalid summary interval: '%s'",
+    [MSG_ERR_INVALID_WINDOW] = "invalid summary window: '%s'",
+    [MSG_ERR_WINDOW_SUMMARY] = "--window needs --summary",
+    [MSG_ERR_PMTU_WITH] = "--pmtu cannot be used with %s",
+    [MSG_ERR_INVALID_SWEEP] = "invalid hop count: '%s'",
+    [MSG_ERR_SWEEP_WITH] = "--sweep cannot be used with %s",
 
     [MSG_ERR_INVALID_TYPE] = "invalid type: '%s'",
 
+    [MSG_ERR_TARGETS_FILE] = "%s: %s",
+    [MSG_ERR_STATS_FILE] = "%s: %s",
+    [MSG_ERR_NO_TARGETS] = "no valid destinations",
+    [MSG_ERR_OUT_OF_MEMORY] = "out of memory",
+
     /* runtime/info */
     [MSG_ERR_UNKNOWN_HOST] = "unknown host: %s",
+    [MSG_ERR_RESOLVER] = "getaddrinfo_a: %s",
+    [MSG_RESOLVE_CHANGED] = "%s: address changed to %s",
     [MSG_ERR_SOCKET] = "socket: %s",
     [MSG_ERR_SENDTO] = "sendto: %s",
+    [MSG_PROBES_FULL] = "%d probes in flight: sending waits for replies or -W",
     [MSG_ERR_RECVMSG] = "recvmsg: %s",
-    [MSG_ERR_SETSOCKOPT_TIMEOUT] = "setsockopt(SO_RCVTIMEO): %s",
+    [MSG_ERR_EPOLL] = "epoll: %s",
+    [MSG_ERR_TIMERFD] = "timerfd: %s",
+    [MSG_ERR_SIGNALFD] = "signalfd: %s",
     [MSG_ERR_SETSOCKOPT_TTL] = "setsockopt(IP_TTL): %s",
+    [MSG_ERR_SETSOCKOPT_TSTAMP] = "setsockopt(SO_TIMESTAMPING): %s",
+    [MSG_ERR_SETSOCKOPT_FILTER] = "setsockopt(SO_ATTACH_FILTER): %s",
+    [MSG_ERR_SETSOCKOPT_RECVTTL] = "setsockopt(IP_RECVTTL): %s",
+    [MSG_ERR_SETSOCKOPT_RECVERR] = "setsockopt(IP_RECVERR): %s",
+    [MSG_ERR_SETSOCKOPT_PMTUDISC] = "setsockopt(IP_MTU_DISCOVER): %s",
+    [MSG_ERR_BIND] = "bind: %s",
+    [MSG_TRANSPORT_FALLBACK] = "raw socket: %s, using an ICMP datagram socket",
+    [MSG_DGRAM_GROUP_HINT] = "ICMP datagram sockets are limited to the groups in "
+                             "net.ipv4.ping_group_range (see sysctl)",
+    [MSG_ERR_URING] = "io_uring: %s",
+    [MSG_IO_FALLBACK] = "io_uring: %s, using epoll",
+    [MSG_ERR_PACKET_SOCKET] = "packet socket: %s",
+    [MSG_ERR_RXRING_RAW] = "--rx-ring needs a raw socket",
 
     [MSG_PING_HEADER] = "PING %s (%s): %d data bytes",
-    [MSG_PING_REPLY] = "%ld bytes from %s: icmp_seq=%d ttl=%d time=%.3f ms",
+    [MSG_PING_HEADER_MULTI] = "PING %zu targets: %d data bytes",
+    [MSG_PING_REPLY] = "%ld bytes from %s: icmp_seq=%d ttl=%d time=%.3f ms%s",
+    [MSG_PING_REPLY_KTS] = "%ld bytes from %s: icmp_seq=%d ttl=%d time=%.3f ms ktime=%.3f ms%s",
     [MSG_PING_FROM] = "From %s: icmp_seq=%d %s",
+    [MSG_PING_TIMEOUT] = "no answer from %s: icmp_seq=%d after %.3f ms",
+    [MSG_PING_FRAG] = "From %s: icmp_seq=%d Frag needed and DF set (mtu = %d)",
+    [MSG_PMTU_HEADER] = "PMTU %s (%s): %d to %d bytes",
+    [MSG_PMTU_ROUND] = "round %d: path mtu %d to %d (sizes tried: %d)",
+    [MSG_PMTU_RESULT] = "path mtu to %s: %d bytes, found in round %d",
+    [MSG_PMTU_PARTIAL] = "path mtu to %s: %d to %d bytes, interrupted in round %d",
+    [MSG_PMTU_NONE] = "path mtu to %s: no reply even at %d bytes",
+    [MSG_SWEEP_HEADER] = "SWEEP %s (%s): %d hops max, %d data bytes",
+    [MSG_SWEEP_HOP] = "%3d  %s  %.3f ms%s",
+    [MSG_SWEEP_STATS_HEADER] = "--- %s hop statistics ---",
+    [MSG_SWEEP_COLUMNS] = "hop  address           loss  sent  recv     last      avg     best    worst     mdev",
+    [MSG_SWEEP_ROW] = "%3d  %-15s %5.1f%% %5ld %5ld %8.3f %8.3f %8.3f %8.3f %8.3f%s",
+    [MSG_SWEEP_ROW_NORTT] = "%3d  %-15s %5.1f%% %5ld %5ld",
+    [MSG_SWEEP_UNREACHED] = "%s not reached within %d hops",
 
     [MSG_STATS_HEADER] = "--- %s ping statistics ---",
+    [MSG_STATS_HEADER_MULTI] = "--- %zu targets ping statistics ---",
+    [MSG_STATS_TARGET] = "%s : xmt/rcv/%%loss = %ld/%ld/%.0f%%, min/avg/max = %.3f/%.3f/%.3f ms",
+    [MSG_STATS_TARGET_NORTT] = "%s : xmt/rcv/%%loss = %ld/%ld/%.0f%%",
     [MSG_STATS_SUMMARY] = "%ld packets transmitted, %ld received, %.0f%% packet loss, time %.0fms",
     [MSG_STATS_RTT] = "rtt min/avg/max/mdev = %.3f/%.3f/%.3f/%.3f ms",
+    [MSG_STATS_SEQ] = "%ld duplicates, %ld out of order, %ld late, %ld timed out, %ld errors",
+    [MSG_STATS_READS] = "%ld packets read from the socket, %ld I/O syscalls",
+    [MSG_STATS_RING] = "receive ring: %lu packets, %lu dropped, %lu times full",
+    [MSG_STATS_PACING] = "pacing: %ld sends at %.0f/s, jitter min/avg/max/p99 = %.3f/%.3f/%.3f/%.3f ms",
+    [MSG_STATS_PCTL] = "rtt p50/p90/p99/p99.9 = %.3f/%.3f/%.3f/%.3f ms",
+    [MSG_STATS_KRTT] = "kernel rtt min/avg/max/mdev = %.3f/%.3f/%.3f/%.3f ms",
+    [MSG_STATS_OVERHEAD] = "userspace overhead min/avg/max = %.3f/%.3f/%.3f ms",
+    [MSG_STATS_RTO] = "rto %.3f ms (srtt %.3f ms, rttvar %.3f ms)",
+
+    [MSG_STATUS] = "%ld/%ld packets, %.0f%% loss",
+    [MSG_STATUS_RTT] = "%ld/%ld packets, %.0f%% loss, min/avg/max = %.3f/%.3f/%.3f ms",
+    [MSG_WINDOW] = "[%ld] last %lds: %ld sent, %ld received, %.1f%% loss",
+    [MSG_WINDOW_RTT] = "[%ld] last %lds: %ld sent, %ld received, %.1f%% loss, "
+                       "rtt min/p50/p90/p99/max = %.3f/%.3f/%.3f/%.3f/%.3f ms, jitter %.3f ms",
+    [MSG_INSTR_HEADER] = "stage           count     total ms     avg ns",
+    [MSG_INSTR_STAGE] = "%-8s %12lu %12.3f %10.1f",
+    [MSG_INSTR_DROPS] = "dropped: %lu short, %lu bad checksum, %lu foreign id, %lu other ICMP, %lu unmatched",
 
     [MSG_USAGE_OPTIONS_HEADER] = "Options:",
     [MSG_USAGE_OPTION_LINE] = "%-35s %s",
 };
 
-static void print_formatted(FILE *stream, t_msg_id id, va_list args) {
+/* What ping prints about the run goes to stdout; errors and usage to stderr */
+static const unsigned char g_msg_stdout[MSG_COUNT] = {
+    [MSG_PING_HEADER] = 1, [MSG_PING_HEADER_MULTI] = 1,
+    [MSG_PING_REPLY] = 1, [MSG_PING_REPLY_KTS] = 1, [MSG_PING_FROM] = 1, [MSG_PING_TIMEOUT] = 1,
+    [MSG_PING_FRAG] = 1, [MSG_PMTU_HEADER] = 1, [MSG_PMTU_ROUND] = 1, [MSG_PMTU_RESULT] = 1,
+    [MSG_PMTU_PARTIAL] = 1, [MSG_PMTU_NONE] = 1,
+    [MSG_SWEEP_HEADER] = 1, [MSG_SWEEP_HOP] = 1, [MSG_SWEEP_STATS_HEADER] = 1, [MSG_SWEEP_COLUMNS] = 1,
+    [MSG_SWEEP_ROW] = 1, [MSG_SWEEP_ROW_NORTT] = 1, [MSG_SWEEP_UNREACHED] = 1,
+    [MSG_STATS_HEADER] = 1, [MSG_STATS_HEADER_MULTI] = 1,
+    [MSG_STATS_TARGET] = 1, [MSG_STATS_TARGET_NORTT] = 1,
+    [MSG_STATS_SUMMARY] = 1, [MSG_STATS_RTT] = 1, [MSG_STATS_SEQ] = 1,
+    [MSG_STATS_READS] = 1, [MSG_STATS_RING] = 1, [MSG_STATS_PACING] = 1, [MSG_STATS_PCTL] = 1,
+    [MSG_STATS_KRTT] = 1, [MSG_STATS_OVERHEAD] = 1, [MSG_STATS_RTO] = 1,
+    [MSG_WINDOW] = 1, [MSG_WINDOW_RTT] = 1,
+};
+
+static void print_formatted(t_msg_id id, va_list args) {
     const size_t n = sizeof(g_msg_table) / sizeof(g_msg_table[0]);
     if ((size_t) id >= n || !g_msg_table[id])
         return;
 
-    //fprintf(stream, "ft_ping: ");
-    vfprintf(stream, g_msg_table[id], args);
-    fprintf(stream, "\n");
+    out_msg(g_msg_stdout[id] ? OUT_STDOUT : OUT_STDERR, id, g_msg_table[id], args);
 }
 
 void ping_msg(t_msg_id id, ...) {
     va_list args;
 
     va_start(args, id);
-    print_formatted(stderr, id, args);
+    print_formatted(id, args);
     va_end(args);
 }
 
@@ -78,7 +175,7 @@ void ping_fatal(t_msg_id id, ...) {
     va_list args;
 
     va_start(args, id);
-    print_formatted(stderr, id, args);
+    print_formatted(id, args);
     va_end(args);
     exit(1);
 }
@@ -111,24 +208,149 @@ void ft_usage(const int exit_code) {
     exit(exit_code);
 }
 
-void print_stats(const t_stats *stats) {
-    if (!stats)
+/*
+** Flood output: one '.' per request sent and one backspace per reply, so the
+** dots left on screen are the probes still unanswered. Marks go through the
+** stdout buffer like the lines.
+*/
+void flood_mark(const char c) {
+    if (flags.quiet || flags.format != FORMAT_TEXT)
         return;
+    out_write(&c, 1);
+}
+
+static double loss_percent(long tx, long rx) {
+    if (tx <= 0)
+        return 0.0;
+    return ((tx - rx) * 100.0) / tx;
+}
 
-    const double total = get_time_ms() -
-                         ((stats->start_tv.tv_sec * 1000.0) + (stats->start_tv.tv_usec / 1000.0));
-    double loss = 0.0;
+/* min/avg/max/mdev of an RTT accumulator, in milliseconds */
+static void rtt_summary(const t_stats *stats, double out[4]) {
+    const double var = stats->m2 / (double) stats->rx;
 
-    if (stats->tx > 0)
-        loss = ((stats->tx - stats->rx) * 100.0) / stats->tx;
+    out[0] = (double) stats->min / NS_PER_MS;
+    out[1] = stats->mean / NS_PER_MS;
+    out[2] = (double) stats->max / NS_PER_MS;
+    out[3] = ft_sqrt(var > 0 ? var : 0) / NS_PER_MS;
+}
+
+void print_stats(const char *name, const t_stats *stats) {
+    if (!stats)
+        return;
+
+    const double total = (double) (now_ns() - stats->start_ns) / NS_PER_MS;
+    const double loss = loss_percent(stats->tx, stats->rx);
+    double r[4];
 
     /* Header on its own line (leading newline without printf) */
-    ping_msg(MSG_STATS_HEADER, target);
+    if (name)
+        ping_msg(MSG_STATS_HEADER, name);
     ping_msg(MSG_STATS_SUMMARY, stats->tx, stats->rx, loss, total);
+    if (stats->dup || stats->reorder || stats->late || stats->timeouts || stats->errors)
+        ping_msg(MSG_STATS_SEQ, stats->dup, stats->reorder, stats->late, stats->timeouts, stats->errors);
 
     if (stats->rx > 0) {
-        const double avg = stats->sum / stats->rx;
-        const double mdev = ft_sqrt((stats->sq_sum / stats->rx) - (avg * avg));
-        ping_msg(MSG_STATS_RTT, stats->min, avg, stats->max, mdev);
+        rtt_summary(stats, r);
+        ping_msg(MSG_STATS_RTT, r[0], r[1], r[2], r[3]);
+    }
+    if (stats->hist && stats->hist->total > 0) {
+        ping_msg(MSG_STATS_PCTL,
+                 (double) stats_percentile(stats, 0.50) / NS_PER_MS,
+                 (double) stats_percentile(stats, 0.90) / NS_PER_MS,
+                 (double) stats_percentile(stats, 0.99) / NS_PER_MS,
+                 (double) stats_percentile(stats, 0.999) / NS_PER_MS);
+    }
+    if (flags.kernel_ts && g_kts.rtt.rx > 0) {
+        rtt_summary(&g_kts.rtt, r);
+        ping_msg(MSG_STATS_KRTT, r[0], r[1], r[2], r[3]);
+        rtt_summary(&g_kts.overhead, r);
+        ping_msg(MSG_STATS_OVERHEAD, r[0], r[1], r[2]);
+    }
+}
+
+/* Receive ring losses always, pacing with --rate or -v, read and syscall counts with -v */
+static void print_io_summary(void) {
+    if (g_rxring_stats.used)
+        ping_msg(MSG_STATS_RING, g_rxring_stats.packets, g_rxring_stats.drops,
+                 g_rxring_stats.freezes);
+    if ((flags.rate > 0 || flags.verbose) && g_pace.jitter.rx > 0) {
+        const t_stats *j = &g_pace.jitter;
+        ping_msg(MSG_STATS_PACING, g_pace.sends, pace_rate(),
+                 (double) j->min / NS_PER_MS, j->mean / NS_PER_MS, (double) j->max / NS_PER_MS,
+                 (double) stats_percentile(j, 0.99) / NS_PER_MS);
+    }
+    if (flags.verbose)
+        ping_msg(MSG_STATS_READS, g_rx_reads, g_io_syscalls);
+}
+
+/* Single target: classic ping summary. Several: one line per target, then totals */
+void print_summary(void) {
+    if (flags.format != FORMAT_TEXT) {
+        records_summary();
+        return;
+    }
+    if (g_ntargets == 1) {
+        const t_rto *r = &g_targets[0].rto;
+
+        print_stats(g_targets[0].name, &g_stats);
+        if (flags.rto && r->srtt > 0)
+            ping_msg(MSG_STATS_RTO, (double) rto_get(r) / NS_PER_MS, (double) r->srtt / NS_PER_MS,
+                     (double) r->rttvar / NS_PER_MS);
+        print_io_summary();
+        return;
+    }
+
+    ping_msg(MSG_STATS_HEADER_MULTI, g_ntargets - g_targets_failed);
+    for (size_t i = 0; i < g_ntargets; i++) {
+        const t_target *t = &g_targets[i];
+        const long tx = t->stats.tx;
+        const long rx = t->stats.rx;
+
+        if (t->state == TARGET_FAILED)
+            continue;
+
+        if (rx > 0)
+            ping_msg(MSG_STATS_TARGET, t->name, tx, rx, loss_percent(tx, rx),
+                     (double) t->stats.min / NS_PER_MS,
+                     (double) t->stats.sum / (double) rx / NS_PER_MS,
+                     (double) t->stats.max / NS_PER_MS);
+        else
+            ping_msg(MSG_STATS_TARGET_NORTT, t->name, tx, rx, loss_percent(tx, rx));
+    }
+    print_stats(NULL, &g_stats);
+    print_io_summary();
+}
+
+/*
+** SIGQUIT: one status line on stderr while the run goes on, as iputils
+** ping prints, from the per-target counters so it also covers the workers.
+** Instrumented builds add the per-stage counters.
+*/
+void print_status(void) {
+    long tx = 0;
+    long rx = 0;
+    int64_t min = INT64_MAX;
+    int64_t max = 0;
+    int64_t sum = 0;
+
+    for (size_t i = 0; i < g_ntargets; i++) {
+        const t_target_stats *ts = &g_targets[i].stats;
+        const int64_t t_min = atomic_load_explicit(&ts->min, memory_order_relaxed);
+        const int64_t t_max = atomic_load_explicit(&ts->max, memory_order_relaxed);
+
+        tx += atomic_load_explicit(&ts->tx, memory_order_relaxed);
+        rx += atomic_load_explicit(&ts->rx, memory_order_relaxed);
+        sum += atomic_load_explicit(&ts->sum, memory_order_relaxed);
+        if (t_min < min)
+            min = t_min;
+        if (t_max > max)
+            max = t_max;
     }
+    if (rx > 0)
+        ping_msg(MSG_STATUS_RTT, tx, rx, loss_percent(tx, rx), (double) min / NS_PER_MS,
+                 (double) sum / (double) rx / NS_PER_MS, (double) max / NS_PER_MS);
+    else
+        ping_msg(MSG_STATUS, tx, rx, loss_percent(tx, rx));
+    instr_print();
 }
@@ -0,0 +1,344 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "libft/libft.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/*
+** Output sink
+** -----------
+** Lines for stdout (replies, headers, statistics) are appended to one
+** buffer and written when it fills up, when the oldest line in it gets
+** OUT_FLUSH_NS old, before the loop goes to sleep for that long, and on
+** exit. Errors go to stderr at once, one write() per line, after whatever
+** stdout still holds so the two stay in order.
+**
+** The g_msg_table formats are compiled once into a list of literal runs
+** and conversions; a line is then built by copying the runs and calling a
+** formatter per conversion (integers, strings, fixed-point RTTs), with no
+** printf on the way. A format with anything else in it (widths, flags) is
+** left to vsnprintf().
+*/
+
+#define OUT_BUF_SIZE   (64 * 1024)
+#define OUT_LINE_MAX   1024
+#define OUT_FLUSH_NS   (100 * NS_PER_MS)
+#define TPL_MAX_OPS    24
+
+typedef enum e_op {
+    OP_LIT, OP_INT, OP_LONG, OP_ULONG, OP_SIZE, OP_STR, OP_CHAR, OP_FIXED3, OP_FIXED0
+} t_op;
+
+typedef struct s_tpl_op {
+    uint8_t  op;
+    uint16_t off;   /* OP_LIT: run of the format string */
+    uint16_t len;
+} t_tpl_op;
+
+typedef struct s_tpl {
+    t_tpl_op ops[TPL_MAX_OPS];
+    int      nops;
+    int      slow;  /* needs vsnprintf() */
+} t_tpl;
+
+static struct {
+    pthread_mutex_t lock;
+    char            buf[OUT_BUF_SIZE];
+    size_t          len;
+    uint64_t        first_ns;   /* when the oldest unflushed byte came in */
+} g_out = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static t_tpl g_tpls[MSG_COUNT];
+static const char *g_tpl_fmt[MSG_COUNT];   /* set once g_tpls[id] is compiled */
+static pthread_mutex_t g_tpl_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_out_once = PTHREAD_ONCE_INIT;
+
+static const char g_digits2[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* Decimal digits of `v`, two at a time from the right; returns the length */
+size_t fmt_u64(char *dst, uint64_t v) {
+    char tmp[20];
+    char *p = tmp + sizeof(tmp);
+
+    while (v >= 100) {
+        const unsigned d = (unsigned) (v % 100) * 2;
+        v /= 100;
+        *--p = g_digits2[d + 1];
+        *--p = g_digits2[d];
+    }
+    if (v >= 10) {
+        *--p = g_digits2[v * 2 + 1];
+        *--p = g_digits2[v * 2];
+    } else {
+        *--p = (char) ('0' + v);
+    }
+
+    const size_t n = (size_t) (tmp + sizeof(tmp) - p);
+    ft_memcpy(dst, p, n);
+    return n;
+}
+
+static size_t fmt_i64(char *dst, int64_t v) {
+    if (v < 0) {
+        *dst = '-';
+        return 1 + fmt_u64(dst + 1, (uint64_t) 0 - (uint64_t) v);
+    }
+    return fmt_u64(dst, (uint64_t) v);
+}
+
+/*
+** `v` with `decimals` digits after the point (0 to 3), rounded like printf:
+** to nearest, ties to even. A value whose scaled fraction is too close to a
+** tie to decide in double, or out of range, goes through snprintf().
+*/
+size_t fmt_fixed(char *dst, double v, int decimals) {
+    static const double scale[] = {1.0, 10.0, 100.0, 1000.0};
+    const double x = fabs(v) * scale[decimals];
+
+    if (!(x < 1e15) || fabs(x - floor(x) - 0.5) < 1e-6)
+        return (size_t) snprintf(dst, 32, "%.*f", decimals, v);
+
+    uint64_t q = (uint64_t) nearbyint(x);
+    size_t n = 0;
+
+    if (signbit(v))
+        dst[n++] = '-';
+    if (decimals == 0)
+        return n + fmt_u64(dst + n, q);
+
+    static const uint64_t pow10[] = {1, 10, 100, 1000};
+    const uint64_t ip = q / pow10[decimals];
+    uint64_t frac = q % pow10[decimals];
+
+    n += fmt_u64(dst + n, ip);
+    dst[n++] = '.';
+    for (int i = decimals - 1; i >= 0; i--) {
+        dst[n + (size_t) i] = (char) ('0' + frac % 10);
+        frac /= 10;
+    }
+    return n + (size_t) decimals;
+}
+
+/* Dotted quad of an address in network order, like inet_ntop() */
+size_t fmt_ipv4(char *dst, struct in_addr addr) {
+    const uint8_t *b = (const uint8_t *) &addr.s_addr;
+    size_t n = 0;
+
+    for (int i = 0; i < 4; i++) {
+        if (i)
+            dst[n++] = '.';
+        n += fmt_u64(dst + n, b[i]);
+    }
+    dst[n] = '\0';
+    return n;
+}
+
+/* Splits a format into literal runs and the conversions we format ourselves */
+static void tpl_compile(t_tpl *t, const char *fmt) {
+    size_t i = 0;
+    size_t lit = 0;
+
+    t->nops = 0;
+    t->slow = 0;
+    while (fmt[i] && !t->slow) {
+        if (fmt[i] != '%') {
+            i++;
+            continue;
+        }
+
+        /* "%%" is a literal '%': keep it in the run, drop the first one */
+        int op = -1;
+        size_t spec = 1;
+        if (fmt[i + 1] == '%') {
+            op = OP_LIT;
+        } else if (fmt[i + 1] == 'd') {
+            op = OP_INT;
+        } else if (fmt[i + 1] == 's') {
+            op = OP_STR;
+        } else if (fmt[i + 1] == 'c') {
+            op = OP_CHAR;
+        } else if (fmt[i + 1] == 'l' && fmt[i + 2] == 'd') {
+            op = OP_LONG;
+            spec = 2;
+        } else if (fmt[i + 1] == 'l' && fmt[i + 2] == 'u') {
+            op = OP_ULONG;
+            spec = 2;
+        } else if (fmt[i + 1] == 'z' && fmt[i + 2] == 'u') {
+            op = OP_SIZE;
+            spec = 2;
+        } else if (ft_strncmp(fmt + i + 1, ".3f", 3) == 0) {
+            op = OP_FIXED3;
+            spec = 3;
+        } else if (ft_strncmp(fmt + i + 1, ".0f", 3) == 0) {
+            op = OP_FIXED0;
+            spec = 3;
+        }
+        if (op < 0 || t->nops + 2 > TPL_MAX_OPS) {
+            t->slow = 1;
+            break;
+        }
+
+        if (op == OP_LIT) {
+            t->ops[t->nops++] = (t_tpl_op){OP_LIT, (uint16_t) lit, (uint16_t) (i + 1 - lit)};
+            i += 2;
+            lit = i;
+            continue;
+        }
+        if (i > lit)
+            t->ops[t->nops++] = (t_tpl_op){OP_LIT, (uint16_t) lit, (uint16_t) (i - lit)};
+        t->ops[t->nops++] = (t_tpl_op){(uint8_t) op, 0, 0};
+        i += 1 + spec;
+        lit = i;
+    }
+    if (!t->slow && i > lit) {
+        if (t->nops + 1 > TPL_MAX_OPS)
+            t->slow = 1;
+        else
+            t->ops[t->nops++] = (t_tpl_op){OP_LIT, (uint16_t) lit, (uint16_t) (i - lit)};
+    }
+}
+
+static void out_atexit(void) {
+    out_flush();
+}
+
+static void out_init(void) {
+    atexit(out_atexit);
+}
+
+/* Builds one line (no newline) into `line`; returns its length */
+static size_t tpl_format(char *line, int id, const char *fmt, va_list args) {
+    t_tpl *t = &g_tpls[id];
+
+    /* Compiled on first use; the lock only matters for worker threads */
+    if (__atomic_load_n(&g_tpl_fmt[id], __ATOMIC_ACQUIRE) != fmt) {
+        pthread_mutex_lock(&g_tpl_lock);
+        if (g_tpl_fmt[id] != fmt) {
+            tpl_compile(t, fmt);
+            __atomic_store_n(&g_tpl_fmt[id], fmt, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&g_tpl_lock);
+    }
+    if (t->slow) {
+        const int n = vsnprintf(line, OUT_LINE_MAX, fmt, args);
+        return n < 0 ? 0 : (size_t) n < OUT_LINE_MAX ? (size_t) n : OUT_LINE_MAX - 1;
+    }
+
+    /* Every conversion is at most 32 bytes; strings are cut at the line end */
+    size_t n = 0;
+    for (int i = 0; i < t->nops && n + 32 < OUT_LINE_MAX; i++) {
+        const t_tpl_op *op = &t->ops[i];
+
+        switch (op->op) {
+            case OP_LIT: {
+                const size_t len = op->len < OUT_LINE_MAX - 32 - n ? op->len : OUT_LINE_MAX - 32 - n;
+                ft_memcpy(line + n, fmt + op->off, len);
+                n += len;
+                break;
+            }
+            case OP_INT:
+                n += fmt_i64(line + n, va_arg(args, int));
+                break;
+            case OP_LONG:
+                n += fmt_i64(line + n, va_arg(args, long));
+                break;
+            case OP_ULONG:
+                n += fmt_u64(line + n, va_arg(args, unsigned long));
+                break;
+            case OP_SIZE:
+                n += fmt_u64(line + n, va_arg(args, size_t));
+                break;
+            case OP_CHAR:
+                line[n++] = (char) va_arg(args, int);
+                break;
+            case OP_STR: {
+                const char *s = va_arg(args, const char *);
+                if (!s)
+                    s = "(null)";
+                while (*s && n + 32 < OUT_LINE_MAX)
+                    line[n++] = *s++;
+                break;
+            }
+            case OP_FIXED3:
+                n += fmt_fixed(line + n, va_arg(args, double), 3);
+                break;
+            case OP_FIXED0:
+                n += fmt_fixed(line + n, va_arg(args, double), 0);
+                break;
+        }
+    }
+    return n;
+}
+
+static void write_all(int fd, const char *p, size_t n) {
+    while (n > 0) {
+        const ssize_t w = write(fd, p, n);
+        if (w <= 0)
+            return;
+        g_io_syscalls++;
+        p += w;
+        n -= (size_t) w;
+    }
+}
+
+/* Caller holds the lock */
+static void flush_locked(void) {
+    write_all(STDOUT_FILENO, g_out.buf, g_out.len);
+    g_out.len = 0;
+}
+
+void out_write(const char *s, size_t n) {
+    pthread_once(&g_out_once, out_init);
+    pthread_mutex_lock(&g_out.lock);
+    if (g_out.len + n > sizeof(g_out.buf))
+        flush_locked();
+    if (n > sizeof(g_out.buf)) {
+        write_all(STDOUT_FILENO, s, n);
+    } else {
+        if (g_out.len == 0)
+            g_out.first_ns = now_ns();
+        ft_memcpy(g_out.buf + g_out.len, s, n);
+        g_out.len += n;
+    }
+    pthread_mutex_unlock(&g_out.lock);
+}
+
+void out_flush(void) {
+    pthread_mutex_lock(&g_out.lock);
+    flush_locked();
+    pthread_mutex_unlock(&g_out.lock);
+}
+
+/*
+** Called before the event loop waits up to `idle_ns`: flushes if lines
+** would otherwise sit in the buffer for OUT_FLUSH_NS or more.
+*/
+void out_poll(uint64_t idle_ns) {
+    pthread_mutex_lock(&g_out.lock);
+    if (g_out.len > 0 && (idle_ns >= OUT_FLUSH_NS || now_ns() - g_out.first_ns >= OUT_FLUSH_NS))
+        flush_locked();
+    pthread_mutex_unlock(&g_out.lock);
+}
+
+/* Formats message `id` and sends it, newline added, to `stream` */
+void out_msg(t_out_stream stream, int id, const char *fmt, va_list args) {
+    char line[OUT_LINE_MAX + 1];
+    size_t n = tpl_format(line, id, fmt, args);
+
+    line[n++] = '\n';
+    if (stream == OUT_STDOUT) {
+        out_write(line, n);
+        return;
+    }
+    out_flush();
+    write_all(STDERR_FILENO, line, n);
+}
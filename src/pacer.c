@@ -0,0 +1,104 @@
+#include "ft_ping.h"
+
+/*
+** Send pacing
+** -----------
+** The interval (-i, or --rate probes/s over all targets) is kept in
+** nanoseconds and split evenly between the targets: one probe is due every
+** period_ns on an absolute CLOCK_MONOTONIC schedule starting at the first
+** send. The event loops sleep on a timerfd (or io_uring TIMEOUT) armed on
+** that same schedule, so they wake when a probe is due; how many probes go
+** out is decided here from the clock, not from the timer's count.
+**
+** Probes that could not go out on time are tokens in a bucket of depth
+** --burst (1 by default, IO_BATCH when flooding): up to that many are sent
+** back to back to catch up, anything beyond is dropped from the schedule.
+** A burst of 1 keeps classic ping behaviour, where a late wakeup sends one
+** probe and does not try to make up for the missed ones.
+**
+** Every send is compared with the time it was due and the difference goes
+** into g_pace, printed with the statistics (--rate or -v).
+*/
+
+t_pace_stats g_pace = {0};
+static t_hist g_pace_hist;
+
+/* The period is at least 1 ns: a zero interval means as fast as possible */
+void pacer_init(t_pacer *p, uint64_t start_ns) {
+    uint64_t period = (uint64_t) flags.interval_ns / (uint64_t) g_ntargets;
+
+    p->period_ns = period > 0 ? period : 1;
+    p->next_ns = start_ns;
+    p->burst = flags.burst > 0 ? flags.burst : flags.flood ? IO_BATCH : 1;
+    g_pace = (t_pace_stats){.jitter.hist = &g_pace_hist};
+}
+
+/* Probes due at `now`; the schedule skips past those the bucket cannot hold */
+int pacer_due(t_pacer *p, uint64_t now) {
+    if (now < p->next_ns)
+        return 0;
+
+    uint64_t n = (now - p->next_ns) / p->period_ns + 1;
+    if (n > (uint64_t) p->burst) {
+        p->next_ns += (n - (uint64_t) p->burst) * p->period_ns;
+        n = (uint64_t) p->burst;
+    }
+    return (int) n;
+}
+
+/*
+** Takes the turns due now and records how late each one was. A turn given
+** to a target that is still being resolved sends nothing but counts as
+** taken. Returns the probes sent.
+*/
+int pacer_send(t_pacer *p, int sock, t_sched *s, t_tx_batch *tx) {
+    const uint64_t now = now_ns();
+    const int due = pacer_due(p, now);
+    const long long before = s->sent;
+    int turns = 0;
+
+    while (turns < due) {
+        const int n = send_probes(sock, s, tx, due - turns);
+        if (n == 0)
+            break;
+        turns += n;
+    }
+
+    for (int i = 0; i < turns; i++) {
+        const uint64_t planned = p->next_ns + (uint64_t) i * p->period_ns;
+        g_pace.jitter.rx++;
+        update_stats(&g_pace.jitter, (int64_t) (now - planned));
+    }
+    const int sent = (int) (s->sent - before);
+    if (sent > 0) {
+        if (!g_pace.first_ns)
+            g_pace.first_ns = now;
+        g_pace.last_ns = now;
+        g_pace.sends += sent;
+    }
+    p->next_ns += (uint64_t) due * p->period_ns;
+    return sent;
+}
+
+/*
+** With -c the loops stop sending once every probe went out, then linger
+** until no probe is pending (each answered or given up on after -W) or a
+** whole interval has passed since the last one was due. The ticks come
+** every interval / targets, so stopping at the next one would leave the
+** last targets of the round almost no time to answer.
+*/
+int pacer_finished(const t_pacer *p, const t_sched *s, uint64_t now) {
+    if (!sched_done(s))
+        return 0;
+
+    const uint64_t last = p->next_ns - p->period_ns;
+
+    return probes_until(now) < 0 || now >= last + p->period_ns * (uint64_t) g_ntargets;
+}
+
+/* Achieved send rate over the paced sends, 0 with fewer than two */
+double pace_rate(void) {
+    if (g_pace.sends < 2 || g_pace.last_ns <= g_pace.first_ns)
+        return 0.0;
+    return (double) (g_pace.sends - 1) * NS_PER_SEC / (double) (g_pace.last_ns - g_pace.first_ns);
+}
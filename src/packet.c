@@ -0,0 +1,496 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "ft_instr.h"
+#include "libft/libft.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+
+/* Largest IPv4 header (ihl = 15) */
+#define IP_MAX_HLEN 60
+
+/*
+** Reports an ICMP error about one of our probes. Raw sockets find it in the
+** packet (handle_error_packet), datagram sockets on the error queue.
+** `next_mtu` is what a Fragmentation Needed says the next hop carries, 0
+** for other errors (and for routers older than RFC 1191).
+*/
+void pkt_report_error(struct in_addr from, uint8_t type, uint8_t code, struct in_addr orig_dst,
+                      uint16_t wire_seq, uint16_t next_mtu) {
+    /* The error must match a probe we sent to that destination */
+    const t_probe *p = probe_lookup(wire_seq, orig_dst);
+    if (!p) {
+        INSTR_DROP(DROP_UNMATCHED);
+        return;
+    }
+    const int seq = p->seq;
+    if (type < ICMP_TYPES)
+        g_icmp_errors[type]++;
+    if (flags.pmtu)
+        pmtu_error(wire_seq, type, code, next_mtu);
+    INSTR_START(t_output);
+
+    if (flags.format != FORMAT_TEXT)
+        record_error(p, from, type, code, next_mtu);
+    else if (flags.flood)
+        flood_mark('E');
+    else if (flags.verbose) {
+        char src_str[INET_ADDRSTRLEN];
+        /* The error packet comes FROM the gateway/router */
+        fmt_ipv4(src_str, from);
+
+        if (type == ICMP_TIME_EXCEEDED)
+            ping_msg(MSG_PING_FROM, src_str, seq, "Time to live exceeded");
+        else if (type == ICMP_DEST_UNREACH && code == ICMP_FRAG_NEEDED)
+            ping_msg(MSG_PING_FRAG, src_str, seq, next_mtu);
+        else if (type == ICMP_DEST_UNREACH)
+            ping_msg(MSG_PING_FROM, src_str, seq, "Destination Host Unreachable");
+        else
+            ping_msg(MSG_PING_FROM, src_str, seq, "ICMP Error");
+    }
+    INSTR_STOP(STAGE_OUTPUT, t_output, 1);
+
+    /* --sweep: the hop answered; an unreachable ends the path */
+    if (flags.sweep)
+        sweep_answer(p, wire_seq, from, type != ICMP_TIME_EXCEEDED, now_ns());
+
+    /* No echo reply will follow: the probe is settled now, not timed out at -W */
+    if (p->state == PROBE_PENDING) {
+        g_stats.errors++;
+        window_timeout(now_ns());
+        probe_forget(wire_seq);
+    }
+}
+
+/* * Helper to handle error packets (Type 3 & 11)
+ * Extracts the inner IP/ICMP header to verify if this error belongs to our id.
+ */
+static void handle_error_packet(const struct ip *ip, const struct my_icmp_header *icmp, size_t icmp_len, int id) {
+    /* * In an ICMP Error packet, the payload contains the IP header
+     * plus the first 8 bytes of the original datagram that caused the error.
+     */
+    if (icmp_len < 8 + sizeof(struct ip)) {
+        INSTR_DROP(DROP_SHORT);
+        return;
+    }
+    const struct ip *orig_ip = (const struct ip *) ((const char *) icmp + 8);
+    size_t orig_ip_len = orig_ip->ip_hl * 4;
+    if (icmp_len < 8 + orig_ip_len + sizeof(struct my_icmp_header)) {
+        INSTR_DROP(DROP_SHORT);
+        return;
+    }
+
+    /* The original ICMP header follows the original IP header */
+    const struct my_icmp_header *orig_icmp = (const struct my_icmp_header *) ((const char *) orig_ip + orig_ip_len);
+
+    /* Check if the error corresponds to our ICMP id */
+    if (ntohs(orig_icmp->id) != (id & 0xFFFF)) {
+        INSTR_DROP(DROP_FOREIGN_ID);
+        return;
+    }
+
+    /* Fragmentation Needed has the next-hop MTU where an echo has its sequence (RFC 1191) */
+    const uint16_t next_mtu = icmp->type == ICMP_DEST_UNREACH && icmp->code == ICMP_FRAG_NEEDED
+                              ? ntohs(icmp->sequence) : 0;
+
+    pkt_report_error(ip->ip_src, icmp->type, icmp->code, orig_ip->ip_dst, ntohs(orig_icmp->sequence),
+                     next_mtu);
+}
+
+/*
+** Echo request template
+** ---------------------
+** Everything in a request except the sequence number is the same for every
+** probe, so it is built once: the ICMP header with seq = 0 and the
+** '!' + (i % 56) pattern. The one's complement sum of all those constant
+** bytes is kept as `partial`. Send times live in the probe ring, not in the
+** payload, so any -s (even 0) gets RTTs.
+**
+** Per probe only the ICMP header is written, and the checksum
+** is updated incrementally (RFC 1624): the new words are added to the saved
+** partial sum instead of summing the whole packet again. The pattern is
+** shared by every send as a second iovec, so the cost of a send no longer
+** depends on -s.
+*/
+
+void pkt_template_init(t_pkt_template *tpl, int id) {
+    const size_t pack_size = sizeof(struct my_icmp_header) + (size_t) flags.payload_size;
+    ft_memset(tpl, 0, sizeof(*tpl));
+
+    struct my_icmp_header *icmp = (struct my_icmp_header *) tpl->hdr;
+    icmp->type = ICMP_ECHO;
+    icmp->code = 0;
+    icmp->id = htons(id & 0xFFFF);
+
+    tpl->hdr_len = pack_size < PKT_HDR_LEN ? pack_size : PKT_HDR_LEN;
+    tpl->payload_len = pack_size - tpl->hdr_len;
+
+    if (tpl->payload_len > 0) {
+        tpl->payload = malloc(tpl->payload_len);
+        if (!tpl->payload)
+            ping_fatal(MSG_ERR_OUT_OF_MEMORY);
+        /* Fill payload with pattern (offsets are relative to the packet start) */
+        for (size_t i = 0; i < tpl->payload_len; i++)
+            tpl->payload[i] = (char) ('!' + ((i + PKT_HDR_LEN) % 56));
+    }
+
+    /* PKT_HDR_LEN is even, so both halves sum on the packet's word boundaries */
+    tpl->partial = csum_partial(tpl->hdr, tpl->hdr_len, 0);
+    tpl->partial = csum_partial(tpl->payload, tpl->payload_len, tpl->partial);
+}
+
+void pkt_template_free(t_pkt_template *tpl) {
+    free(tpl->payload);
+    tpl->payload = NULL;
+}
+
+/* Writes the per-probe header of `seq` into `hdr` (tpl->hdr_len bytes) */
+void pkt_stamp(const t_pkt_template *tpl, uint8_t *hdr, uint16_t seq) {
+    struct my_icmp_header *icmp = (struct my_icmp_header *) hdr;
+    const uint16_t wire_seq = htons(seq);
+    uint32_t sum = tpl->partial;
+
+    ft_memcpy(hdr, tpl->hdr, tpl->hdr_len);
+    icmp->sequence = wire_seq;
+    sum += wire_seq;
+    icmp->checksum = csum_fold(sum);
+}
+
+/*
+** Batches
+** -------
+** Both directions use preallocated arrays of IO_BATCH messages so a whole
+** burst moves in one sendmmsg()/recvmmsg() call. A send slot is just the
+** per-probe header plus the template's shared pattern as a second iovec;
+** the receive side holds one buffer large enough for the biggest reply we
+** can get back (our packet plus a maximal IP header).
+*/
+
+void io_batch_init(t_tx_batch *tx, t_rx_batch *rx, int id) {
+    ft_memset(tx, 0, sizeof(*tx));
+    ft_memset(rx, 0, sizeof(*rx));
+
+    pkt_template_init(&tx->tpl, id);
+    rx->buf_len = sizeof(struct my_icmp_header) + (size_t) flags.payload_size + IP_MAX_HLEN;
+    if (rx->buf_len < 576)
+        rx->buf_len = 576;
+
+    rx->bufs = malloc(IO_BATCH * rx->buf_len);
+    if (!rx->bufs)
+        ping_fatal(MSG_ERR_OUT_OF_MEMORY);
+
+    for (int i = 0; i < IO_BATCH; i++) {
+        tx->iov[i][0].iov_base = tx->hdrs[i];
+        tx->iov[i][0].iov_len = tx->tpl.hdr_len;
+        tx->iov[i][1].iov_base = tx->tpl.payload;
+        tx->iov[i][1].iov_len = tx->tpl.payload_len;
+        tx->msgs[i].msg_hdr.msg_iov = tx->iov[i];
+        tx->msgs[i].msg_hdr.msg_iovlen = tx->tpl.payload_len > 0 ? 2 : 1;
+        tx->msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+
+        rx->iov[i].iov_base = rx->bufs + (size_t) i * rx->buf_len;
+        rx->iov[i].iov_len = rx->buf_len;
+        rx->msgs[i].msg_hdr.msg_iov = &rx->iov[i];
+        rx->msgs[i].msg_hdr.msg_iovlen = 1;
+        rx->msgs[i].msg_hdr.msg_name = &rx->names[i];
+        rx->msgs[i].msg_hdr.msg_control = rx->ctrl[i];
+    }
+}
+
+void io_batch_free(t_tx_batch *tx, t_rx_batch *rx) {
+    pkt_template_free(&tx->tpl);
+    free(rx->bufs);
+}
+
+/*
+** A target gets a probe in its turn once its address is known and, with -c,
+** while it has probes left. A target passed over still uses up its turn, so
+** the others keep their interval while names are being looked up.
+*/
+static int target_due(t_target *t) {
+    if (atomic_load_explicit(&t->state, memory_order_acquire) != TARGET_READY)
+        return 0;
+    return flags.count <= 0 || atomic_load_explicit(&t->seq, memory_order_relaxed) < (uint32_t) flags.count;
+}
+
+/*
+** Builds probes for the next `want` turns of the targets in [first, end),
+** round-robin, and sends them in one batch. Returns the number of turns
+** taken: the probes scheduled (sent or failed), which is what advances the
+** sequence numbers, and the targets passed over.
+**
+** A probe is never sent while the one PROBE_MAP_SIZE wire sequences before
+** it is still pending: the ring would wrap and give its reply to the new
+** probe. Faster than PROBE_MAP_SIZE per -W, the turns stop there and the
+** pacer drops them like any it could not send on time.
+*/
+int send_probes(int sock, t_sched *s, t_tx_batch *tx, int want) {
+    static _Thread_local int full_told = 0;
+    const uint64_t sent_ns = now_ns();
+    int turns = 0;
+    int n = 0;
+
+    if (want > IO_BATCH)
+        want = IO_BATCH;
+    INSTR_START(t_build);
+    for (; turns < want && (s->limit < 0 || s->sent < s->limit); turns++) {
+        t_target *t = &g_targets[s->next];
+
+        if (!target_due(t)) {
+            if (++s->next == s->end)
+                s->next = s->first;
+            continue;
+        }
+        if (g_probes[s->wire_seq].state == PROBE_PENDING) {
+            if (!full_told++ && !flags.quiet)
+                ping_msg(MSG_PROBES_FULL, PROBE_MAP_SIZE);
+            break;
+        }
+
+        const uint16_t seq = (uint16_t) atomic_fetch_add_explicit(&t->seq, 1, memory_order_relaxed);
+
+        probe_track(s->wire_seq, s->next, seq, sent_ns);
+        pkt_stamp(&tx->tpl, tx->hdrs[n], s->wire_seq);
+        tx->msgs[n].msg_hdr.msg_name = &t->addr;
+        tx->targets[n] = t;
+        tx->seqs[n] = s->wire_seq;
+
+        s->wire_seq++;
+        s->sent++;
+        if (++s->next == s->end)
+            s->next = s->first;
+        n++;
+    }
+    INSTR_STOP(STAGE_BUILD, t_build, n);
+
+    /* sendmmsg() stops at the first failing message: report it, forget it, skip it */
+    int off = 0;
+    while (off < n) {
+        INSTR_START(t_send);
+        int done = g_transport->send(sock, tx->msgs + off, (unsigned int) (n - off));
+        INSTR_STOP(STAGE_SEND, t_send, done > 0 ? done : 0);
+        if (done < 0) {
+            if (errno == EINTR)
+                continue;
+            if (!flags.quiet)
+                ping_msg(MSG_ERR_SENDTO, strerror(errno));
+            /* Never on the wire: no reply and no timeout to wait for */
+            probe_forget(tx->seqs[off]);
+            done = 0;
+            off++;
+        }
+        for (int i = off; i < off + done; i++) {
+            if (flags.kernel_ts)
+                kts_on_sent(tx->seqs[i]);
+            STAT_INC(tx->targets[i]->stats.tx);
+            g_stats.tx++;
+            if (flags.flood)
+                flood_mark('.');
+        }
+        window_sent(done, sent_ns);
+        off += done;
+    }
+    return turns;
+}
+
+/* Every probe asked for has gone out; targets whose name failed are owed none */
+int sched_done(const t_sched *s) {
+    return s->limit >= 0 && s->sent >= s->limit - (long long) g_targets_failed * flags.count;
+}
+
+/* Feeds the kernel-timestamped RTT of a reply into g_kts */
+static int64_t kernel_rtt(uint16_t wire_seq, int64_t krx_ns, int64_t rtt_ns) {
+    const int64_t ktx_ns = (int64_t) g_probes[wire_seq].ktx_ns;
+
+    if (!ktx_ns || !krx_ns || krx_ns < ktx_ns)
+        return -1;
+
+    const int64_t krtt = krx_ns - ktx_ns;
+    g_kts.rtt.rx++;
+    update_stats(&g_kts.rtt, krtt);
+    if (rtt_ns >= 0) {
+        g_kts.overhead.rx++;
+        update_stats(&g_kts.overhead, rtt_ns > krtt ? rtt_ns - krtt : 0);
+    }
+    return krtt;
+}
+
+/*
+** Handles an echo reply carrying our id, whatever socket it came from.
+** `now` is when it arrived (CLOCK_MONOTONIC).
+*/
+static void process_reply(struct in_addr from, int ttl, const struct my_icmp_header *icmp,
+                          size_t icmp_len, int64_t krx_ns, uint64_t now) {
+    const uint16_t wire_seq = ntohs(icmp->sequence);
+    t_probe *p = probe_lookup(wire_seq, from);
+    if (!p) {
+        INSTR_DROP(DROP_UNMATCHED);
+        return;
+    }
+
+    INSTR_START(t_stats);
+    const t_reply_kind kind = probe_reply(p, now);
+    t_target *t = &g_targets[p->target];
+    const int64_t rtt = (int64_t) (now - p->sent_ns);
+
+    /* Duplicates and late replies do not count towards the RTT stats */
+    int64_t krtt = -1;
+    if (kind == REPLY_OK || kind == REPLY_REORDERED) {
+        target_stats_add(&t->stats, rtt);
+        update_stats(&g_stats, rtt);
+        window_reply(t, rtt, now);
+        if (flags.kernel_ts)
+            krtt = kernel_rtt(wire_seq, krx_ns, rtt);
+    }
+    /* Late replies still tell the timeout how long the path takes */
+    if (flags.rto && kind != REPLY_DUP)
+        rto_sample(&t->rto, rtt);
+    if (flags.sweep && (kind == REPLY_OK || kind == REPLY_REORDERED))
+        sweep_answer(p, wire_seq, from, 1, now);
+    INSTR_STOP(STAGE_STATS, t_stats, 1);
+
+    INSTR_START(t_output);
+    if (flags.format != FORMAT_TEXT) {
+        record_reply(p, kind, from, ttl, icmp_len, rtt, krtt, now);
+    } else if (flags.flood) {
+        if (kind != REPLY_DUP && kind != REPLY_LATE)
+            flood_mark('\b');
+    } else if (!flags.quiet && (!flags.sweep || flags.verbose)) {
+        static const char *tags[] = {
+            [REPLY_OK] = "", [REPLY_DUP] = " (DUP!)",
+            [REPLY_REORDERED] = " (out of order)", [REPLY_LATE] = " (late)"
+        };
+        char from_str[INET_ADDRSTRLEN];
+        /* actual  sender */
+        fmt_ipv4(from_str, from);
+
+        const double rtt_ms = (double) rtt / NS_PER_MS;
+        if (krtt >= 0)
+            ping_msg(MSG_PING_REPLY_KTS, (long) icmp_len, from_str, p->seq, ttl,
+                     rtt_ms, (double) krtt / NS_PER_MS, tags[kind]);
+        else
+            ping_msg(MSG_PING_REPLY, (long) icmp_len, from_str, p->seq, ttl, rtt_ms, tags[kind]);
+    }
+    INSTR_STOP(STAGE_OUTPUT, t_output, 1);
+}
+
+/*
+** Parses one IP datagram carrying ICMP, in place: `krx_ns` is its kernel
+** RX timestamp (0 if none), `rx_ns` when it arrived (CLOCK_MONOTONIC).
+*/
+void pkt_parse_ip(const char *buf, size_t bytes, int id, int64_t krx_ns, uint64_t rx_ns) {
+    if (bytes < sizeof(struct ip)) {
+        INSTR_DROP(DROP_SHORT);
+        return;
+    }
+
+    /* 1. Parse IP Header */
+    const struct ip *ip = (const struct ip *) buf;
+    size_t hlen = ip->ip_hl * 4;
+
+    if (bytes < hlen + sizeof(struct my_icmp_header)) {
+        INSTR_DROP(DROP_SHORT);
+        return;
+    }
+
+    /* 2. Parse ICMP Header */
+    const struct my_icmp_header *icmp = (const struct my_icmp_header *) (buf + hlen);
+    size_t icmp_len = bytes - hlen;
+
+    /* 3. Validate Checksum: summed with its checksum field, a valid message folds to 0 */
+    INSTR_START(t_csum);
+    const uint16_t folded = csum_fold(csum_partial(icmp, icmp_len, 0));
+    INSTR_STOP(STAGE_CHECKSUM, t_csum, 1);
+    if (folded != 0) {
+        /* Silently drop corrupted packets or warn if verbose */
+        INSTR_DROP(DROP_CHECKSUM);
+        return;
+    }
+
+    /* 4. Handle Echo Reply */
+    if (icmp->type == ICMP_ECHOREPLY) {
+        if (ntohs(icmp->id) == (id & 0xFFFF))
+            process_reply(ip->ip_src, ip->ip_ttl, icmp, icmp_len, krx_ns, rx_ns);
+        else
+            INSTR_DROP(DROP_FOREIGN_ID);
+    }
+    /* 5. Handle Errors (TTL Exceeded, etc.) */
+    else if (icmp->type == ICMP_TIME_EXCEEDED || icmp->type == ICMP_DEST_UNREACH)
+        handle_error_packet(ip, icmp, icmp_len, id);
+    else
+        INSTR_DROP(DROP_ICMP_TYPE);
+}
+
+/* Parses one datagram read from the raw socket (IP header included) */
+void pkt_parse_raw(const struct msghdr *msg, size_t bytes, int id) {
+    pkt_parse_ip(msg->msg_iov[0].iov_base, bytes, id,
+                 flags.kernel_ts ? kts_from_msg(msg) : 0, now_ns());
+}
+
+/*
+** Parses one datagram read from an ICMP datagram socket: the kernel already
+** checked the checksum and the id, and strips the IP header. The source
+** comes from msg_name and the TTL from the IP_TTL cmsg (IP_RECVTTL). Errors
+** do not arrive here but on the error queue (IP_RECVERR).
+*/
+void pkt_parse_dgram(const struct msghdr *msg, size_t bytes, int id) {
+    const struct my_icmp_header *icmp = msg->msg_iov[0].iov_base;
+    const struct sockaddr_in *from = msg->msg_name;
+    int ttl = 0;
+
+    if (bytes < sizeof(struct my_icmp_header) || msg->msg_namelen < sizeof(*from)) {
+        INSTR_DROP(DROP_SHORT);
+        return;
+    }
+    if (icmp->type != ICMP_ECHOREPLY) {
+        INSTR_DROP(DROP_ICMP_TYPE);
+        return;
+    }
+    if (ntohs(icmp->id) != (id & 0xFFFF)) {
+        INSTR_DROP(DROP_FOREIGN_ID);
+        return;
+    }
+
+    for (struct cmsghdr *c = CMSG_FIRSTHDR((struct msghdr *) msg); c; c = CMSG_NXTHDR((struct msghdr *) msg, c)) {
+        if (c->cmsg_level == IPPROTO_IP && c->cmsg_type == IP_TTL)
+            ft_memcpy(&ttl, CMSG_DATA(c), sizeof(ttl));
+    }
+
+    process_reply(from->sin_addr, ttl, icmp, bytes, flags.kernel_ts ? kts_from_msg(msg) : 0, now_ns());
+}
+
+/* Drains the non-blocking socket in batches until EAGAIN or stop */
+void recv_packets(int sock, int id, t_rx_batch *rx) {
+    while (!should_stop) {
+        for (int i = 0; i < IO_BATCH; i++) {
+            rx->msgs[i].msg_len = 0;
+            rx->msgs[i].msg_hdr.msg_controllen = RX_CTRL_LEN;
+            rx->msgs[i].msg_hdr.msg_namelen = sizeof(rx->names[i]);
+        }
+
+        INSTR_START(t_recv);
+        int n = g_transport->recv(sock, rx->msgs, IO_BATCH);
+        INSTR_STOP(STAGE_RECV, t_recv, n > 0 ? n : 0);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                return;
+            ping_msg(MSG_ERR_RECVMSG, strerror(errno));
+            return;
+        }
+
+        g_rx_reads += n;
+        INSTR_START(t_parse);
+        for (int i = 0; i < n; i++)
+            g_transport->parse(&rx->msgs[i].msg_hdr, rx->msgs[i].msg_len, id);
+        INSTR_STOP(STAGE_PARSE, t_parse, n);
+
+        /* A short batch means the queue is empty */
+        if (n < IO_BATCH)
+            return;
+    }
+}
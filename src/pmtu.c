@@ -0,0 +1,323 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "libft/libft.h"
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+/*
+** Path MTU discovery (--pmtu)
+** ---------------------------
+** Finds the largest IP datagram that gets to the target and back with DF
+** set, so that no router fragments it on the way (IP_PMTUDISC_PROBE, set in
+** transport.c). A round sends up to PMTU_PROBES sizes at once, spread
+** evenly over the sizes still in question, and waits until each one is
+** settled:
+**
+**   echo reply            -> fits: the path MTU is at least that
+**   Frag Needed           -> too big: at most the next-hop MTU the router
+**                            reports (RFC 1191), which the next round tries
+**   EMSGSIZE              -> too big for our own interface
+**   timeout, other errors -> too big too: a black hole drops what does not
+**                            fit without a word
+**
+** Each round cuts the range to about 1/PMTU_PROBES of it, so the search
+** takes O(log n) rounds of one RTT each, or of -W (the --rto timeout with
+** --rto) when a size is dropped silently. Only replies raise the answer, so
+** a lost probe can make it too low but never too high.
+**
+** The probes of a round are told apart by their wire sequence numbers and
+** go through the probe ring like any other; the round only reads back how
+** each one ended. The first range goes up to the MTU of the route (IP_MTU
+** on a UDP socket connected to the target, which sends nothing) or to -s
+** plus the headers.
+*/
+
+#define PMTU_HEADERS ((int) (sizeof(struct ip) + PKT_HDR_LEN))
+
+static t_pmtu g_pmtu;   /* the search pmtu_error() reports to */
+
+void pmtu_init(t_pmtu *m, int hi) {
+    ft_memset(m, 0, sizeof(*m));
+    m->lo = PMTU_MIN - 1;
+    m->hi = hi;
+}
+
+static void plan_add(t_pmtu *m, int size) {
+    if (size <= m->lo || size > m->hi || m->nsizes == PMTU_SIZES)
+        return;
+    for (int i = 0; i < m->nsizes; i++)
+        if (m->sizes[i] == size)
+            return;
+    m->sizes[m->nsizes] = size;
+    m->verdicts[m->nsizes] = PMTU_WAIT;
+    m->next_mtus[m->nsizes] = 0;
+    m->nsizes++;
+}
+
+/* Picks the sizes of the next round; 0 once the range is down to one size */
+int pmtu_plan(t_pmtu *m) {
+    const long span = m->hi - m->lo;
+
+    m->nsizes = 0;
+    if (span <= 0)
+        return 0;
+    /* Until something answers: does the target answer at all */
+    plan_add(m, PMTU_MIN);
+    plan_add(m, m->hint);
+    for (int i = 1; i <= PMTU_PROBES; i++)
+        plan_add(m, m->lo + (int) ((span * i + PMTU_PROBES - 1) / PMTU_PROBES));
+    return m->nsizes;
+}
+
+/* Narrows the range by what the round's probes came to */
+void pmtu_update(t_pmtu *m) {
+    int lo = m->lo;
+    int hi = m->hi;
+
+    for (int i = 0; i < m->nsizes; i++)
+        if (m->verdicts[i] == PMTU_FITS && m->sizes[i] > lo)
+            lo = m->sizes[i];
+    for (int i = 0; i < m->nsizes; i++) {
+        const int next_mtu = m->next_mtus[i];
+        int limit = m->sizes[i] - 1;
+
+        /* Not settled, or lost although a larger size got through */
+        if (m->verdicts[i] == PMTU_WAIT || m->verdicts[i] == PMTU_FITS || m->sizes[i] <= lo)
+            continue;
+        if (m->verdicts[i] == PMTU_TOO_BIG && next_mtu >= PMTU_MIN && next_mtu < m->sizes[i]) {
+            limit = next_mtu;
+            m->hint = next_mtu;
+        }
+        if (limit < hi)
+            hi = limit;
+    }
+    /* The path changed under us: what came back is what counts */
+    if (hi < lo)
+        hi = lo;
+    m->lo = lo;
+    m->hi = hi;
+    m->rounds++;
+}
+
+/* An ICMP error about one of our probes (pkt_report_error) */
+void pmtu_error(uint16_t wire_seq, uint8_t type, uint8_t code, uint16_t next_mtu) {
+    t_pmtu *m = &g_pmtu;
+
+    for (int i = 0; i < m->nsizes; i++) {
+        if (m->wire_seqs[i] != wire_seq || m->verdicts[i] != PMTU_WAIT)
+            continue;
+        if (type == ICMP_DEST_UNREACH && code == ICMP_FRAG_NEEDED) {
+            m->verdicts[i] = PMTU_TOO_BIG;
+            m->next_mtus[i] = next_mtu;
+        } else {
+            m->verdicts[i] = PMTU_LOST;
+        }
+        return;
+    }
+}
+
+/* The largest size worth trying: -s plus the headers, else the route's MTU */
+static int pmtu_ceiling(const t_target *t) {
+    struct sockaddr_in to = t->addr;
+    socklen_t len = sizeof(int);
+    int mtu = 0;
+
+    if (flags.size_set)
+        return flags.payload_size + PMTU_HEADERS;
+    if (g_transport == &g_transport_sim)
+        return g_sim.ifmtu > 0 ? g_sim.ifmtu : PMTU_MAX;
+
+    /* Sends larger than the interface takes fail with EMSGSIZE anyway */
+    const int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    to.sin_port = htons(9);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &to, sizeof(to)) < 0
+        || getsockopt(fd, IPPROTO_IP, IP_MTU, &mtu, &len) < 0 || mtu < PMTU_MIN || mtu > PMTU_MAX)
+        mtu = PMTU_MAX;
+    if (fd >= 0)
+        close(fd);
+    return mtu;
+}
+
+/* Slot `i` of the batch becomes a probe of `len` payload bytes */
+static void stamp(t_tx_batch *tx, int i, uint16_t wire_seq, size_t len) {
+    struct my_icmp_header *icmp = (struct my_icmp_header *) tx->hdrs[i];
+
+    ft_memcpy(icmp, tx->tpl.hdr, PKT_HDR_LEN);
+    icmp->sequence = htons(wire_seq);
+    /* The template's partial sum is for its whole payload: sum this size's share */
+    icmp->checksum = csum_fold(csum_partial(tx->tpl.payload, len, csum_partial(icmp, PKT_HDR_LEN, 0)));
+    tx->iov[i][1].iov_len = len;
+}
+
+static void send_round(int sock, t_sched *s, t_tx_batch *tx, t_pmtu *m) {
+    t_target *t = &g_targets[0];
+    const uint64_t sent_ns = now_ns();
+
+    for (int i = 0; i < m->nsizes; i++) {
+        const uint16_t seq = (uint16_t) atomic_fetch_add_explicit(&t->seq, 1, memory_order_relaxed);
+
+        m->wire_seqs[i] = s->wire_seq;
+        probe_track(s->wire_seq, 0, seq, sent_ns);
+        stamp(tx, i, s->wire_seq, (size_t) (m->sizes[i] - PMTU_HEADERS));
+        tx->msgs[i].msg_hdr.msg_name = &t->addr;
+        s->wire_seq++;
+    }
+
+    /* sendmmsg() stops at the first failing message: settle it, go on */
+    int off = 0;
+    while (off < m->nsizes) {
+        int done = g_transport->send(sock, tx->msgs + off, (unsigned int) (m->nsizes - off));
+        if (done < 0) {
+            const int err = errno;
+
+            if (err == EINTR)
+                continue;
+            /* Too big for our interface, or not sent at all: no answer is coming */
+            if (err != EMSGSIZE && !flags.quiet)
+                ping_msg(MSG_ERR_SENDTO, strerror(err));
+            m->verdicts[off] = err == EMSGSIZE ? PMTU_TOO_BIG : PMTU_LOST;
+            probe_forget(m->wire_seqs[off]);
+            done = 0;
+            off++;
+        }
+        for (int i = off; i < off + done; i++) {
+            STAT_INC(t->stats.tx);
+            g_stats.tx++;
+        }
+        off += done;
+    }
+}
+
+/* Reads back how the round's probes ended; 1 once none is left waiting */
+static int round_settled(t_pmtu *m) {
+    int waiting = 0;
+
+    for (int i = 0; i < m->nsizes; i++) {
+        if (m->verdicts[i] != PMTU_WAIT)
+            continue;
+        /* A late reply still fits */
+        if (g_probes[m->wire_seqs[i]].state == PROBE_REPLIED)
+            m->verdicts[i] = PMTU_FITS;
+        else if (g_probes[m->wire_seqs[i]].state == PROBE_EXPIRED)
+            m->verdicts[i] = PMTU_LOST;
+        else
+            waiting++;
+    }
+    return waiting == 0;
+}
+
+static void report_round(const t_pmtu *m) {
+    if (flags.format != FORMAT_TEXT)
+        record_pmtu(m, 0);
+    else if (!flags.quiet && m->hi >= PMTU_MIN)
+        ping_msg(MSG_PMTU_ROUND, m->rounds, m->lo >= PMTU_MIN ? m->lo : PMTU_MIN, m->hi, m->nsizes);
+    out_flush();
+}
+
+static void report_result(const t_pmtu *m, int done) {
+    const char *name = g_targets[0].name;
+
+    if (flags.format != FORMAT_TEXT)
+        record_pmtu(m, done);
+    else if (!done)
+        ping_msg(MSG_PMTU_PARTIAL, name, m->lo >= PMTU_MIN ? m->lo : PMTU_MIN, m->hi, m->rounds + 1);
+    else if (m->lo >= PMTU_MIN)
+        ping_msg(MSG_PMTU_RESULT, name, m->lo, m->rounds);
+    else
+        ping_msg(MSG_PMTU_NONE, name, PMTU_MIN);
+}
+
+/*
+** Runs the search against the only target until the range is down to one
+** size or a signal or -w stops it. Returns the path MTU, 0 if nothing answered,
+** -1 if interrupted.
+*/
+int pmtu_run(int sock, int id, int sig_fd) {
+    t_target *t = &g_targets[0];
+    const int hi = pmtu_ceiling(t);
+    t_sched sched = {.id = id, .end = 1, .limit = -1};
+    t_pmtu *m = &g_pmtu;
+    t_tx_batch tx;
+    t_rx_batch rx;
+
+    /* The template and the receive buffers are sized for the largest probe */
+    flags.payload_size = hi - PMTU_HEADERS;
+    io_batch_init(&tx, &rx, id);
+    g_stats.start_ns = now_ns();
+    pmtu_init(m, hi);
+    if (flags.format == FORMAT_TEXT) {
+        char addr[INET_ADDRSTRLEN];
+
+        fmt_ipv4(addr, t->addr.sin_addr);
+        ping_msg(MSG_PMTU_HEADER, t->name, addr, PMTU_MIN, hi);
+    }
+
+    const int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0)
+        ping_fatal(MSG_ERR_EPOLL, strerror(errno));
+    epoll_watch(epfd, sock);
+    epoll_watch(epfd, sig_fd);
+
+    /* -w stops the search like a signal: what is known so far is reported */
+    int deadline_fd = -1;
+    if (flags.timeout > 0) {
+        const struct timespec deadline = {.tv_sec = flags.timeout, .tv_nsec = 0};
+        const struct timespec none = {0, 0};
+
+        deadline_fd = timer_open(0, &deadline, &none);
+        epoll_watch(epfd, deadline_fd);
+    }
+
+    while (!should_stop && pmtu_plan(m) > 0) {
+        send_round(sock, &sched, &tx, m);
+        while (!should_stop) {
+            struct epoll_event events[3];
+
+            probes_expire(now_ns());
+            if (round_settled(m))
+                break;
+
+            const int n = epoll_wait(epfd, events, 3, probes_wait_ms(-1, now_ns()));
+            g_io_syscalls++;
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                ping_fatal(MSG_ERR_EPOLL, strerror(errno));
+            }
+            for (int i = 0; i < n; i++) {
+                if (events[i].data.fd == sock) {
+                    if (events[i].events & EPOLLERR)
+                        transport_drain_errqueue(sock);
+                    recv_packets(sock, sched.id, &rx);
+                } else if (events[i].data.fd == deadline_fd) {
+                    should_stop = 1;
+                } else if (events[i].data.fd == sig_fd && signal_read(sig_fd)) {
+                    should_stop = 1;
+                }
+            }
+        }
+        if (should_stop)
+            break;
+        pmtu_update(m);
+        report_round(m);
+    }
+
+    const int done = m->lo >= m->hi;
+    report_result(m, done);
+    out_flush();
+    statsfile_flush();
+    io_batch_free(&tx, &rx);
+    close(epfd);
+    if (deadline_fd >= 0)
+        close(deadline_fd);
+    if (!done)
+        return -1;
+    return m->lo >= PMTU_MIN ? m->lo : 0;
+}
@@ -0,0 +1,239 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "libft/libft.h"
+
+#include <stdlib.h>
+#include <netinet/in.h>
+
+/*
+** In-flight probe ring
+** --------------------
+** One slot per possible wire sequence number. A slot records which target
+** and per-target sequence the probe was for, when it was sent and whether
+** it has been answered, so every reply is classified with one lookup:
+**
+**   PENDING  -> first reply: RTT = now - sent_ns, no payload timestamp needed
+**   REPLIED  -> duplicate (DUP!)
+**   EXPIRED  -> late: the reply came after the probe's deadline
+**
+** Replies whose per-target sequence is older than one already answered
+** are out of order.
+**
+** Every pending probe also has a deadline in a binary min-heap: -W after
+** it was sent, or its target's adaptive timeout with --rto (rto.c), so the
+** deadlines of different targets are not in send order. A probe's slot
+** keeps its heap index, so a reply takes it out in O(log n) and the heap
+** only ever holds pending probes. probes_expire() pops the deadlines that
+** have passed and counts those probes as timeouts, and the loops sleep no
+** longer than probes_until() so that happens on time.
+*/
+
+typedef struct s_deadline {
+    uint64_t at;         /* CLOCK_MONOTONIC */
+    uint16_t wire_seq;
+} t_deadline;
+
+static _Thread_local t_deadline *g_heap = NULL;   /* PROBE_MAP_SIZE entries at most */
+static _Thread_local uint32_t g_heap_len = 0;
+
+static void heap_place(uint32_t i, t_deadline d) {
+    g_heap[i] = d;
+    g_probes[d.wire_seq].heap = i;
+}
+
+static void sift_up(uint32_t i) {
+    const t_deadline d = g_heap[i];
+
+    while (i > 0 && g_heap[(i - 1) / 2].at > d.at) {
+        heap_place(i, g_heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    heap_place(i, d);
+}
+
+static void sift_down(uint32_t i) {
+    const t_deadline d = g_heap[i];
+
+    for (;;) {
+        uint32_t c = 2 * i + 1;
+
+        if (c >= g_heap_len)
+            break;
+        if (c + 1 < g_heap_len && g_heap[c + 1].at < g_heap[c].at)
+            c++;
+        if (g_heap[c].at >= d.at)
+            break;
+        heap_place(i, g_heap[c]);
+        i = c;
+    }
+    heap_place(i, d);
+}
+
+static void heap_push(uint16_t wire_seq, uint64_t at) {
+    if (!g_heap) {
+        g_heap = malloc(PROBE_MAP_SIZE * sizeof(*g_heap));
+        if (!g_heap)
+            ping_fatal(MSG_ERR_OUT_OF_MEMORY);
+    }
+    g_heap[g_heap_len] = (t_deadline){.at = at, .wire_seq = wire_seq};
+    sift_up(g_heap_len++);
+}
+
+static void heap_remove(uint32_t i) {
+    if (--g_heap_len == i)
+        return;
+    const uint64_t at = g_heap[i].at;
+    heap_place(i, g_heap[g_heap_len]);
+    if (g_heap[i].at < at)
+        sift_up(i);
+    else
+        sift_down(i);
+}
+
+static uint64_t deadline_of(const t_probe *p) {
+    return g_heap[p->heap].at;
+}
+
+static void probe_timed_out(const t_probe *p, uint64_t now) {
+    t_target *t = &g_targets[p->target];
+
+    STAT_INC(t->stats.timeouts);
+    g_stats.timeouts++;
+    window_timeout(now);
+    if (flags.format != FORMAT_TEXT) {
+        record_timeout(p, now);
+    } else if (flags.rto && !flags.quiet && !flags.flood) {
+        char addr[INET_ADDRSTRLEN];
+
+        fmt_ipv4(addr, t->addr.sin_addr);
+        ping_msg(MSG_PING_TIMEOUT, addr, p->seq, (double) (deadline_of(p) - p->sent_ns) / NS_PER_MS);
+    }
+}
+
+void probe_track(uint16_t wire_seq, size_t target_idx, uint16_t seq, uint64_t sent_ns) {
+    t_probe *p = &g_probes[wire_seq];
+
+    /* The ring wrapped before this probe was answered or expired */
+    if (p->state == PROBE_PENDING) {
+        if (p->target < g_ntargets)
+            probe_timed_out(p, sent_ns);
+        heap_remove(p->heap);
+    }
+
+    p->target = (uint32_t) target_idx;
+    p->seq = seq;
+    p->sent_ns = sent_ns;
+    p->ktx_ns = 0;
+    p->state = PROBE_PENDING;
+    heap_push(wire_seq, sent_ns + (uint64_t) rto_get(&g_targets[target_idx].rto));
+}
+
+/*
+** O(1) reply demultiplexing keyed by (source address, id, sequence): the id
+** has already been checked by the caller, the wire sequence indexes the
+** ring and the source must match the address the probe was sent to.
+*/
+t_probe *probe_lookup(uint16_t wire_seq, struct in_addr src) {
+    t_probe *p = &g_probes[wire_seq];
+
+    if (p->state == PROBE_FREE || p->target >= g_ntargets)
+        return NULL;
+    if (g_targets[p->target].addr.sin_addr.s_addr != src.s_addr)
+        return NULL;
+    return p;
+}
+
+/* Classifies a matched echo reply and updates the per-target/total counters */
+t_reply_kind probe_reply(t_probe *p, uint64_t now) {
+    t_target *t = &g_targets[p->target];
+
+    if (p->state == PROBE_REPLIED) {
+        STAT_INC(t->stats.dup);
+        g_stats.dup++;
+        window_dup(now);
+        return REPLY_DUP;
+    }
+    if (p->state == PROBE_EXPIRED || now > deadline_of(p)) {
+        /* Counted as a timeout by the sweep, or it would have been */
+        if (p->state == PROBE_PENDING) {
+            probe_timed_out(p, now);
+            heap_remove(p->heap);
+        }
+        p->state = PROBE_REPLIED;
+        STAT_INC(t->stats.late);
+        g_stats.late++;
+        return REPLY_LATE;
+    }
+
+    heap_remove(p->heap);
+    p->state = PROBE_REPLIED;
+    STAT_INC(t->stats.rx);
+    g_stats.rx++;
+
+    /* Sequence numbers wrap: compare as a signed 16-bit distance */
+    uint32_t last = atomic_load_explicit(&t->last_seq, memory_order_relaxed);
+    do {
+        if (last && (int16_t) (p->seq - (uint16_t) (last - 1)) < 0) {
+            STAT_INC(t->stats.reorder);
+            g_stats.reorder++;
+            return REPLY_REORDERED;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&t->last_seq, &last, (uint32_t) p->seq + 1,
+                                                    memory_order_relaxed, memory_order_relaxed));
+    return REPLY_OK;
+}
+
+/* Expires the pending probes whose deadline has passed, earliest first */
+void probes_expire(uint64_t now) {
+    while (g_heap_len > 0 && g_heap[0].at < now) {
+        t_probe *p = &g_probes[g_heap[0].wire_seq];
+
+        p->state = PROBE_EXPIRED;
+        probe_timed_out(p, now);
+        if (flags.rto)
+            rto_backoff(&g_targets[p->target].rto, (int64_t) (g_heap[0].at - p->sent_ns));
+        heap_remove(0);
+    }
+}
+
+/* Nanoseconds until the next deadline, -1 if no probe is pending */
+int64_t probes_until(uint64_t now) {
+    if (g_heap_len == 0)
+        return -1;
+    return g_heap[0].at > now ? (int64_t) (g_heap[0].at - now) : 0;
+}
+
+/* An epoll_wait() timeout (-1: none) cut short to wake up for the next deadline */
+int probes_wait_ms(int wait_ms, uint64_t now) {
+    const int64_t until = probes_until(now);
+
+    if (until < 0)
+        return wait_ms;
+    /* Rounded up: waking before the deadline would expire nothing */
+    const int64_t ms = (until + 999999) / 1000000;
+    return wait_ms >= 0 && wait_ms < ms ? wait_ms : (int) (ms < INT32_MAX ? ms : INT32_MAX);
+}
+
+/* A probe that will get no echo reply (its send failed, an ICMP error came back) is not waited for */
+void probe_forget(uint16_t wire_seq) {
+    t_probe *p = &g_probes[wire_seq];
+
+    if (p->state != PROBE_PENDING)
+        return;
+    heap_remove(p->heap);
+    p->state = PROBE_FREE;
+}
+
+/* Releases this thread's deadline heap; the next probe allocates it again */
+void probes_thread_free(void) {
+    free(g_heap);
+    g_heap = NULL;
+    g_heap_len = 0;
+}
+
+/* Forgets every probe of this thread (tests starting a new run) */
+void probes_reset(void) {
+    for (size_t i = 0; i < PROBE_MAP_SIZE; i++)
+        g_probes[i].state = PROBE_FREE;
+    probes_thread_free();
+}
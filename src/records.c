@@ -0,0 +1,456 @@
+#include "ft_ping.h"
+#include "ft_records.h"
+#include "libft/libft.h"
+
+#include <time.h>
+
+/*
+** Structured output (--format jsonl|binary)
+** -----------------------------------------
+** Every probe event becomes one t_record (ft_records.h): a reply, duplicate,
+** timeout or ICMP error, plus the stream header and the summaries. In binary
+** mode the record itself is written to stdout; in JSON Lines mode it is
+** turned into one object per line with the same fields, plus the target
+** name. Both go through the output sink, so they are buffered and never
+** interleave between worker threads.
+**
+** Times are CLOCK_REALTIME nanoseconds, taken from the CLOCK_MONOTONIC
+** timestamps the loop already has plus the offset between the two clocks
+** read at start. RTTs are integer nanoseconds. With -q the probe events are
+** left out and only the header and summaries are written.
+*/
+
+#define JSON_LINE_MAX 1024
+
+static int64_t g_real_offset = 0;   /* CLOCK_REALTIME - CLOCK_MONOTONIC */
+
+static const char *g_rec_names[] = {
+    [REC_START] = "start", [REC_REPLY] = "reply", [REC_DUPLICATE] = "duplicate",
+    [REC_TIMEOUT] = "timeout", [REC_ERROR] = "error", [REC_SUMMARY] = "summary",
+    [REC_WINDOW] = "window", [REC_PMTU] = "pmtu", [REC_HOP] = "hop"
+};
+
+typedef struct s_json {
+    char   buf[JSON_LINE_MAX];
+    size_t len;
+} t_json;
+
+static void json_raw(t_json *j, const char *s, size_t n) {
+    if (j->len + n > sizeof(j->buf) - 2)
+        n = sizeof(j->buf) - 2 - j->len;
+    ft_memcpy(j->buf + j->len, s, n);
+    j->len += n;
+}
+
+/* ,"key": */
+static void json_key(t_json *j, const char *key) {
+    const size_t n = ft_strlen(key);
+
+    if (j->len + n + 32 > sizeof(j->buf) - 2)
+        return;
+    j->buf[j->len] = j->len > 0 ? ',' : '{';
+    j->buf[j->len + 1] = '"';
+    j->len += 2;
+    ft_memcpy(j->buf + j->len, key, n);
+    j->len += n;
+    j->buf[j->len++] = '"';
+    j->buf[j->len++] = ':';
+}
+
+static void json_u64(t_json *j, const char *key, uint64_t v) {
+    json_key(j, key);
+    if (j->len + 20 < sizeof(j->buf) - 2)
+        j->len += fmt_u64(j->buf + j->len, v);
+}
+
+static void json_i64(t_json *j, const char *key, int64_t v) {
+    if (v < 0) {
+        json_key(j, key);
+        json_raw(j, "-", 1);
+        if (j->len + 20 < sizeof(j->buf) - 2)
+            j->len += fmt_u64(j->buf + j->len, (uint64_t) 0 - (uint64_t) v);
+        return;
+    }
+    json_u64(j, key, (uint64_t) v);
+}
+
+/* A string value: quotes, backslashes and control characters escaped */
+static void json_str(t_json *j, const char *key, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+
+    json_key(j, key);
+    json_raw(j, "\"", 1);
+    for (; *s && j->len + 8 < sizeof(j->buf) - 2; s++) {
+        const unsigned char c = (unsigned char) *s;
+
+        if (c == '"' || c == '\\') {
+            j->buf[j->len++] = '\\';
+            j->buf[j->len++] = (char) c;
+        } else if (c < 0x20) {
+            json_raw(j, "\\u00", 4);
+            j->buf[j->len++] = hex[c >> 4];
+            j->buf[j->len++] = hex[c & 0xF];
+        } else {
+            j->buf[j->len++] = (char) c;
+        }
+    }
+    json_raw(j, "\"", 1);
+}
+
+static void json_addr(t_json *j, const char *key, uint32_t addr) {
+    char s[16];
+
+    fmt_ipv4(s, (struct in_addr){.s_addr = addr});
+    json_str(j, key, s);
+}
+
+static void json_end(t_json *j) {
+    j->buf[j->len++] = '}';
+    j->buf[j->len++] = '\n';
+    out_write(j->buf, j->len);
+}
+
+/* One JSON object per probe record; the fields of a type are the ones it sets */
+static void emit_json(const t_record *r) {
+    t_json j = {.len = 0};
+
+    json_str(&j, "type", g_rec_names[r->type]);
+    json_u64(&j, "time_ns", r->time_ns);
+    if (r->target != REC_ALL && r->type != REC_START)
+        json_str(&j, "target", g_targets[r->target].name);
+
+    switch (r->type) {
+        case REC_START:
+            json_u64(&j, "version", r->version);
+            json_u64(&j, "targets", r->start.ntargets);
+            json_u64(&j, "data_bytes", r->start.data_bytes);
+            json_u64(&j, "interval_ns", r->start.interval_ns);
+            json_u64(&j, "wait_ms", r->start.wait_ms);
+            break;
+        case REC_REPLY:
+        case REC_DUPLICATE:
+            json_addr(&j, "addr", r->probe.addr);
+            json_u64(&j, "seq", r->probe.seq);
+            json_u64(&j, "bytes", r->probe.bytes);
+            json_u64(&j, "ttl", r->probe.ttl);
+            json_i64(&j, "rtt_ns", r->probe.rtt_ns);
+            if (r->probe.krtt_ns >= 0)
+                json_i64(&j, "krtt_ns", r->probe.krtt_ns);
+            if (r->flags & REC_F_REORDERED)
+                json_raw(&j, ",\"reordered\":true", 17);
+            if (r->flags & REC_F_LATE)
+                json_raw(&j, ",\"late\":true", 12);
+            break;
+        case REC_TIMEOUT:
+            json_addr(&j, "addr", r->probe.addr);
+            json_u64(&j, "seq", r->probe.seq);
+            break;
+        case REC_ERROR:
+            json_addr(&j, "addr", r->probe.addr);
+            json_u64(&j, "seq", r->probe.seq);
+            json_u64(&j, "icmp_type", r->probe.icmp_type);
+            json_u64(&j, "icmp_code", r->probe.icmp_code);
+            if (r->probe.next_mtu)
+                json_u64(&j, "next_mtu", r->probe.next_mtu);
+            break;
+        case REC_PMTU:
+            json_u64(&j, "round", r->pmtu.round);
+            json_u64(&j, "sizes", r->pmtu.sizes);
+            json_u64(&j, "low", r->pmtu.low);
+            json_u64(&j, "high", r->pmtu.high);
+            if (r->pmtu.next_mtu)
+                json_u64(&j, "next_mtu", r->pmtu.next_mtu);
+            if (r->flags & REC_F_DONE)
+                json_raw(&j, ",\"done\":true", 12);
+            break;
+    }
+    json_end(&j);
+}
+
+static void emit(const t_record *r) {
+    if (flags.format == FORMAT_BINARY)
+        out_write((const char *) r, sizeof(*r));
+    else
+        emit_json(r);
+}
+
+static t_record rec_new(uint8_t type, uint32_t target, uint64_t mono_ns) {
+    return (t_record){
+        .type = type,
+        .version = REC_VERSION,
+        .target = target,
+        .time_ns = (uint64_t) ((int64_t) mono_ns + g_real_offset)
+    };
+}
+
+/* Probe events of `p`; the caller fills in what it knows */
+static t_record rec_probe(uint8_t type, const t_probe *p, struct in_addr addr, uint64_t now) {
+    t_record r = rec_new(type, p->target, now);
+
+    r.probe.rtt_ns = -1;
+    r.probe.krtt_ns = -1;
+    r.probe.addr = addr.s_addr;
+    r.probe.seq = p->seq;
+    return r;
+}
+
+/* Reads the clock offset and writes the stream header */
+void records_start(void) {
+    struct timespec mono;
+    struct timespec real;
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    clock_gettime(CLOCK_REALTIME, &real);
+    g_real_offset = ((int64_t) real.tv_sec - mono.tv_sec) * NS_PER_SEC + (real.tv_nsec - mono.tv_nsec);
+
+    t_record r = rec_new(REC_START, REC_ALL, now_ns());
+    ft_memcpy(r.start.magic, REC_MAGIC, sizeof(r.start.magic));
+    r.start.record_size = REC_SIZE;
+    r.start.ntargets = (uint32_t) g_ntargets;
+    r.start.data_bytes = (uint32_t) flags.payload_size;
+    r.start.interval_ms = (uint32_t) (flags.interval_ns / 1000000);
+    r.start.interval_ns = (uint64_t) flags.interval_ns;
+    r.start.wait_ms = (uint32_t) flags.wait_ms;
+    emit(&r);
+}
+
+void record_reply(const t_probe *p, t_reply_kind kind, struct in_addr from, int ttl,
+                  size_t bytes, int64_t rtt_ns, int64_t krtt_ns, uint64_t now) {
+    if (flags.quiet)
+        return;
+
+    t_record r = rec_probe(kind == REPLY_DUP ? REC_DUPLICATE : REC_REPLY, p, from, now);
+    r.probe.rtt_ns = rtt_ns;
+    r.probe.krtt_ns = krtt_ns;
+    r.probe.bytes = (uint16_t) (bytes > UINT16_MAX ? UINT16_MAX : bytes);
+    r.probe.ttl = (uint8_t) ttl;
+    if (kind == REPLY_REORDERED)
+        r.flags |= REC_F_REORDERED;
+    if (kind == REPLY_LATE)
+        r.flags |= REC_F_LATE;
+    emit(&r);
+}
+
+void record_timeout(const t_probe *p, uint64_t now) {
+    if (flags.quiet)
+        return;
+
+    const t_record r = rec_probe(REC_TIMEOUT, p, g_targets[p->target].addr.sin_addr, now);
+    emit(&r);
+}
+
+void record_error(const t_probe *p, struct in_addr from, uint8_t type, uint8_t code,
+                  uint16_t next_mtu) {
+    if (flags.quiet)
+        return;
+
+    t_record r = rec_probe(REC_ERROR, p, from, now_ns());
+    r.probe.icmp_type = type;
+    r.probe.icmp_code = code;
+    r.probe.next_mtu = next_mtu;
+    emit(&r);
+}
+
+/* Where the --pmtu search stands after a round; the last one, written with -q too, has REC_F_DONE */
+void record_pmtu(const t_pmtu *m, int done) {
+    if (flags.quiet && !done)
+        return;
+
+    t_record r = rec_new(REC_PMTU, 0, now_ns());
+    r.pmtu.round = (uint32_t) m->rounds;
+    r.pmtu.sizes = (uint32_t) m->nsizes;
+    r.pmtu.low = m->lo >= PMTU_MIN ? (uint32_t) m->lo : 0;
+    r.pmtu.high = m->hi >= PMTU_MIN ? (uint32_t) m->hi : 0;
+    r.pmtu.next_mtu = (uint32_t) m->hint;
+    if (done)
+        r.flags |= REC_F_DONE;
+    emit(&r);
+}
+
+static uint32_t sat32(long v) {
+    return v > (long) UINT32_MAX ? UINT32_MAX : (uint32_t) v;
+}
+
+typedef struct s_summary {
+    long    tx, rx, dup, reorder, late, timeouts;
+    long    errors;                                 /* run totals only, JSON only */
+    int64_t rtt_min, rtt_avg, rtt_max, rtt_mdev;   /* ns; mdev -1 if unknown */
+} t_summary;
+
+/*
+** Summaries are not built from a t_record in JSON mode: the RTTs stay exact
+** integers there, while the binary record holds them as floats.
+*/
+static void emit_summary(uint32_t target, const t_summary *s, uint64_t now) {
+    t_record r = rec_new(REC_SUMMARY, target, now);
+
+    if (flags.format == FORMAT_BINARY) {
+        r.summary.tx = (uint64_t) s->tx;
+        r.summary.rx = (uint64_t) s->rx;
+        r.summary.dup = sat32(s->dup);
+        r.summary.reorder = sat32(s->reorder);
+        r.summary.late = sat32(s->late);
+        r.summary.timeouts = sat32(s->timeouts);
+        r.summary.rtt_min_ns = (float) s->rtt_min;
+        r.summary.rtt_avg_ns = (float) s->rtt_avg;
+        r.summary.rtt_max_ns = (float) s->rtt_max;
+        r.summary.rtt_mdev_ns = (float) s->rtt_mdev;
+        emit(&r);
+        return;
+    }
+
+    t_json j = {.len = 0};
+    json_str(&j, "type", g_rec_names[REC_SUMMARY]);
+    json_u64(&j, "time_ns", r.time_ns);
+    if (target != REC_ALL)
+        json_str(&j, "target", g_targets[target].name);
+    json_i64(&j, "tx", s->tx);
+    json_i64(&j, "rx", s->rx);
+    json_i64(&j, "dup", s->dup);
+    json_i64(&j, "reorder", s->reorder);
+    json_i64(&j, "late", s->late);
+    json_i64(&j, "timeouts", s->timeouts);
+    if (target == REC_ALL)
+        json_i64(&j, "errors", s->errors);
+    if (s->rx > 0) {
+        json_i64(&j, "rtt_min_ns", s->rtt_min);
+        json_i64(&j, "rtt_avg_ns", s->rtt_avg);
+        json_i64(&j, "rtt_max_ns", s->rtt_max);
+        if (s->rtt_mdev >= 0)
+            json_i64(&j, "rtt_mdev_ns", s->rtt_mdev);
+    }
+    /* Send jitter of the paced loops, with the totals only */
+    if (target == REC_ALL && g_pace.jitter.rx > 0) {
+        json_i64(&j, "sends_per_s", (int64_t) (pace_rate() + 0.5));
+        json_i64(&j, "jitter_avg_ns", (int64_t) (g_pace.jitter.mean + 0.5));
+        json_i64(&j, "jitter_p99_ns", stats_percentile(&g_pace.jitter, 0.99));
+        json_i64(&j, "jitter_max_ns", g_pace.jitter.max);
+    }
+    json_end(&j);
+}
+
+/* One summary per target when there are several, then the run totals */
+void records_summary(void) {
+    const uint64_t now = now_ns();
+
+    for (size_t i = 0; g_ntargets > 1 && i < g_ntargets; i++) {
+        const t_target_stats *ts = &g_targets[i].stats;
+
+        if (g_targets[i].state == TARGET_FAILED)
+            continue;
+        t_summary s = {
+            .tx = ts->tx, .rx = ts->rx, .dup = ts->dup, .reorder = ts->reorder,
+            .late = ts->late, .timeouts = ts->timeouts, .rtt_mdev = -1
+        };
+
+        if (s.rx > 0) {
+            s.rtt_min = ts->min;
+            s.rtt_avg = (int64_t) ((double) ts->sum / (double) s.rx + 0.5);
+            s.rtt_max = ts->max;
+        }
+        emit_summary((uint32_t) i, &s, now);
+    }
+
+    t_summary s = {
+        .tx = g_stats.tx, .rx = g_stats.rx, .dup = g_stats.dup, .reorder = g_stats.reorder,
+        .late = g_stats.late, .timeouts = g_stats.timeouts, .errors = g_stats.errors
+    };
+    if (s.rx > 0) {
+        const double var = g_stats.m2 / (double) s.rx;
+
+        s.rtt_min = g_stats.min;
+        s.rtt_avg = (int64_t) (g_stats.mean + 0.5);
+        s.rtt_max = g_stats.max;
+        s.rtt_mdev = (int64_t) (ft_sqrt(var > 0 ? var : 0) + 0.5);
+    }
+    emit_summary(REC_ALL, &s, now);
+}
+
+/* Interval summary of the run totals (--summary), written with -q too */
+void record_window(const t_window_stats *w) {
+    t_record r = rec_new(REC_WINDOW, REC_ALL, w->end_ns);
+
+    if (flags.format == FORMAT_BINARY) {
+        r.window.seconds = sat32(w->seconds);
+        r.window.tx = sat32(w->tx);
+        r.window.rx = sat32(w->rx);
+        r.window.dup = sat32(w->dup);
+        r.window.timeouts = sat32(w->timeouts);
+        r.window.rtt_min_ns = (float) w->rtt_min;
+        r.window.rtt_avg_ns = (float) w->rtt_avg;
+        r.window.rtt_p50_ns = (float) w->rtt_p50;
+        r.window.rtt_p90_ns = (float) w->rtt_p90;
+        r.window.rtt_p99_ns = (float) w->rtt_p99;
+        r.window.rtt_max_ns = (float) w->rtt_max;
+        r.window.rtt_jitter_ns = (float) w->jitter;
+        emit(&r);
+        return;
+    }
+
+    t_json j = {.len = 0};
+    json_str(&j, "type", g_rec_names[REC_WINDOW]);
+    json_u64(&j, "time_ns", r.time_ns);
+    json_i64(&j, "seconds", w->seconds);
+    json_i64(&j, "tx", w->tx);
+    json_i64(&j, "rx", w->rx);
+    json_i64(&j, "dup", w->dup);
+    json_i64(&j, "timeouts", w->timeouts);
+    if (w->rx > 0) {
+        json_i64(&j, "rtt_min_ns", w->rtt_min);
+        json_i64(&j, "rtt_avg_ns", w->rtt_avg);
+        json_i64(&j, "rtt_p50_ns", w->rtt_p50);
+        json_i64(&j, "rtt_p90_ns", w->rtt_p90);
+        json_i64(&j, "rtt_p99_ns", w->rtt_p99);
+        json_i64(&j, "rtt_max_ns", w->rtt_max);
+    }
+    if (w->jitter >= 0)
+        json_i64(&j, "rtt_jitter_ns", w->jitter);
+    json_end(&j);
+}
+
+/* One hop of a --sweep at the end of the run, written with -q too */
+void record_hop(int ttl, const t_hop *h) {
+    const t_stats *s = &h->stats;
+    t_record r = rec_new(REC_HOP, 0, now_ns());
+    int64_t mdev = 0;
+
+    if (s->rx > 0) {
+        const double var = s->m2 / (double) s->rx;
+        mdev = (int64_t) (ft_sqrt(var > 0 ? var : 0) + 0.5);
+    }
+    if (flags.format == FORMAT_BINARY) {
+        r.hop.ttl = (uint32_t) ttl;
+        r.hop.addr = h->addr.s_addr;
+        r.hop.tx = sat32(s->tx);
+        r.hop.rx = sat32(s->rx);
+        r.hop.changes = (uint32_t) h->changes;
+        if (s->rx > 0) {
+            r.hop.rtt_min_ns = (float) s->min;
+            r.hop.rtt_avg_ns = (float) s->mean;
+            r.hop.rtt_max_ns = (float) s->max;
+            r.hop.rtt_mdev_ns = (float) mdev;
+            r.hop.rtt_last_ns = (float) h->last_rtt;
+        }
+        emit(&r);
+        return;
+    }
+
+    t_json j = {.len = 0};
+    json_str(&j, "type", g_rec_names[REC_HOP]);
+    json_u64(&j, "time_ns", r.time_ns);
+    json_str(&j, "target", g_targets[0].name);
+    json_i64(&j, "ttl", ttl);
+    if (h->addr.s_addr)
+        json_addr(&j, "addr", h->addr.s_addr);
+    json_i64(&j, "tx", s->tx);
+    json_i64(&j, "rx", s->rx);
+    if (h->changes > 0)
+        json_i64(&j, "changes", h->changes);
+    if (s->rx > 0) {
+        json_i64(&j, "rtt_min_ns", s->min);
+        json_i64(&j, "rtt_avg_ns", (int64_t) (s->mean + 0.5));
+        json_i64(&j, "rtt_max_ns", s->max);
+        json_i64(&j, "rtt_mdev_ns", mdev);
+        json_i64(&j, "rtt_last_ns", h->last_rtt);
+    }
+    json_end(&j);
+}
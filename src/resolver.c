@@ -0,0 +1,321 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "libft/libft.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <netdb.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+/*
+** Background resolver
+** -------------------
+** With several targets the host names are looked up with getaddrinfo_a()
+** while the event loop is already probing: numeric addresses are ready at
+** once, a name's targets are probed from the moment its answer comes in, and
+** a name that does not resolve is reported and its targets left out. At most
+** --resolve-limit lookups are in flight; the other names wait in a queue.
+**
+** Each name is looked up once however many targets use it, and the answer is
+** kept for --resolve-ttl seconds. Then the name is looked up again in the
+** background: its targets keep the old address until the new one arrives,
+** and for good if that lookup fails. getaddrinfo() does not report the DNS
+** record's own TTL, so the period is the same for every name.
+**
+** glibc completes the lookups on its own threads, which only bump an
+** eventfd; the answers are collected on the main thread by resolver_poll()
+** when the loop sees resolver_fd() readable. That fd is an epoll instance
+** holding the eventfd and the timer for the next re-resolution.
+*/
+
+#define NO_TARGET UINT32_MAX
+
+typedef enum { HOST_IDLE, HOST_QUEUED, HOST_BUSY } t_host_state;
+
+/* One distinct host name; the gaicb must not move while a lookup runs */
+typedef struct s_host {
+    struct gaicb req;
+    uint64_t     expires_ns;  /* when to look the name up again, 0 for never */
+    uint32_t     first;       /* first target with this name, see g_res.same */
+    uint32_t     count;       /* targets with this name */
+    uint8_t      state;       /* t_host_state */
+    uint8_t      known;       /* an address has been found */
+} t_host;
+
+typedef struct s_resolver {
+    t_host   *hosts;
+    size_t    nhosts;
+    uint32_t *same;         /* per target: the next target with the same name */
+    uint32_t *queue;        /* hosts waiting for a lookup slot, in order */
+    size_t    qhead;
+    size_t    qlen;
+    uint32_t *busy;         /* hosts being looked up */
+    int       nbusy;
+    int       limit;
+    size_t    pending;      /* targets with neither an address nor a failure */
+    uint64_t  next_expiry;  /* earliest expires_ns, 0 if none */
+    int       epfd;
+    int       event_fd;
+    int       timer_fd;
+} t_resolver;
+
+static t_resolver g_res = {.epfd = -1, .event_fd = -1, .timer_fd = -1};
+
+static const struct addrinfo g_hints = {
+    .ai_family = AF_INET, .ai_socktype = SOCK_RAW, .ai_protocol = IPPROTO_ICMP
+};
+
+static void *alloc_or_fatal(size_t n, size_t size) {
+    void *p = calloc(n ? n : 1, size);
+    if (!p)
+        ping_fatal(MSG_ERR_OUT_OF_MEMORY);
+    return p;
+}
+
+static uint32_t name_hash(const char *s) {
+    uint32_t h = 2166136261u;   /* FNV-1a */
+
+    while (*s)
+        h = (h ^ (uint8_t) *s++) * 16777619u;
+    return h;
+}
+
+static void queue_push(uint32_t k) {
+    g_res.queue[(g_res.qhead + g_res.qlen++) % g_res.nhosts] = k;
+    g_res.hosts[k].state = HOST_QUEUED;
+}
+
+/* Groups the targets by name; numeric addresses need no lookup */
+static void hosts_build(void) {
+    size_t cap = 16;
+    while (cap < g_ntargets * 2)
+        cap *= 2;
+    uint32_t *slots = alloc_or_fatal(cap, sizeof(*slots));   /* host index + 1 */
+
+    g_res.hosts = alloc_or_fatal(g_ntargets, sizeof(*g_res.hosts));
+    g_res.same = alloc_or_fatal(g_ntargets, sizeof(*g_res.same));
+    for (size_t i = 0; i < g_ntargets; i++) {
+        t_target *t = &g_targets[i];
+        struct in_addr numeric;
+
+        t->addr.sin_family = AF_INET;
+        if (inet_aton(t->name, &numeric)) {
+            t->addr.sin_addr = numeric;
+            continue;
+        }
+
+        size_t k = name_hash(t->name) & (cap - 1);
+        while (slots[k] && ft_strcmp(g_res.hosts[slots[k] - 1].req.ar_name, t->name) != 0)
+            k = (k + 1) & (cap - 1);
+        if (!slots[k]) {
+            t_host *h = &g_res.hosts[g_res.nhosts];
+            h->req.ar_name = t->name;
+            h->req.ar_request = &g_hints;
+            h->first = NO_TARGET;
+            slots[k] = (uint32_t) ++g_res.nhosts;
+        }
+
+        t_host *h = &g_res.hosts[slots[k] - 1];
+        g_res.same[i] = h->first;
+        h->first = (uint32_t) i;
+        h->count++;
+        atomic_store_explicit(&t->state, TARGET_PENDING, memory_order_relaxed);
+        g_res.pending++;
+    }
+    free(slots);
+}
+
+/* Runs on a glibc thread when a lookup completes */
+static void lookup_notify(union sigval v) {
+    const uint64_t one = 1;
+    const ssize_t r = write(v.sival_int, &one, sizeof(one));
+    (void) r;
+}
+
+/* Starts queued lookups until --resolve-limit are in flight */
+static void lookups_submit(void) {
+    struct sigevent sev = {
+        .sigev_notify = SIGEV_THREAD,
+        .sigev_notify_function = lookup_notify,
+        .sigev_value.sival_int = g_res.event_fd
+    };
+
+    while (g_res.qlen > 0 && g_res.nbusy < g_res.limit) {
+        const uint32_t k = g_res.queue[g_res.qhead];
+        t_host *h = &g_res.hosts[k];
+        struct gaicb *list[1] = {&h->req};
+
+        h->req.ar_result = NULL;
+        const int err = getaddrinfo_a(GAI_NOWAIT, list, 1, &sev);
+        /* Out of threads for now: the next completion retries */
+        if (err == EAI_AGAIN && g_res.nbusy > 0)
+            break;
+        if (err != 0)
+            ping_fatal(MSG_ERR_RESOLVER, gai_strerror(err));
+
+        g_res.qhead = (g_res.qhead + 1) % g_res.nhosts;
+        g_res.qlen--;
+        h->state = HOST_BUSY;
+        g_res.busy[g_res.nbusy++] = k;
+    }
+}
+
+static void timer_arm(uint64_t at_ns) {
+    struct itimerspec its = {.it_value = ns_to_timespec(at_ns)};
+
+    if (timerfd_settime(g_res.timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0)
+        ping_fatal(MSG_ERR_TIMERFD, strerror(errno));
+}
+
+/* Points every target of `h` at `addr`; the first answer makes them ready */
+static void host_resolved(t_host *h, struct in_addr addr) {
+    int changed = 0;
+
+    for (uint32_t i = h->first; i != NO_TARGET; i = g_res.same[i]) {
+        t_target *t = &g_targets[i];
+
+        if (t->addr.sin_addr.s_addr != addr.s_addr) {
+            __atomic_store_n(&t->addr.sin_addr.s_addr, addr.s_addr, __ATOMIC_RELAXED);
+            changed = 1;
+        }
+        if (atomic_load_explicit(&t->state, memory_order_relaxed) == TARGET_PENDING) {
+            atomic_store_explicit(&t->state, TARGET_READY, memory_order_release);
+            g_res.pending--;
+        }
+    }
+    if (h->known && changed && flags.verbose) {
+        char ip_s[INET_ADDRSTRLEN];
+        fmt_ipv4(ip_s, addr);
+        ping_msg(MSG_RESOLVE_CHANGED, h->req.ar_name, ip_s);
+    }
+    h->known = 1;
+}
+
+static void host_failed(t_host *h) {
+    ping_msg(MSG_ERR_UNKNOWN_HOST, h->req.ar_name);
+    for (uint32_t i = h->first; i != NO_TARGET; i = g_res.same[i])
+        atomic_store_explicit(&g_targets[i].state, TARGET_FAILED, memory_order_relaxed);
+    g_targets_failed += h->count;
+    g_res.pending -= h->count;
+}
+
+/*
+** A failed first lookup drops the name's targets. A failed re-resolution
+** keeps the address it had and tries again one TTL later.
+*/
+static void lookup_done(t_host *h, int err, uint64_t now) {
+    struct addrinfo *res = h->req.ar_result;
+    const struct addrinfo *ai = res;
+
+    while (ai && ai->ai_family != AF_INET)
+        ai = ai->ai_next;
+    if (err == 0 && ai)
+        host_resolved(h, ((const struct sockaddr_in *) ai->ai_addr)->sin_addr);
+    else if (!h->known)
+        host_failed(h);
+    if (res)
+        freeaddrinfo(res);
+    h->req.ar_result = NULL;
+    h->state = HOST_IDLE;
+
+    h->expires_ns = 0;
+    if (h->known && flags.resolve_ttl_ns > 0) {
+        h->expires_ns = now + (uint64_t) flags.resolve_ttl_ns;
+        if (!g_res.next_expiry || h->expires_ns < g_res.next_expiry) {
+            g_res.next_expiry = h->expires_ns;
+            timer_arm(g_res.next_expiry);
+        }
+    }
+}
+
+/*
+** Queues the names whose answer has expired, along with those expiring in
+** the next sixteenth of a TTL, so one scan of the hosts serves a batch.
+*/
+static void hosts_expire(uint64_t now) {
+    const uint64_t horizon = now + (uint64_t) flags.resolve_ttl_ns / 16;
+
+    g_res.next_expiry = 0;
+    for (size_t k = 0; k < g_res.nhosts; k++) {
+        t_host *h = &g_res.hosts[k];
+
+        if (h->state != HOST_IDLE || !h->expires_ns)
+            continue;
+        if (h->expires_ns <= horizon) {
+            h->expires_ns = 0;
+            queue_push((uint32_t) k);
+        } else if (!g_res.next_expiry || h->expires_ns < g_res.next_expiry) {
+            g_res.next_expiry = h->expires_ns;
+        }
+    }
+    if (g_res.next_expiry)
+        timer_arm(g_res.next_expiry);
+}
+
+/* Starts looking up every host name; returns at once */
+void resolver_start(void) {
+    hosts_build();
+    if (g_res.nhosts == 0)
+        return;
+
+    g_res.limit = flags.resolve_limit > 0 ? flags.resolve_limit : RESOLVE_LIMIT_DEFAULT;
+    g_res.queue = alloc_or_fatal(g_res.nhosts, sizeof(*g_res.queue));
+    g_res.busy = alloc_or_fatal((size_t) g_res.limit, sizeof(*g_res.busy));
+    for (size_t k = 0; k < g_res.nhosts; k++)
+        queue_push((uint32_t) k);
+
+    const struct timespec none = {0, 0};
+    g_res.event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_res.event_fd < 0)
+        ping_fatal(MSG_ERR_EVENTFD, strerror(errno));
+    g_res.timer_fd = timer_open(1, &none, &none);
+    g_res.epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (g_res.epfd < 0)
+        ping_fatal(MSG_ERR_EPOLL, strerror(errno));
+    epoll_watch(g_res.epfd, g_res.event_fd);
+    epoll_watch(g_res.epfd, g_res.timer_fd);
+
+    lookups_submit();
+}
+
+/* Readable when answers are in or a name is due again; -1 if there are no names */
+int resolver_fd(void) {
+    return g_res.epfd;
+}
+
+/* Collects the finished lookups, queues the expired names, starts the next ones */
+void resolver_poll(void) {
+    if (g_res.epfd < 0)
+        return;
+
+    uint64_t v;
+    if (read(g_res.event_fd, &v, sizeof(v)) < 0 && errno != EAGAIN)
+        ping_fatal(MSG_ERR_EVENTFD, strerror(errno));
+    g_io_syscalls++;
+    timer_drain(g_res.timer_fd);
+
+    const uint64_t now = now_ns();
+    for (int k = 0; k < g_res.nbusy;) {
+        t_host *h = &g_res.hosts[g_res.busy[k]];
+        const int err = gai_error(&h->req);
+
+        if (err == EAI_INPROGRESS) {
+            k++;
+            continue;
+        }
+        g_res.busy[k] = g_res.busy[--g_res.nbusy];
+        lookup_done(h, err, now);
+    }
+    if (g_res.next_expiry && now >= g_res.next_expiry)
+        hosts_expire(now);
+    lookups_submit();
+
+    if (g_res.pending == 0 && g_targets_failed == g_ntargets)
+        ping_fatal(MSG_ERR_NO_TARGETS);
+}
@@ -0,0 +1,68 @@
+#include "ft_ping.h"
+
+/*
+** Adaptive probe timeouts (--rto)
+** -------------------------------
+** The retransmission timer of RFC 6298, per target, applied to echo
+** replies. Each RTT sample updates
+**
+**   RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|      (the first sets SRTT = R,
+**   SRTT   = 7/8 SRTT + 1/8 R                  RTTVAR = R/2)
+**
+** and the probes sent next are given up on RTO = SRTT + max(G, 4 RTTVAR)
+** after they went out, no sooner than RTO_MIN_NS and no later than the -W
+** wait, which is also all a target gets before its first reply. Late
+** replies are samples too, so a target whose RTT jumps catches up after a
+** few of them instead of losing every probe. A timeout doubles the RTO the
+** lost probe had (Karn's backoff; several probes lost together double it
+** once) until the next sample brings it back down.
+*/
+
+static int64_t wait_ns(void) {
+    return (int64_t) flags.wait_ms * 1000000LL;
+}
+
+static int64_t clamp_rto(int64_t rto) {
+    if (rto < RTO_MIN_NS)
+        rto = RTO_MIN_NS;
+    return rto < wait_ns() ? rto : wait_ns();
+}
+
+void rto_sample(t_rto *r, int64_t rtt) {
+    int64_t srtt = atomic_load_explicit(&r->srtt, memory_order_relaxed);
+    int64_t rttvar = atomic_load_explicit(&r->rttvar, memory_order_relaxed);
+
+    if (rtt < 0)
+        return;
+    if (srtt == 0) {
+        srtt = rtt;
+        rttvar = rtt / 2;
+    } else {
+        const int64_t err = rtt > srtt ? rtt - srtt : srtt - rtt;
+        rttvar += (err - rttvar) / 4;
+        srtt += (rtt - srtt) / 8;
+    }
+    if (srtt == 0)
+        srtt = 1;
+
+    const int64_t var4 = 4 * rttvar;
+    atomic_store_explicit(&r->srtt, srtt, memory_order_relaxed);
+    atomic_store_explicit(&r->rttvar, rttvar, memory_order_relaxed);
+    atomic_store_explicit(&r->rto, clamp_rto(srtt + (var4 > RTO_GRANULARITY_NS ? var4 : RTO_GRANULARITY_NS)),
+                          memory_order_relaxed);
+}
+
+/* A probe given `used` ns timed out */
+void rto_backoff(t_rto *r, int64_t used) {
+    const int64_t rto = clamp_rto(2 * used);
+
+    if (rto > atomic_load_explicit(&r->rto, memory_order_relaxed))
+        atomic_store_explicit(&r->rto, rto, memory_order_relaxed);
+}
+
+/* How long the next probe to the target may stay unanswered */
+int64_t rto_get(const t_rto *r) {
+    const int64_t rto = atomic_load_explicit(&r->rto, memory_order_relaxed);
+
+    return flags.rto && rto > 0 ? rto : wait_ns();
+}
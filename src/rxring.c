@@ -0,0 +1,157 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "ft_instr.h"
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <net/ethernet.h>
+#include <linux/if_packet.h>
+
+/*
+** Packet ring receive path (--rx-ring)
+** ------------------------------------
+** Replies are read from a TPACKET_V3 ring shared with the kernel instead of
+** being copied out of the ICMP socket one recvmmsg() entry at a time. The
+** AF_PACKET socket (SOCK_DGRAM, so frames start at the IP header) gets the
+** same socket filter as the raw socket plus an IP protocol check, and the
+** ICMP socket gets one that drops everything: it is only used for sending
+** and for its error queue.
+**
+** The kernel fills fixed-size blocks and hands a block over when it is full
+** or RING_BLOCK_TOV_MS after its first packet, so one wakeup covers every
+** reply in the block. pkt_parse_ip() runs on the frames where they are,
+** then the block goes back to the kernel. Because a reply can wait in a
+** block for a while, its RTT is taken from the frame's kernel timestamp
+** (CLOCK_REALTIME, moved to CLOCK_MONOTONIC), not from when we read it.
+**
+** PACKET_STATISTICS (tpacket_stats_v3) counts what the ring dropped when
+** userspace fell behind; it is read on close and printed in the summary.
+*/
+
+#define RING_BLOCK_SIZE   (1U << 18)
+#define RING_BLOCK_NR     16
+#define RING_FRAME_SIZE   2048
+#define RING_BLOCK_TOV_MS 4
+
+typedef struct s_rxring {
+    int      fd;
+    uint8_t *map;
+    size_t   map_len;
+    unsigned block;    /* next block to read */
+} t_rxring;
+
+static t_rxring g_ring = {.fd = -1};
+
+/*
+** Opens the ring for replies to `id` and mutes `sock`. Returns the packet
+** socket, readable (EPOLLIN) when a block is ready. Errors are fatal.
+*/
+int rxring_open(int sock, int id) {
+    /* The ring carries whole IP packets, which only the raw parser reads */
+    if (g_transport->parse != pkt_parse_raw)
+        ping_fatal(MSG_ERR_RXRING_RAW);
+
+    /* Protocol 0 receives nothing until bind(): set up the filter and the ring first */
+    g_ring.fd = socket(AF_PACKET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (g_ring.fd < 0)
+        ping_fatal(MSG_ERR_PACKET_SOCKET, strerror(errno));
+    if (filter_attach(g_ring.fd, id, 1) < 0)
+        ping_fatal(MSG_ERR_PACKET_SOCKET, strerror(errno));
+
+    const int version = TPACKET_V3;
+    const int on = 1;
+    struct tpacket_req3 req = {
+        .tp_block_size = RING_BLOCK_SIZE,
+        .tp_block_nr = RING_BLOCK_NR,
+        .tp_frame_size = RING_FRAME_SIZE,
+        .tp_frame_nr = RING_BLOCK_SIZE / RING_FRAME_SIZE * RING_BLOCK_NR,
+        .tp_retire_blk_tov = RING_BLOCK_TOV_MS
+    };
+    if (setsockopt(g_ring.fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0
+        || setsockopt(g_ring.fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0)
+        ping_fatal(MSG_ERR_PACKET_SOCKET, strerror(errno));
+    /* Our own requests would show up too (and every loopback packet twice) */
+    setsockopt(g_ring.fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &on, sizeof(on));
+
+    g_ring.map_len = (size_t) RING_BLOCK_SIZE * RING_BLOCK_NR;
+    g_ring.map = mmap(NULL, g_ring.map_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_LOCKED | MAP_POPULATE, g_ring.fd, 0);
+    if (g_ring.map == MAP_FAILED)
+        g_ring.map = mmap(NULL, g_ring.map_len, PROT_READ | PROT_WRITE, MAP_SHARED, g_ring.fd, 0);
+    if (g_ring.map == MAP_FAILED)
+        ping_fatal(MSG_ERR_PACKET_SOCKET, strerror(errno));
+    g_ring.block = 0;
+
+    const struct sockaddr_ll sll = {
+        .sll_family = AF_PACKET,
+        .sll_protocol = htons(ETH_P_IP),
+        .sll_ifindex = 0
+    };
+    if (bind(g_ring.fd, (const struct sockaddr *) &sll, sizeof(sll)) < 0)
+        ping_fatal(MSG_ERR_PACKET_SOCKET, strerror(errno));
+
+    filter_drop_all(sock);
+    return g_ring.fd;
+}
+
+/* Parses every block the kernel has handed over, then gives them back */
+void rxring_drain(int id) {
+    struct timespec mono;
+    struct timespec real;
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    clock_gettime(CLOCK_REALTIME, &real);
+    const uint64_t mono_ns = (uint64_t) mono.tv_sec * NS_PER_SEC + (uint64_t) mono.tv_nsec;
+    const int64_t offset = (int64_t) mono_ns - ((int64_t) real.tv_sec * NS_PER_SEC + real.tv_nsec);
+
+    while (!should_stop) {
+        struct tpacket_block_desc *bd =
+            (struct tpacket_block_desc *) (g_ring.map + (size_t) g_ring.block * RING_BLOCK_SIZE);
+
+        if (!(__atomic_load_n(&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+            return;
+
+        const uint32_t n = bd->hdr.bh1.num_pkts;
+        const struct tpacket3_hdr *h =
+            (const struct tpacket3_hdr *) ((const uint8_t *) bd + bd->hdr.bh1.offset_to_first_pkt);
+
+        INSTR_START(t_parse);
+        for (uint32_t i = 0; i < n; i++) {
+            const int64_t krx_ns = (int64_t) h->tp_sec * NS_PER_SEC + h->tp_nsec;
+            uint64_t rx_ns = (uint64_t) (krx_ns + offset);
+
+            if (rx_ns > mono_ns)
+                rx_ns = mono_ns;
+            pkt_parse_ip((const char *) h + h->tp_net, h->tp_snaplen, id,
+                         flags.kernel_ts ? krx_ns : 0, rx_ns);
+            h = (const struct tpacket3_hdr *) ((const uint8_t *) h + h->tp_next_offset);
+        }
+        INSTR_STOP(STAGE_PARSE, t_parse, n);
+        g_rx_reads += n;
+
+        __atomic_store_n(&bd->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        g_ring.block = (g_ring.block + 1) % RING_BLOCK_NR;
+    }
+}
+
+/* Reads the ring counters into g_rxring_stats and closes the ring */
+void rxring_close(void) {
+    struct tpacket_stats_v3 st = {0};
+    socklen_t len = sizeof(st);
+
+    if (g_ring.fd < 0)
+        return;
+    if (getsockopt(g_ring.fd, SOL_PACKET, PACKET_STATISTICS, &st, &len) == 0) {
+        g_rxring_stats.packets += st.tp_packets;
+        g_rxring_stats.drops += st.tp_drops;
+        g_rxring_stats.freezes += st.tp_freeze_q_cnt;
+    }
+    g_rxring_stats.used = 1;
+    munmap(g_ring.map, g_ring.map_len);
+    close(g_ring.fd);
+    g_ring.fd = -1;
+}
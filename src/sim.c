@@ -0,0 +1,498 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "libft/libft.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <sys/timerfd.h>
+
+/*
+** Network simulator (--transport sim, --sim SPEC)
+** -----------------------------------------------
+** A transport whose "network" is a queue in this process: every probe sent
+** is answered by an echo reply built here, after a delay drawn from the
+** configured distribution, unless the dice say it is lost, duplicated,
+** held back past the next reply, or answered by a router with an ICMP Time
+** Exceeded or Destination Unreachable instead. A reply echoes as many
+** bytes as its probe carried. Probes larger than the path MTU are treated
+** as sent with DF: a router answers with Fragmentation Needed, or drops
+** them (blackhole=1), and the interface refuses sends over its own MTU
+** with EMSGSIZE, so --pmtu runs as against a real path. With hops=N the
+** target is N routers away: a probe whose TTL (its IP_TTL control message,
+** else --ttl) runs out before gets Time Exceeded from router 192.0.2.TTL,
+** sooner the closer that is, as --sweep sees on a real path. The replies
+** are complete IP datagrams with valid checksums, parsed by pkt_parse_raw()
+** like those of a raw socket, so everything above the socket runs as it
+** does for real.
+**
+** The "socket" is a timerfd armed for the earliest reply due, so the event
+** loops wait on it like on a socket. Each one (one per worker) draws from
+** its own generator seeded from seed= and its index, which makes a run's
+** losses, duplicates and errors the same every time.
+**
+** SPEC is a comma-separated list of key=value:
+**   delay=MS     round-trip time before the jitter (0)
+**   jitter=MS    spread added to the delay (0), shaped by
+**   dist=NAME    uniform (0 to jitter), exp (mean jitter) or normal
+**                (absolute value, standard deviation jitter)
+**   loss=PCT dup=PCT reorder=PCT ttl=PCT unreach=PCT   per-probe odds
+**   seed=N       generator seed (1)
+**   mtu=N        path MTU, bytes of IP datagram (none)
+**   ifmtu=N      interface MTU (none)
+**   blackhole=1  no Fragmentation Needed from the routers
+**   hops=N       routers on the way to the target (none)
+** A reordered reply is held back one interval (1 ms when flooding) more.
+*/
+
+#define SIM_ROUTER   0xC0000201   /* 192.0.2.1 (TEST-NET-1) sends the errors */
+#define SIM_TTL      64
+
+t_sim_conf g_sim = {.seed = 1};
+
+typedef enum { SIM_REPLY, SIM_TIME_EXCEEDED, SIM_UNREACH, SIM_FRAG_NEEDED } t_sim_kind;
+
+typedef struct s_sim_pkt {
+    uint64_t due_ns;
+    uint32_t order;    /* send order, breaks ties between equal due times */
+    uint32_t dst;      /* probed address, network order */
+    uint16_t id;       /* from the request, network order */
+    uint16_t seq;
+    uint16_t len;      /* payload bytes of the probe */
+    uint8_t  kind;     /* t_sim_kind */
+    uint8_t  hop;      /* router a Time Exceeded comes from (hops=), 0 for SIM_ROUTER */
+} t_sim_pkt;
+
+/* One simulated socket: its replies in a min-heap on (due_ns, order) */
+typedef struct s_sim {
+    int        fd;
+    t_sim_pkt *heap;
+    size_t     len;
+    size_t     cap;
+    uint64_t   armed_ns;   /* when the timerfd fires, 0 if disarmed */
+    uint64_t   rng;
+    uint32_t   order;
+    char      *payload;    /* what the longest probe carried after the ICMP header */
+    size_t     payload_len;
+} t_sim;
+
+static t_sim g_sims[WORKERS_MAX + 1];
+static int g_nsims = 0;
+
+/* Sockets are opened before the workers start; afterwards this only reads */
+static t_sim *sim_of(int fd) {
+    for (int i = 0; i < g_nsims; i++)
+        if (g_sims[i].fd == fd)
+            return &g_sims[i];
+    return NULL;
+}
+
+/* splitmix64 */
+static uint64_t rng_next(t_sim *s) {
+    uint64_t z = (s->rng += 0x9E3779B97F4A7C15ULL);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Uniform in [0, 1) */
+static double rng_unit(t_sim *s) {
+    return (double) (rng_next(s) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int rng_chance(t_sim *s, double p) {
+    return p > 0 && rng_unit(s) < p;
+}
+
+static uint64_t sample_delay(t_sim *s) {
+    const double j = (double) g_sim.jitter_ns;
+    double extra = 0;
+
+    if (j > 0) {
+        if (g_sim.dist == SIM_DIST_EXP) {
+            extra = -log(1.0 - rng_unit(s)) * j;
+        } else if (g_sim.dist == SIM_DIST_NORMAL) {
+            const double u = 1.0 - rng_unit(s);
+            extra = fabs(sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * rng_unit(s))) * j;
+        } else {
+            extra = rng_unit(s) * j;
+        }
+    }
+    return (uint64_t) g_sim.delay_ns + (uint64_t) extra;
+}
+
+/* --- reply queue --- */
+
+static int pkt_before(const t_sim_pkt *a, const t_sim_pkt *b) {
+    return a->due_ns < b->due_ns || (a->due_ns == b->due_ns && (int32_t) (a->order - b->order) < 0);
+}
+
+static void heap_push(t_sim *s, t_sim_pkt pkt) {
+    if (s->len == s->cap) {
+        const size_t cap = s->cap ? s->cap * 2 : 256;
+        t_sim_pkt *grown = realloc(s->heap, cap * sizeof(*grown));
+        if (!grown)
+            ping_fatal(MSG_ERR_OUT_OF_MEMORY);
+        s->heap = grown;
+        s->cap = cap;
+    }
+
+    pkt.order = s->order++;
+    size_t i = s->len++;
+    while (i > 0 && pkt_before(&pkt, &s->heap[(i - 1) / 2])) {
+        s->heap[i] = s->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    s->heap[i] = pkt;
+}
+
+static t_sim_pkt heap_pop(t_sim *s) {
+    const t_sim_pkt top = s->heap[0];
+    const t_sim_pkt last = s->heap[--s->len];
+    size_t i = 0;
+
+    for (;;) {
+        size_t c = 2 * i + 1;
+        if (c >= s->len)
+            break;
+        if (c + 1 < s->len && pkt_before(&s->heap[c + 1], &s->heap[c]))
+            c++;
+        if (!pkt_before(&s->heap[c], &last))
+            break;
+        s->heap[i] = s->heap[c];
+        i = c;
+    }
+    if (s->len > 0)
+        s->heap[i] = last;
+    return top;
+}
+
+/* Keeps the timerfd armed for the earliest reply */
+static void timer_update(t_sim *s) {
+    const uint64_t due = s->len ? s->heap[0].due_ns : 0;
+
+    if (due == s->armed_ns)
+        return;
+
+    /* A zero it_value disarms; a due time already past fires at once */
+    struct itimerspec its = {0};
+    if (due)
+        its.it_value = ns_to_timespec(due);
+    if (timerfd_settime(s->fd, TFD_TIMER_ABSTIME, &its, NULL) < 0)
+        ping_fatal(MSG_ERR_TIMERFD, strerror(errno));
+    s->armed_ns = due;
+}
+
+/* --- packets --- */
+
+static void ip_header(struct ip *ip, size_t len, uint32_t src, uint32_t dst, uint8_t ttl) {
+    ft_memset(ip, 0, sizeof(*ip));
+    ip->ip_v = 4;
+    ip->ip_hl = sizeof(*ip) / 4;
+    ip->ip_len = htons((uint16_t) len);
+    ip->ip_ttl = ttl;
+    ip->ip_p = IPPROTO_ICMP;
+    ip->ip_src.s_addr = src;
+    ip->ip_dst.s_addr = dst;
+    ip->ip_sum = checksum(ip, sizeof(*ip));
+}
+
+/* Writes the datagram for `pkt` into buf; returns its length, 0 if it does not fit */
+static size_t pkt_build(const t_sim *s, const t_sim_pkt *pkt, char *buf, size_t cap) {
+    struct ip *ip = (struct ip *) buf;
+    struct my_icmp_header *icmp = (struct my_icmp_header *) (buf + sizeof(*ip));
+    size_t icmp_len;
+
+    if (pkt->kind == SIM_REPLY) {
+        icmp_len = PKT_HDR_LEN + pkt->len;
+        if (sizeof(*ip) + icmp_len > cap)
+            return 0;
+        *icmp = (struct my_icmp_header){.type = ICMP_ECHOREPLY, .id = pkt->id, .sequence = pkt->seq};
+        ft_memcpy(icmp + 1, s->payload, pkt->len);
+    } else {
+        /* The error quotes the probe's IP header and first 8 bytes */
+        icmp_len = 8 + sizeof(struct ip) + PKT_HDR_LEN;
+        if (sizeof(*ip) + icmp_len > cap)
+            return 0;
+        ft_memset(icmp, 0, 8);
+        icmp->type = pkt->kind == SIM_TIME_EXCEEDED ? ICMP_TIME_EXCEEDED : ICMP_DEST_UNREACH;
+        icmp->code = pkt->kind == SIM_TIME_EXCEEDED ? 0 : pkt->kind == SIM_UNREACH ? 1 : ICMP_FRAG_NEEDED;
+        /* Fragmentation Needed: the next-hop MTU in the low half of the unused word (RFC 1191) */
+        if (pkt->kind == SIM_FRAG_NEEDED)
+            icmp->sequence = htons((uint16_t) g_sim.mtu);
+
+        struct ip *orig = (struct ip *) ((char *) icmp + 8);
+        ip_header(orig, sizeof(*orig) + PKT_HDR_LEN + pkt->len, htonl(INADDR_LOOPBACK), pkt->dst, 1);
+        *(struct my_icmp_header *) (orig + 1) = (struct my_icmp_header){
+            .type = ICMP_ECHO, .id = pkt->id, .sequence = pkt->seq
+        };
+    }
+    icmp->checksum = checksum(icmp, (int) icmp_len);
+
+    const uint32_t src = pkt->kind == SIM_REPLY ? pkt->dst
+                         : htonl(SIM_ROUTER + (pkt->hop ? pkt->hop - 1U : 0U));
+    ip_header(ip, sizeof(*ip) + icmp_len, src, htonl(INADDR_LOOPBACK),
+              pkt->kind == SIM_REPLY ? SIM_TTL : SIM_TTL - 1);
+    return sizeof(*ip) + icmp_len;
+}
+
+/* --- transport --- */
+
+static int sim_open(void) {
+    if (g_nsims == WORKERS_MAX + 1) {
+        errno = EMFILE;
+        return -1;
+    }
+
+    const int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    g_sims[g_nsims++] = (t_sim){.fd = fd};
+    return fd;
+}
+
+static int sim_setup(int sock, int index) {
+    t_sim *s = sim_of(sock);
+
+    s->rng = g_sim.seed + (uint64_t) index * 0x9E3779B97F4A7C15ULL;
+    return (getpid() + index) & 0xFFFF;
+}
+
+/* Probes share one pattern, so the longest one holds what any of them carried */
+static void keep_payload(t_sim *s, const struct msghdr *msg) {
+    const size_t len = msg->msg_iovlen > 1 ? msg->msg_iov[1].iov_len : 0;
+
+    if (s->payload && len <= s->payload_len)
+        return;
+    free(s->payload);
+    s->payload = malloc(len ? len : 1);
+    if (!s->payload)
+        ping_fatal(MSG_ERR_OUT_OF_MEMORY);
+    if (len)
+        ft_memcpy(s->payload, msg->msg_iov[1].iov_base, len);
+    s->payload_len = len;
+}
+
+/* The TTL a probe goes out with: its IP_TTL control message, else the socket's */
+static int probe_ttl(const struct msghdr *msg) {
+    int ttl = flags.ttl;
+
+    for (struct cmsghdr *c = CMSG_FIRSTHDR((struct msghdr *) msg); c; c = CMSG_NXTHDR((struct msghdr *) msg, c))
+        if (c->cmsg_level == IPPROTO_IP && c->cmsg_type == IP_TTL)
+            ft_memcpy(&ttl, CMSG_DATA(c), sizeof(ttl));
+    return ttl;
+}
+
+/* Every probe "goes out"; what comes back is decided here */
+static int sim_send(int sock, struct mmsghdr *msgs, unsigned int n) {
+    t_sim *s = sim_of(sock);
+    const uint64_t now = now_ns();
+
+    if (!s) {
+        errno = EBADF;
+        return -1;
+    }
+    for (unsigned int i = 0; i < n; i++) {
+        const struct msghdr *msg = &msgs[i].msg_hdr;
+        const struct my_icmp_header *req = msg->msg_iov[0].iov_base;
+        const struct sockaddr_in *to = msg->msg_name;
+        const size_t len = msg->msg_iovlen > 1 ? msg->msg_iov[1].iov_len : 0;
+        const size_t size = sizeof(struct ip) + msg->msg_iov[0].iov_len + len;
+        t_sim_pkt pkt = {.dst = to->sin_addr.s_addr, .id = req->id, .seq = req->sequence,
+                         .len = (uint16_t) len};
+
+        /* sendmmsg() stops at the first message that fails */
+        if (g_sim.ifmtu > 0 && size > (size_t) g_sim.ifmtu) {
+            timer_update(s);
+            if (i == 0) {
+                errno = EMSGSIZE;
+                return -1;
+            }
+            return (int) i;
+        }
+        keep_payload(s, msg);
+        msgs[i].msg_len = (unsigned int) (size - sizeof(struct ip));
+        if (rng_chance(s, g_sim.loss))
+            continue;
+
+        const int ttl = probe_ttl(msg);
+        if (g_sim.hops > 0 && ttl < g_sim.hops) {
+            /* Each router is as far along the delay as along the path */
+            pkt.kind = SIM_TIME_EXCEEDED;
+            pkt.hop = (uint8_t) ttl;
+            pkt.due_ns = now + sample_delay(s) * (uint64_t) ttl / (uint64_t) g_sim.hops;
+            heap_push(s, pkt);
+            continue;
+        }
+        if (g_sim.mtu > 0 && size > (size_t) g_sim.mtu) {
+            if (g_sim.blackhole)
+                continue;
+            /* The router sits halfway */
+            pkt.kind = SIM_FRAG_NEEDED;
+            pkt.due_ns = now + sample_delay(s) / 2;
+            heap_push(s, pkt);
+            continue;
+        }
+        if (rng_chance(s, g_sim.ttl_exceeded)) {
+            pkt.kind = SIM_TIME_EXCEEDED;
+        } else if (rng_chance(s, g_sim.unreach)) {
+            pkt.kind = SIM_UNREACH;
+        }
+        pkt.due_ns = now + sample_delay(s);
+        if (pkt.kind == SIM_REPLY && rng_chance(s, g_sim.reorder))
+            pkt.due_ns += flags.interval_ns > 0 ? (uint64_t) flags.interval_ns : 1000000;
+        heap_push(s, pkt);
+
+        if (pkt.kind == SIM_REPLY && rng_chance(s, g_sim.dup)) {
+            pkt.due_ns += sample_delay(s) / 2 + 1;
+            heap_push(s, pkt);
+        }
+    }
+    timer_update(s);
+    return (int) n;
+}
+
+/* Hands out the replies that are due, like recvmmsg() on a raw socket */
+static int sim_recv(int sock, struct mmsghdr *msgs, unsigned int n) {
+    t_sim *s = sim_of(sock);
+    uint64_t expirations;
+    unsigned int got = 0;
+
+    if (!s) {
+        errno = EBADF;
+        return -1;
+    }
+    if (read(s->fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+        return -1;
+
+    const uint64_t now = now_ns();
+    while (got < n && s->len > 0 && s->heap[0].due_ns <= now) {
+        struct msghdr *msg = &msgs[got].msg_hdr;
+        const t_sim_pkt pkt = heap_pop(s);
+        const size_t len = pkt_build(s, &pkt, msg->msg_iov[0].iov_base, msg->msg_iov[0].iov_len);
+
+        if (len == 0)
+            continue;
+        if (msg->msg_name && msg->msg_namelen >= sizeof(struct sockaddr_in)) {
+            struct sockaddr_in *from = msg->msg_name;
+            *from = (struct sockaddr_in){.sin_family = AF_INET};
+            from->sin_addr = ((const struct ip *) msg->msg_iov[0].iov_base)->ip_src;
+            msg->msg_namelen = sizeof(*from);
+        }
+        msg->msg_controllen = 0;
+        msgs[got++].msg_len = (unsigned int) len;
+    }
+    timer_update(s);
+
+    if (got == 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    return (int) got;
+}
+
+const t_transport g_transport_sim = {
+    "sim", sim_open, sim_setup, sim_send, sim_recv, pkt_parse_raw
+};
+
+/* --- --sim SPEC --- */
+
+static int parse_number(const char *s, double min, double max, double *out) {
+    char *end;
+
+    errno = 0;
+    const double d = strtod(s, &end);
+    if (errno || end == s || *end || isnan(d) || d < min || d > max)
+        return -1;
+    *out = d;
+    return 0;
+}
+
+static int sim_setting(const char *key, const char *val) {
+    static const struct {
+        const char *key;
+        double     *odds;
+    } odds[] = {
+        {"loss", &g_sim.loss}, {"dup", &g_sim.dup}, {"reorder", &g_sim.reorder},
+        {"ttl", &g_sim.ttl_exceeded}, {"unreach", &g_sim.unreach},
+    };
+    double d;
+
+    for (size_t i = 0; i < sizeof(odds) / sizeof(odds[0]); i++) {
+        if (ft_strcmp(key, odds[i].key) == 0) {
+            if (parse_number(val, 0, 100, &d) < 0)
+                return -1;
+            *odds[i].odds = d / 100.0;
+            return 0;
+        }
+    }
+    if (ft_strcmp(key, "delay") == 0 || ft_strcmp(key, "jitter") == 0) {
+        if (parse_number(val, 0, 3600e3, &d) < 0)
+            return -1;
+        *(key[0] == 'd' ? &g_sim.delay_ns : &g_sim.jitter_ns) = llround(d * NS_PER_MS);
+        return 0;
+    }
+    if (ft_strcmp(key, "dist") == 0) {
+        if (ft_strcmp(val, "uniform") == 0)
+            g_sim.dist = SIM_DIST_UNIFORM;
+        else if (ft_strcmp(val, "exp") == 0)
+            g_sim.dist = SIM_DIST_EXP;
+        else if (ft_strcmp(val, "normal") == 0)
+            g_sim.dist = SIM_DIST_NORMAL;
+        else
+            return -1;
+        return 0;
+    }
+    if (ft_strcmp(key, "mtu") == 0 || ft_strcmp(key, "ifmtu") == 0) {
+        if (parse_number(val, PMTU_MIN, PMTU_MAX, &d) < 0 || d != floor(d))
+            return -1;
+        *(key[0] == 'm' ? &g_sim.mtu : &g_sim.ifmtu) = (int) d;
+        return 0;
+    }
+    if (ft_strcmp(key, "hops") == 0) {
+        if (parse_number(val, 0, SWEEP_HOPS_MAX, &d) < 0 || d != floor(d))
+            return -1;
+        g_sim.hops = (int) d;
+        return 0;
+    }
+    if (ft_strcmp(key, "blackhole") == 0) {
+        if (parse_number(val, 0, 1, &d) < 0 || d != floor(d))
+            return -1;
+        g_sim.blackhole = (int) d;
+        return 0;
+    }
+    if (ft_strcmp(key, "seed") == 0) {
+        char *end;
+
+        errno = 0;
+        g_sim.seed = strtoull(val, &end, 10);
+        return errno || end == val || *end || *val == '-' ? -1 : 0;
+    }
+    return -1;
+}
+
+/* Applies a --sim SPEC on top of the current settings; -1 if it is invalid */
+int sim_configure(const char *spec) {
+    char *copy = ft_strdup(spec);
+    char *save = NULL;
+    int ret = 0;
+
+    if (!copy)
+        ping_fatal(MSG_ERR_OUT_OF_MEMORY);
+    for (char *tok = strtok_r(copy, ",", &save); tok && ret == 0; tok = strtok_r(NULL, ",", &save)) {
+        char *eq = ft_strchr(tok, '=');
+        if (!eq) {
+            ret = -1;
+            break;
+        }
+        *eq = '\0';
+        ret = sim_setting(tok, eq + 1);
+    }
+    free(copy);
+    return ret;
+}
@@ -0,0 +1,178 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "ft_statsfile.h"
+#include "libft/libft.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/*
+** Live statistics file (--stats-file)
+** -----------------------------------
+** Layout and reader protocol in ft_statsfile.h. Each thread that sends
+** probes owns one block and is its only writer: before the loop waits it
+** copies its g_stats, ICMP error counts and histogram into the block under
+** the block's seqlock, when they have changed and the last copy is
+** SF_PERIOD_NS old or the loop is about to sleep that long. A snapshot is
+** a few hundred bytes and the histogram, so readers polling at any rate
+** cost the loop nothing and the copies cost it at most ten a second.
+*/
+
+_Static_assert(SF_ICMP_TYPES == ICMP_TYPES, "ICMP error counters do not match the file");
+_Static_assert(sizeof(t_sf_header) == 64, "t_sf_header must stay 64 bytes");
+
+static t_sf_header *g_sf = NULL;
+static size_t g_sf_size = 0;
+
+static _Thread_local t_sf_block *g_block = NULL;
+static _Thread_local uint64_t g_block_ns = 0;       /* when the block was last written */
+static _Thread_local uint64_t g_block_events = 0;   /* event count it was written at */
+
+static size_t block_size(void) {
+    const size_t size = sizeof(t_sf_block) + HIST_BUCKETS * sizeof(uint64_t);
+    return (size + 63) & ~(size_t) 63;
+}
+
+static uint64_t realtime_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t) ts.tv_sec * NS_PER_SEC + (uint64_t) ts.tv_nsec;
+}
+
+/*
+** Creates the file with one block per sending thread. It is built under a
+** temporary name and renamed, so a reader never maps a half-written header.
+*/
+void statsfile_open(void) {
+    const char *path = flags.stats_file;
+    const uint32_t nblocks = flags.threads > 1 ? (uint32_t) flags.threads : 1;
+    char tmp[4096];
+
+    if (!path)
+        return;
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int) getpid());
+    g_sf_size = sizeof(t_sf_header) + nblocks * block_size();
+
+    const int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        ping_fatal(MSG_ERR_STATS_FILE, path, strerror(errno));
+    if (ftruncate(fd, (off_t) g_sf_size) < 0) {
+        unlink(tmp);
+        ping_fatal(MSG_ERR_STATS_FILE, path, strerror(errno));
+    }
+    g_sf = mmap(NULL, g_sf_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (g_sf == MAP_FAILED) {
+        g_sf = NULL;
+        unlink(tmp);
+        ping_fatal(MSG_ERR_STATS_FILE, path, strerror(errno));
+    }
+
+    ft_memcpy(g_sf->magic, SF_MAGIC, sizeof(g_sf->magic));
+    g_sf->version = SF_VERSION;
+    g_sf->header_size = sizeof(t_sf_header);
+    g_sf->block_size = (uint32_t) block_size();
+    g_sf->nblocks = nblocks;
+    g_sf->hist_buckets = HIST_BUCKETS;
+    g_sf->hist_sub_bits = HIST_SUB_BITS;
+    g_sf->pid = (uint32_t) getpid();
+    g_sf->ntargets = (uint32_t) g_ntargets;
+    g_sf->start_ns = realtime_ns();
+    for (uint32_t k = 0; k < nblocks; k++) {
+        t_sf_block *b = (t_sf_block *) ((char *) g_sf + sizeof(t_sf_header) + k * block_size());
+        b->min_ns = -1;
+        b->max_ns = -1;
+    }
+    __atomic_store_n(&g_sf->state, SF_RUNNING, __ATOMIC_RELEASE);
+
+    if (rename(tmp, path) < 0) {
+        unlink(tmp);
+        ping_fatal(MSG_ERR_STATS_FILE, path, strerror(errno));
+    }
+}
+
+/* The calling thread writes block `index` from now on */
+void statsfile_attach(int index) {
+    if (!g_sf || index < 0 || (uint32_t) index >= g_sf->nblocks)
+        return;
+    g_block = (t_sf_block *) ((char *) g_sf + sizeof(t_sf_header) + (size_t) index * block_size());
+    g_block_ns = 0;
+    g_block_events = UINT64_MAX;
+}
+
+/* Anything a snapshot shows changes this */
+static uint64_t event_count(void) {
+    uint64_t n = (uint64_t) (g_stats.tx + g_stats.rx + g_stats.dup + g_stats.late + g_stats.timeouts);
+
+    for (int t = 0; t < ICMP_TYPES; t++)
+        n += (uint64_t) g_icmp_errors[t];
+    return n;
+}
+
+static void publish(uint64_t now, uint64_t events) {
+    t_sf_block *b = g_block;
+    const uint64_t seq = b->seq;
+
+    __atomic_store_n(&b->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    b->update_ns = realtime_ns();
+    b->tx = (uint64_t) g_stats.tx;
+    b->rx = (uint64_t) g_stats.rx;
+    b->dup = (uint64_t) g_stats.dup;
+    b->reorder = (uint64_t) g_stats.reorder;
+    b->late = (uint64_t) g_stats.late;
+    b->timeouts = (uint64_t) g_stats.timeouts;
+    b->min_ns = g_stats.rx > 0 ? g_stats.min : -1;
+    b->max_ns = g_stats.rx > 0 ? g_stats.max : -1;
+    b->mean_ns = g_stats.rx > 0 ? g_stats.mean : 0.0;
+    b->mdev_ns = g_stats.rx > 0 ? ft_sqrt(g_stats.m2 / (double) g_stats.rx) : 0.0;
+    for (int t = 0; t < ICMP_TYPES; t++)
+        b->errors[t] = (uint64_t) g_icmp_errors[t];
+    if (g_stats.hist) {
+        b->hist_total = g_stats.hist->total;
+        ft_memcpy(b->hist, g_stats.hist->counts, sizeof(g_stats.hist->counts));
+    }
+
+    __atomic_store_n(&b->seq, seq + 2, __ATOMIC_RELEASE);
+    g_block_ns = now;
+    g_block_events = events;
+}
+
+/*
+** Called before the event loop waits up to `idle_ns`: writes the snapshot
+** if it changed and would otherwise be SF_PERIOD_NS or more out of date.
+*/
+void statsfile_poll(uint64_t idle_ns) {
+    if (!g_block)
+        return;
+
+    const uint64_t events = event_count();
+    if (events == g_block_events)
+        return;
+
+    const uint64_t now = now_ns();
+    if (idle_ns >= SF_PERIOD_NS || now - g_block_ns >= SF_PERIOD_NS)
+        publish(now, events);
+}
+
+/* Writes this thread's final counts */
+void statsfile_flush(void) {
+    if (g_block)
+        publish(now_ns(), event_count());
+}
+
+/* Marks the run finished; the file stays for the last readers */
+void statsfile_close(void) {
+    if (!g_sf)
+        return;
+    __atomic_store_n(&g_sf->state, SF_FINISHED, __ATOMIC_RELEASE);
+    munmap(g_sf, g_sf_size);
+    g_sf = NULL;
+}
@@ -0,0 +1,260 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "libft/libft.h"
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+/*
+** TTL sweep (--sweep N)
+** ---------------------
+** A traceroute in one burst: each round sends one probe per TTL from 1 to
+** N in a single sendmmsg(), each with its own wire sequence number and its
+** TTL in an IP_TTL control message, so the socket's own TTL never changes.
+** The router where a probe runs out of TTL answers with Time Exceeded
+** (handle_error_packet(), or the error queue of a datagram socket), the
+** target with an echo reply, and both come to sweep_answer(), which finds
+** the hop from the wire sequence. The whole path is mapped in about one
+** round trip instead of N runs of ping --ttl.
+**
+** Rounds repeat every -i (back to back with -i 0) for -c rounds, or until
+** a signal or -w, and each hop keeps statistics like mtr's: probes sent and
+** answered and the RTTs of the answers. Once the target has answered, the
+** later rounds stop at its hop. A probe counts as sent once it is settled,
+** answered or given up on after -W, so the stragglers of the last round do
+** not show up as loss.
+*/
+
+/* A control message carrying one probe's TTL */
+typedef union u_ttl_cmsg {
+    char           buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+} t_ttl_cmsg;
+
+static t_hop g_hops[SWEEP_HOPS_MAX + 1];          /* by TTL, 0 unused */
+static uint8_t g_ttl_of[PROBE_MAP_SIZE];          /* TTL each wire sequence went out with */
+static t_ttl_cmsg g_ttl_cmsgs[IO_BATCH];
+static int g_reached = 0;                         /* hop of the target, 0 until it answers */
+
+const t_hop *sweep_hop(int ttl) {
+    return &g_hops[ttl];
+}
+
+/*
+** A router or the target answered probe `p`. `last` says the path ends
+** there: an echo reply, or a Destination Unreachable. A hop prints a line
+** when it first answers, and again when another address answers for it.
+*/
+void sweep_answer(const t_probe *p, uint16_t wire_seq, struct in_addr from, int last, uint64_t now) {
+    const int ttl = g_ttl_of[wire_seq];
+    const int64_t rtt = (int64_t) (now - p->sent_ns);
+    t_hop *h = &g_hops[ttl];
+
+    if (ttl == 0)
+        return;
+    if (last && (!g_reached || ttl < g_reached))
+        g_reached = ttl;
+    if (h->addr.s_addr != from.s_addr) {
+        if (h->addr.s_addr)
+            h->changes++;
+        h->addr = from;
+        /* Probes with more TTL than the path needs only reach the target again */
+        if (flags.format == FORMAT_TEXT && !flags.quiet && (!g_reached || ttl <= g_reached)) {
+            char addr[INET_ADDRSTRLEN];
+
+            fmt_ipv4(addr, from);
+            ping_msg(MSG_SWEEP_HOP, ttl, addr, (double) rtt / NS_PER_MS,
+                     h->changes ? " (address changed)" : "");
+        }
+    }
+    h->last_rtt = rtt;
+    h->stats.rx++;
+    update_stats(&h->stats, rtt);
+}
+
+/* Points message `i` of the batch at a control message setting its TTL */
+static void set_ttl(struct msghdr *msg, int i, int ttl) {
+    struct cmsghdr *c = &g_ttl_cmsgs[i].align;
+
+    c->cmsg_level = IPPROTO_IP;
+    c->cmsg_type = IP_TTL;
+    c->cmsg_len = CMSG_LEN(sizeof(ttl));
+    ft_memcpy(CMSG_DATA(c), &ttl, sizeof(ttl));
+    msg->msg_control = g_ttl_cmsgs[i].buf;
+    msg->msg_controllen = sizeof(g_ttl_cmsgs[i].buf);
+}
+
+/* One probe for each TTL from 1 to `hops`, IO_BATCH per sendmmsg() */
+static void send_round(int sock, t_sched *s, t_tx_batch *tx, int hops) {
+    t_target *t = &g_targets[0];
+    int ttl = 1;
+
+    while (ttl <= hops) {
+        const uint64_t sent_ns = now_ns();
+        int n = 0;
+
+        for (; n < IO_BATCH && ttl <= hops; n++, ttl++) {
+            const uint16_t seq = (uint16_t) atomic_fetch_add_explicit(&t->seq, 1, memory_order_relaxed);
+
+            probe_track(s->wire_seq, 0, seq, sent_ns);
+            g_ttl_of[s->wire_seq] = (uint8_t) ttl;
+            pkt_stamp(&tx->tpl, tx->hdrs[n], s->wire_seq);
+            set_ttl(&tx->msgs[n].msg_hdr, n, ttl);
+            tx->msgs[n].msg_hdr.msg_name = &t->addr;
+            tx->seqs[n] = s->wire_seq;
+            s->wire_seq++;
+        }
+
+        /* sendmmsg() stops at the first failing message: report it, skip it */
+        int off = 0;
+        while (off < n) {
+            int done = g_transport->send(sock, tx->msgs + off, (unsigned int) (n - off));
+            if (done < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (!flags.quiet)
+                    ping_msg(MSG_ERR_SENDTO, strerror(errno));
+                probe_forget(tx->seqs[off]);
+                done = 0;
+                off++;
+            }
+            for (int i = off; i < off + done; i++) {
+                g_hops[g_ttl_of[tx->seqs[i]]].stats.tx++;
+                STAT_INC(t->stats.tx);
+                g_stats.tx++;
+            }
+            off += done;
+        }
+    }
+}
+
+/* Probes still waiting when the run stops were never given their chance */
+static void uncount_pending(void) {
+    for (size_t i = 0; i < PROBE_MAP_SIZE; i++)
+        if (g_probes[i].state == PROBE_PENDING && g_ttl_of[i])
+            g_hops[g_ttl_of[i]].stats.tx--;
+}
+
+static void report_hops(int last) {
+    const t_target *t = &g_targets[0];
+
+    if (flags.format != FORMAT_TEXT) {
+        for (int ttl = 1; ttl <= last; ttl++)
+            record_hop(ttl, &g_hops[ttl]);
+        return;
+    }
+    ping_msg(MSG_SWEEP_STATS_HEADER, t->name);
+    ping_msg(MSG_SWEEP_COLUMNS);
+    for (int ttl = 1; ttl <= last; ttl++) {
+        const t_hop *h = &g_hops[ttl];
+        const t_stats *s = &h->stats;
+        const double loss = s->tx > 0 ? (double) (s->tx - s->rx) * 100.0 / (double) s->tx : 0.0;
+        char addr[INET_ADDRSTRLEN] = "???";
+
+        if (h->addr.s_addr)
+            fmt_ipv4(addr, h->addr);
+        if (s->rx > 0) {
+            const double var = s->m2 / (double) s->rx;
+
+            ping_msg(MSG_SWEEP_ROW, ttl, addr, loss, s->tx, s->rx, (double) h->last_rtt / NS_PER_MS,
+                     s->mean / NS_PER_MS, (double) s->min / NS_PER_MS, (double) s->max / NS_PER_MS,
+                     ft_sqrt(var > 0 ? var : 0) / NS_PER_MS, h->changes ? " (address changed)" : "");
+        } else {
+            ping_msg(MSG_SWEEP_ROW_NORTT, ttl, addr, loss, s->tx, s->rx);
+        }
+    }
+    if (!g_reached)
+        ping_msg(MSG_SWEEP_UNREACHED, t->name, flags.sweep);
+}
+
+/*
+** Sweeps the only target's path until -c rounds are settled, or a signal
+** or -w stops it, then reports every hop. Returns the target's hop, 0 if
+** it never answered.
+*/
+int sweep_run(int sock, int id, int sig_fd) {
+    t_sched sched = {.id = id, .end = 1, .limit = -1};
+    t_tx_batch tx;
+    t_rx_batch rx;
+    long rounds = 0;
+
+    io_batch_init(&tx, &rx, id);
+    g_stats.start_ns = now_ns();
+    ft_memset(g_hops, 0, sizeof(g_hops));
+    ft_memset(g_ttl_of, 0, sizeof(g_ttl_of));
+    g_reached = 0;
+
+    const int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0)
+        ping_fatal(MSG_ERR_EPOLL, strerror(errno));
+    epoll_watch(epfd, sock);
+    epoll_watch(epfd, sig_fd);
+
+    /* -w stops the sweep like a signal: the hops are reported as they are */
+    int deadline_fd = -1;
+    if (flags.timeout > 0) {
+        const struct timespec deadline = {.tv_sec = flags.timeout, .tv_nsec = 0};
+        const struct timespec none = {0, 0};
+
+        deadline_fd = timer_open(0, &deadline, &none);
+        epoll_watch(epfd, deadline_fd);
+    }
+
+    uint64_t next_ns = now_ns();
+    while (!should_stop) {
+        const uint64_t now = now_ns();
+        const int done = flags.count > 0 && rounds >= flags.count;
+        int wait_ms = -1;
+
+        probes_expire(now);
+        const int pending = probes_until(now) >= 0;
+        if (done && !pending)
+            break;
+        /* With -i 0 a round starts once the previous one is settled */
+        if (!done && (flags.interval_ns > 0 ? now >= next_ns : !pending)) {
+            send_round(sock, &sched, &tx, g_reached ? g_reached : flags.sweep);
+            rounds++;
+            next_ns += (uint64_t) flags.interval_ns;
+            continue;
+        }
+        if (!done && flags.interval_ns > 0)
+            wait_ms = (int) ((next_ns - now + 999999) / 1000000);
+        wait_ms = probes_wait_ms(wait_ms, now_ns());
+        out_poll(wait_ms >= 0 ? (uint64_t) wait_ms * 1000000 : UINT64_MAX);
+
+        struct epoll_event events[3];
+        const int n = epoll_wait(epfd, events, 3, wait_ms);
+        g_io_syscalls++;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            ping_fatal(MSG_ERR_EPOLL, strerror(errno));
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd == sock) {
+                if (events[i].events & EPOLLERR)
+                    transport_drain_errqueue(sock);
+                recv_packets(sock, sched.id, &rx);
+            } else if (events[i].data.fd == deadline_fd) {
+                should_stop = 1;
+            } else if (events[i].data.fd == sig_fd && signal_read(sig_fd)) {
+                should_stop = 1;
+            }
+        }
+    }
+
+    uncount_pending();
+    report_hops(g_reached ? g_reached : flags.sweep);
+    out_flush();
+    statsfile_flush();
+    io_batch_free(&tx, &rx);
+    close(epfd);
+    if (deadline_fd >= 0)
+        close(deadline_fd);
+    return g_reached;
+}
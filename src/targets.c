@@ -0,0 +1,84 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "libft/libft.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+
+/*
+** Target table
+** ------------
+** Every destination lives in one flat, growable array of `t_target`. The
+** index into that array is what the probe ring stores, so a reply is matched
+** to its target with two array lookups and no search.
+*/
+
+static size_t g_targets_cap = 0;
+
+t_target *target_add(const char *name) {
+    if (g_ntargets == g_targets_cap) {
+        size_t cap = g_targets_cap ? g_targets_cap * 2 : 16;
+        t_target *grown = realloc(g_targets, cap * sizeof(*grown));
+        if (!grown)
+            ping_fatal(MSG_ERR_OUT_OF_MEMORY);
+        g_targets = grown;
+        g_targets_cap = cap;
+    }
+
+    t_target *t = &g_targets[g_ntargets++];
+    ft_memset(t, 0, sizeof(*t));
+    t->name = name;
+    t->stats.min = INT64_MAX;
+    return t;
+}
+
+/* Reads one destination per line; blank lines and '#' comments are skipped */
+void targets_load_file(const char *path) {
+    FILE *fp = (ft_strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    if (!fp)
+        ping_fatal(MSG_ERR_TARGETS_FILE, path, strerror(errno));
+
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+
+    while ((len = getline(&line, &cap, fp)) >= 0) {
+        char *s = line;
+        while (*s == ' ' || *s == '\t')
+            s++;
+        char *end = s + ft_strlen(s);
+        while (end > s && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t'))
+            *--end = '\0';
+        if (*s == '\0' || *s == '#')
+            continue;
+
+        char *name = ft_strdup(s);
+        if (!name)
+            ping_fatal(MSG_ERR_OUT_OF_MEMORY);
+        target_add(name);
+    }
+
+    free(line);
+    if (fp != stdin)
+        fclose(fp);
+}
+
+/*
+** Resolves the destinations. A single target is looked up before anything
+** is sent and an unknown host is fatal, as before. With several the names
+** are looked up in the background (resolver.c): probing starts at once, each
+** target joining in when its address arrives, and a name that does not
+** resolve is reported and left out of the run.
+*/
+void targets_resolve(void) {
+    if (g_ntargets > 1) {
+        resolver_start();
+        return;
+    }
+
+    t_target *t = &g_targets[0];
+    if (resolve_destination(t->name, &t->addr) < 0)
+        ping_fatal(MSG_ERR_UNKNOWN_HOST, t->name);
+}
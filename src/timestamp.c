@@ -0,0 +1,67 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "libft/libft.h"
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+/*
+** Kernel timestamps (--kernel-ts)
+** -------------------------------
+** With SO_TIMESTAMPING the kernel stamps each reply when it reaches the
+** socket (delivered as a cmsg on the normal recvmmsg()) and each request
+** when it leaves the stack (looped back on the socket error queue). Their
+** difference is the RTT without our own scheduling latency in it.
+**
+** TX stamps carry no packet data (OPT_TSONLY), only a per-socket counter
+** (OPT_ID) that increments once per sent datagram. The ring below maps that
+** counter back to the wire sequence number of the probe.
+*/
+
+static _Thread_local uint16_t g_key_seq[PROBE_MAP_SIZE];
+static _Thread_local uint32_t g_next_key = 0;
+
+int kts_enable(int sock) {
+    int opt = SOF_TIMESTAMPING_SOFTWARE |
+              SOF_TIMESTAMPING_RX_SOFTWARE |
+              SOF_TIMESTAMPING_TX_SOFTWARE |
+              SOF_TIMESTAMPING_OPT_ID |
+              SOF_TIMESTAMPING_OPT_TSONLY;
+
+    if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING, &opt, sizeof(opt)) < 0) {
+        ping_msg(MSG_ERR_SETSOCKOPT_TSTAMP, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* Called for every datagram the kernel accepted, in send order */
+void kts_on_sent(uint16_t wire_seq) {
+    g_key_seq[g_next_key++ & (PROBE_MAP_SIZE - 1)] = wire_seq;
+}
+
+static int64_t ts_to_ns(const struct timespec *ts) {
+    return (int64_t) ts->tv_sec * NS_PER_SEC + ts->tv_nsec;
+}
+
+/* Software timestamp from an SCM_TIMESTAMPING cmsg, 0 if there is none */
+int64_t kts_from_msg(const struct msghdr *msg) {
+    for (struct cmsghdr *c = CMSG_FIRSTHDR((struct msghdr *) msg); c; c = CMSG_NXTHDR((struct msghdr *) msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPING) {
+            struct scm_timestamping tss;
+            ft_memcpy(&tss, CMSG_DATA(c), sizeof(tss));
+            return ts_to_ns(&tss.ts[0]);
+        }
+    }
+    return 0;
+}
+
+/* Records the TX stamp of error queue entry `key` in the probe map */
+void kts_on_tx_stamp(uint32_t key, int64_t ts) {
+    g_probes[g_key_seq[key & (PROBE_MAP_SIZE - 1)]].ktx_ns = ts;
+}
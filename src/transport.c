@@ -0,0 +1,199 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "libft/libft.h"
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+
+/*
+** Transports
+** ----------
+** raw:   SOCK_RAW/IPPROTO_ICMP. Needs cap_net_raw, sees every ICMP packet
+**        the host gets (narrowed by the socket filter) with its IP header.
+**        The ICMP id is our pid.
+** dgram: SOCK_DGRAM/IPPROTO_ICMP ("ping socket"). Allowed without
+**        privileges when net.ipv4.ping_group_range covers our group. The
+**        kernel assigns the id (bind() picks it, it reads back as the port),
+**        only delivers our own replies and strips the IP header. The TTL
+**        comes as a cmsg and ICMP errors through the error queue.
+** sim:   no socket at all; replies come from the simulator (sim.c).
+**
+** auto tries raw first and falls back to dgram when raw is not permitted.
+*/
+
+static int raw_open(void) {
+    return socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+}
+
+/* Worker `index` uses pid + index, so each worker socket filters its own id */
+static int raw_setup(int sock, int index) {
+    const int id = (getpid() + index) & 0xFFFF;
+
+    /* Not fatal: without the filter pkt_parse_raw() still drops what isn't ours */
+    if (!flags.no_filter)
+        filter_attach(sock, id, 0);
+    return id;
+}
+
+static int dgram_open(void) {
+    return socket(AF_INET, SOCK_DGRAM, IPPROTO_ICMP);
+}
+
+static int dgram_setup(int sock, int index) {
+    struct sockaddr_in sa = {.sin_family = AF_INET};
+    socklen_t len = sizeof(sa);
+    const int on = 1;
+
+    (void) index;
+    if (bind(sock, (struct sockaddr *) &sa, sizeof(sa)) < 0
+        || getsockname(sock, (struct sockaddr *) &sa, &len) < 0)
+        ping_fatal(MSG_ERR_BIND, strerror(errno));
+
+    if (setsockopt(sock, IPPROTO_IP, IP_RECVTTL, &on, sizeof(on)) < 0)
+        ping_msg(MSG_ERR_SETSOCKOPT_RECVTTL, strerror(errno));
+    if (setsockopt(sock, IPPROTO_IP, IP_RECVERR, &on, sizeof(on)) < 0)
+        ping_msg(MSG_ERR_SETSOCKOPT_RECVERR, strerror(errno));
+    return ntohs(sa.sin_port);
+}
+
+static int mmsg_send(int sock, struct mmsghdr *msgs, unsigned int n) {
+    g_io_syscalls++;
+    return sendmmsg(sock, msgs, n, 0);
+}
+
+static int mmsg_recv(int sock, struct mmsghdr *msgs, unsigned int n) {
+    g_io_syscalls++;
+    return recvmmsg(sock, msgs, n, MSG_DONTWAIT, NULL);
+}
+
+const t_transport g_transport_raw = {
+    "raw", raw_open, raw_setup, mmsg_send, mmsg_recv, pkt_parse_raw
+};
+
+const t_transport g_transport_dgram = {
+    "dgram", dgram_open, dgram_setup, mmsg_send, mmsg_recv, pkt_parse_dgram
+};
+
+const t_transport *g_transport = &g_transport_raw;
+
+/* Opens the socket of the transport chosen with --transport, fatal if none */
+int transport_open(void) {
+    int raw_errno = 0;
+    int sock;
+
+    if (flags.transport == TRANSPORT_SIM) {
+        g_transport = &g_transport_sim;
+        sock = g_transport->open();
+        if (sock < 0)
+            ping_fatal(MSG_ERR_SOCKET, strerror(errno));
+        return sock;
+    }
+    if (flags.transport != TRANSPORT_DGRAM) {
+        sock = raw_open();
+        if (sock >= 0) {
+            g_transport = &g_transport_raw;
+            return sock;
+        }
+        raw_errno = errno;
+        if (flags.transport == TRANSPORT_RAW || (errno != EPERM && errno != EACCES))
+            ping_fatal(MSG_ERR_SOCKET, strerror(raw_errno));
+    }
+
+    sock = dgram_open();
+    if (sock < 0) {
+        const int dgram_errno = errno;
+
+        /* The default range "1 0" lets no group open one */
+        if (dgram_errno == EACCES)
+            ping_msg(MSG_DGRAM_GROUP_HINT);
+        ping_fatal(MSG_ERR_SOCKET, strerror(raw_errno ? raw_errno : dgram_errno));
+    }
+    g_transport = &g_transport_dgram;
+    if (raw_errno && flags.verbose)
+        ping_msg(MSG_TRANSPORT_FALLBACK, strerror(raw_errno));
+    return sock;
+}
+
+/*
+** Opens a probing socket: the first one picks the transport, the others (one
+** per worker) use the same. Sets the TTL and kernel timestamps if asked.
+*/
+int transport_socket(int index, int *id) {
+    int sock = index == 0 ? transport_open() : g_transport->open();
+    if (sock < 0)
+        ping_fatal(MSG_ERR_SOCKET, strerror(errno));
+    *id = g_transport->setup(sock, index);
+
+    /* The simulator has no socket options and no kernel to timestamp with */
+    if (g_transport == &g_transport_sim) {
+        flags.kernel_ts = 0;
+        return sock;
+    }
+    if (flags.ttl > 0 && setsockopt(sock, IPPROTO_IP, IP_TTL, &flags.ttl, sizeof(flags.ttl)) < 0)
+        ping_msg(MSG_ERR_SETSOCKOPT_TTL, strerror(errno));
+
+    /* --pmtu: DF on every probe, sized past whatever path MTU the kernel has cached */
+    const int pmtudisc = IP_PMTUDISC_PROBE;
+    if (flags.pmtu && setsockopt(sock, IPPROTO_IP, IP_MTU_DISCOVER, &pmtudisc, sizeof(pmtudisc)) < 0)
+        ping_fatal(MSG_ERR_SETSOCKOPT_PMTUDISC, strerror(errno));
+
+    if (flags.kernel_ts && kts_enable(sock) < 0)
+        flags.kernel_ts = 0;
+    return sock;
+}
+
+/*
+** Reads the socket error queue: TX timestamps (--kernel-ts) go to the probe
+** map, ICMP errors about our probes (dgram, IP_RECVERR) are reported. The
+** data of an ICMP error entry is the ICMP header of the probe we sent and
+** msg_name the address it was sent to. Returns the number of entries read.
+*/
+int transport_drain_errqueue(int sock) {
+    char ctrl[512] __attribute__((aligned(8)));
+    char data[64] __attribute__((aligned(8)));
+    struct sockaddr_in dst;
+    int count = 0;
+
+    for (;; count++) {
+        struct iovec iov = {.iov_base = data, .iov_len = sizeof(data)};
+        struct msghdr msg = {
+            .msg_name = &dst, .msg_namelen = sizeof(dst),
+            .msg_iov = &iov, .msg_iovlen = 1,
+            .msg_control = ctrl, .msg_controllen = sizeof(ctrl)
+        };
+
+        const ssize_t len = recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+        g_io_syscalls++;
+        if (len < 0)
+            return count;
+
+        const int64_t ts = kts_from_msg(&msg);
+        struct sock_extended_err ee = {0};
+        struct sockaddr_in offender = {0};
+
+        for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level == SOL_IP && c->cmsg_type == IP_RECVERR) {
+                const struct sock_extended_err *e = (const struct sock_extended_err *) CMSG_DATA(c);
+                ft_memcpy(&ee, e, sizeof(ee));
+                ft_memcpy(&offender, SO_EE_OFFENDER(e), sizeof(offender));
+            }
+        }
+
+        if (ee.ee_origin == SO_EE_ORIGIN_TIMESTAMPING && ts) {
+            kts_on_tx_stamp(ee.ee_data, ts);
+        } else if (ee.ee_origin == SO_EE_ORIGIN_ICMP
+                   && (size_t) len >= sizeof(struct my_icmp_header)
+                   && msg.msg_namelen >= sizeof(dst)) {
+            const struct my_icmp_header *probe = (const struct my_icmp_header *) data;
+            /* ee_info is the next-hop MTU of a Fragmentation Needed */
+            const uint16_t next_mtu = ee.ee_type == ICMP_DEST_UNREACH && ee.ee_code == ICMP_FRAG_NEEDED
+                                      ? (uint16_t) ee.ee_info : 0;
+            pkt_report_error(offender.sin_addr, ee.ee_type, ee.ee_code, dst.sin_addr, ntohs(probe->sequence),
+                             next_mtu);
+        }
+    }
+}
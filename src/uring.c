@@ -0,0 +1,642 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "ft_instr.h"
+#include "libft/libft.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/*
+** io_uring event loop (--io uring)
+** --------------------------------
+** Same schedule and output as ping_loop(), but every wait is one
+** io_uring_enter() that also submits whatever was queued since the last
+** one, so a batch of sends and the wait for the next event share a syscall.
+**
+**   - replies: one multishot RECVMSG stays armed on the socket and picks
+**     its buffers from a provided-buffer ring, so there is no re-arm and no
+**     readiness wakeup per packet. Each completion is handed to the
+**     transport's parse() like a recvmmsg() entry.
+**   - sends: the transport's send() is swapped for one that copies each
+**     probe into a send slot and queues a SENDMSG for it. Failures come
+**     back as completions and are taken off the tx counters then.
+**   - interval: an absolute TIMEOUT on the pacer's CLOCK_MONOTONIC schedule,
+**     re-armed on each expiration; the pacer decides how many probes are due.
+**   - -w deadline: a relative TIMEOUT; SIGINT and the error queue: multishot
+**     POLL_ADD on the signalfd and on the socket (POLLERR), and on the
+**     packet ring's socket with --rx-ring.
+**
+** uring_loop() returns -1 before sending anything when the kernel cannot do
+** all of this (no io_uring, no buffer rings or multishot receive), and the
+** caller falls back to ping_loop().
+*/
+
+#define RING_ENTRIES  256
+#define RX_BUFS       256              /* provided buffers, a power of two */
+#define RX_BGID       1
+#define SEND_SLOTS    (2 * IO_BATCH)
+
+enum { TAG_RECV = 1, TAG_TICK, TAG_DEADLINE, TAG_SIGNAL, TAG_ERRQ, TAG_RING, TAG_RESOLVE, TAG_SEND };
+
+#define TAG(ud)       ((int) ((ud) & 0xFF))
+#define SLOT(ud)      ((int) ((ud) >> 8))
+
+typedef struct s_send_slot {
+    struct msghdr  msg;
+    struct iovec   iov[2];
+    uint8_t        hdr[PKT_HDR_LEN] __attribute__((aligned(8)));
+    uint16_t       wire_seq;          /* probe to forget if the send fails */
+} t_send_slot;
+
+typedef struct s_uring {
+    int                  fd;
+    void                *sq_ring;
+    void                *cq_ring;
+    size_t               sq_ring_sz;
+    size_t               cq_ring_sz;
+    struct io_uring_sqe *sqes;
+    size_t               sqes_sz;
+    unsigned            *sq_head;
+    unsigned            *sq_tail;
+    unsigned            *sq_array;
+    unsigned             sq_mask;
+    unsigned             sq_entries;
+    unsigned            *cq_head;
+    unsigned            *cq_tail;
+    unsigned             cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned             pending;     /* SQEs queued, not yet submitted */
+
+    struct io_uring_buf_ring *br;     /* provided receive buffers */
+    char                *rx_bufs;
+    size_t               rx_buf_len;
+    struct msghdr        rx_msg;      /* name and control sizes for RECVMSG */
+
+    t_send_slot          slots[SEND_SLOTS];
+    int                  free_slots[SEND_SLOTS];
+    int                  nfree;
+
+    int                  sock;
+    int                  id;
+    int                  sig_fd;
+    int                  ring_fd;
+    struct __kernel_timespec next_tick;
+    struct __kernel_timespec deadline;
+    long long            period_ns;
+    uint64_t             ticks;        /* expirations not yet acted upon */
+    int                  recv_armed;
+    int                  errq_read;    /* error queue entries read this reap */
+} t_uring;
+
+static t_uring g_ring;
+static t_transport g_uring_transport;
+
+static int uring_reap(t_uring *r);
+
+static int ring_syscall_setup(unsigned entries, struct io_uring_params *p) {
+    return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+/* Submits the queued SQEs and waits for `wait` completions, or until `ts` */
+static int ring_enter(t_uring *r, unsigned wait, const struct __kernel_timespec *ts) {
+    struct io_uring_getevents_arg arg = {.ts = (uint64_t) (uintptr_t) ts};
+    unsigned enter_flags = wait ? IORING_ENTER_GETEVENTS : 0;
+
+    if (ts)
+        enter_flags |= IORING_ENTER_EXT_ARG;
+    g_io_syscalls++;
+    INSTR_START(t_wait);
+    const int ret = (int) syscall(__NR_io_uring_enter, r->fd, r->pending, wait, enter_flags,
+                                  ts ? &arg : NULL, ts ? sizeof(arg) : 0);
+    if (wait)
+        INSTR_STOP(STAGE_WAIT, t_wait, 1);
+    if (ret < 0)
+        return -errno;
+    r->pending -= (unsigned) ret < r->pending ? (unsigned) ret : r->pending;
+    return ret;
+}
+
+/* Next free SQE, zeroed; submits the queue first when it is full */
+static struct io_uring_sqe *ring_sqe(t_uring *r) {
+    unsigned tail = *r->sq_tail;
+
+    while (tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries) {
+        if (ring_enter(r, 0, NULL) < 0)
+            ping_fatal(MSG_ERR_URING, strerror(errno));
+    }
+
+    const unsigned idx = tail & r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+
+    ft_memset(sqe, 0, sizeof(*sqe));
+    r->sq_array[idx] = idx;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    r->pending++;
+    return sqe;
+}
+
+static void ring_close(t_uring *r) {
+    if (r->br) {
+        struct io_uring_buf_reg reg = {.bgid = RX_BGID};
+        syscall(__NR_io_uring_register, r->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    }
+    if (r->sqes)
+        munmap(r->sqes, r->sqes_sz);
+    if (r->cq_ring && r->cq_ring != r->sq_ring)
+        munmap(r->cq_ring, r->cq_ring_sz);
+    if (r->sq_ring)
+        munmap(r->sq_ring, r->sq_ring_sz);
+    if (r->fd >= 0)
+        close(r->fd);
+    free(r->br);
+    free(r->rx_bufs);
+    ft_memset(r, 0, sizeof(*r));
+    r->fd = -1;
+}
+
+/* Creates the ring and maps the queues, -1 with errno set if unavailable */
+static int ring_open(t_uring *r) {
+    struct io_uring_params p = {
+        .flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN,
+        .cq_entries = RING_ENTRIES * 4
+    };
+
+    r->fd = ring_syscall_setup(RING_ENTRIES, &p);
+    if (r->fd < 0 && errno == EINVAL) {
+        /* Older kernel: none of the optional setup flags */
+        ft_memset(&p, 0, sizeof(p));
+        r->fd = ring_syscall_setup(RING_ENTRIES, &p);
+    }
+    if (r->fd < 0)
+        return -1;
+    if (!(p.features & IORING_FEAT_EXT_ARG)) {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+
+    r->sq_ring_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_ring_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_ring_sz > r->sq_ring_sz)
+            r->sq_ring_sz = r->cq_ring_sz;
+        r->cq_ring_sz = r->sq_ring_sz;
+    }
+    r->sq_ring = mmap(NULL, r->sq_ring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED) {
+        r->sq_ring = NULL;
+        return -1;
+    }
+    r->cq_ring = r->sq_ring;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        r->cq_ring = mmap(NULL, r->cq_ring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ring == MAP_FAILED) {
+            r->cq_ring = NULL;
+            return -1;
+        }
+    }
+    r->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        return -1;
+    }
+
+    char *sq = r->sq_ring;
+    char *cq = r->cq_ring;
+    r->sq_head = (unsigned *) (sq + p.sq_off.head);
+    r->sq_tail = (unsigned *) (sq + p.sq_off.tail);
+    r->sq_array = (unsigned *) (sq + p.sq_off.array);
+    r->sq_mask = *(unsigned *) (sq + p.sq_off.ring_mask);
+    r->sq_entries = p.sq_entries;
+    r->cq_head = (unsigned *) (cq + p.cq_off.head);
+    r->cq_tail = (unsigned *) (cq + p.cq_off.tail);
+    r->cq_mask = *(unsigned *) (cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+    return 0;
+}
+
+static void rx_buf_recycle(t_uring *r, unsigned bid) {
+    const unsigned short tail = r->br->tail;
+    struct io_uring_buf *b = &r->br->bufs[tail & (RX_BUFS - 1)];
+
+    b->addr = (uint64_t) (uintptr_t) (r->rx_bufs + (size_t) bid * r->rx_buf_len);
+    b->len = (uint32_t) r->rx_buf_len;
+    b->bid = (uint16_t) bid;
+    __atomic_store_n(&r->br->tail, (unsigned short) (tail + 1), __ATOMIC_RELEASE);
+}
+
+/*
+** Registers the receive buffers. A multishot RECVMSG writes, in each buffer,
+** an io_uring_recvmsg_out header, the source address, the control data,
+** then the datagram.
+*/
+static int rx_ring_setup(t_uring *r, size_t payload_len) {
+    r->rx_msg.msg_namelen = sizeof(struct sockaddr_in);
+    r->rx_msg.msg_controllen = RX_CTRL_LEN;
+    r->rx_buf_len = sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_in)
+                    + RX_CTRL_LEN + payload_len;
+
+    r->br = aligned_alloc(4096, RX_BUFS * sizeof(struct io_uring_buf));
+    r->rx_bufs = malloc(RX_BUFS * r->rx_buf_len);
+    if (!r->br || !r->rx_bufs)
+        ping_fatal(MSG_ERR_OUT_OF_MEMORY);
+    ft_memset(r->br, 0, RX_BUFS * sizeof(struct io_uring_buf));
+
+    struct io_uring_buf_reg reg = {
+        .ring_addr = (uint64_t) (uintptr_t) r->br,
+        .ring_entries = RX_BUFS,
+        .bgid = RX_BGID
+    };
+    if (syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        free(r->br);
+        r->br = NULL;
+        return -1;
+    }
+    for (unsigned i = 0; i < RX_BUFS; i++)
+        rx_buf_recycle(r, i);
+    return 0;
+}
+
+static void arm_recv(t_uring *r) {
+    struct io_uring_sqe *sqe = ring_sqe(r);
+
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = r->sock;
+    sqe->addr = (uint64_t) (uintptr_t) &r->rx_msg;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RX_BGID;
+    sqe->user_data = TAG_RECV;
+    r->recv_armed = 1;
+}
+
+static void arm_poll(t_uring *r, int fd, unsigned events, int tag) {
+    struct io_uring_sqe *sqe = ring_sqe(r);
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = events;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = (uint64_t) tag;
+}
+
+static void arm_timeout(t_uring *r, struct __kernel_timespec *ts, int abs, int tag) {
+    struct io_uring_sqe *sqe = ring_sqe(r);
+
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t) (uintptr_t) ts;
+    sqe->len = 1;
+    sqe->timeout_flags = abs ? IORING_TIMEOUT_ABS : 0;
+    sqe->user_data = (uint64_t) tag;
+}
+
+/* Replaces sendmmsg(): queues one SENDMSG per probe, submitted by the next wait */
+static int uring_send(int sock, struct mmsghdr *msgs, unsigned int n) {
+    t_uring *r = &g_ring;
+
+    for (unsigned int i = 0; i < n; i++) {
+        /* Every slot in flight (socket buffer full): wait for one to complete */
+        while (r->nfree == 0) {
+            const int ret = ring_enter(r, 1, NULL);
+            if (ret < 0 && ret != -EINTR)
+                ping_fatal(MSG_ERR_URING, strerror(-ret));
+            uring_reap(r);
+        }
+
+        const int k = r->free_slots[--r->nfree];
+        t_send_slot *slot = &r->slots[k];
+        const struct msghdr *m = &msgs[i].msg_hdr;
+
+        ft_memcpy(slot->hdr, m->msg_iov[0].iov_base, m->msg_iov[0].iov_len);
+        slot->wire_seq = ntohs(((const struct my_icmp_header *) slot->hdr)->sequence);
+        slot->iov[0] = (struct iovec){slot->hdr, m->msg_iov[0].iov_len};
+        if (m->msg_iovlen > 1)
+            slot->iov[1] = m->msg_iov[1];
+        slot->msg = (struct msghdr){
+            .msg_name = m->msg_name, .msg_namelen = m->msg_namelen,
+            .msg_iov = slot->iov, .msg_iovlen = m->msg_iovlen
+        };
+
+        struct io_uring_sqe *sqe = ring_sqe(r);
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = sock;
+        sqe->addr = (uint64_t) (uintptr_t) &slot->msg;
+        sqe->len = 1;
+        sqe->user_data = ((uint64_t) k << 8) | TAG_SEND;
+    }
+    return (int) n;
+}
+
+/* A multishot receive completion: one datagram in one provided buffer */
+static void on_recv(t_uring *r, const struct io_uring_cqe *cqe) {
+    if (cqe->res >= 0 && (cqe->flags & IORING_CQE_F_BUFFER)) {
+        const unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        char *buf = r->rx_bufs + (size_t) bid * r->rx_buf_len;
+        const struct io_uring_recvmsg_out *out = (const struct io_uring_recvmsg_out *) buf;
+        char *name = buf + sizeof(*out);
+        char *ctrl = name + r->rx_msg.msg_namelen;
+        char *payload = ctrl + r->rx_msg.msg_controllen;
+        const size_t room = r->rx_buf_len - (size_t) (payload - buf);
+
+        struct iovec iov = {
+            .iov_base = payload,
+            .iov_len = out->payloadlen < room ? out->payloadlen : room
+        };
+        const struct msghdr msg = {
+            .msg_name = name,
+            .msg_namelen = out->namelen < r->rx_msg.msg_namelen ? out->namelen : r->rx_msg.msg_namelen,
+            .msg_iov = &iov, .msg_iovlen = 1,
+            .msg_control = out->controllen ? ctrl : NULL,
+            .msg_controllen = out->controllen,
+            .msg_flags = (int) out->flags
+        };
+
+        g_rx_reads++;
+        INSTR_START(t_parse);
+        g_transport->parse(&msg, iov.iov_len, r->id);
+        INSTR_STOP(STAGE_PARSE, t_parse, 1);
+        rx_buf_recycle(r, bid);
+    } else if (cqe->res == -EINVAL) {
+        ping_fatal(MSG_ERR_RECVMSG, strerror(EINVAL));
+    } else if (cqe->res < 0 && cqe->res != -ENOBUFS && cqe->res != -EINTR) {
+        /* A queued ICMP error (dgram) also fails the receive: it is reported
+         * from the error queue, whichever completion comes first */
+        r->errq_read += transport_drain_errqueue(r->sock);
+        if (r->errq_read == 0)
+            ping_msg(MSG_ERR_RECVMSG, strerror(-cqe->res));
+    }
+    /* Out of buffers or an error ends the multishot: the loop re-arms it */
+    if (!(cqe->flags & IORING_CQE_F_MORE))
+        r->recv_armed = 0;
+}
+
+/* A send completion frees its slot; a failed send is taken off the tx counts
+** and its probe forgotten, since no reply or timeout will ever settle it */
+static void on_send(t_uring *r, const struct io_uring_cqe *cqe) {
+    const int k = SLOT(cqe->user_data);
+
+    if (cqe->res < 0) {
+        t_target *t = (t_target *) ((char *) r->slots[k].msg.msg_name - offsetof(t_target, addr));
+
+        if (!flags.quiet)
+            ping_msg(MSG_ERR_SENDTO, strerror(-cqe->res));
+        atomic_fetch_sub_explicit(&t->stats.tx, 1, memory_order_relaxed);
+        g_stats.tx--;
+        probe_forget(r->slots[k].wire_seq);
+    }
+    r->free_slots[r->nfree++] = k;
+}
+
+/* Counts the ticks elapsed since the last one (overruns) and arms the next */
+static void on_tick(t_uring *r) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    const long long now_ns = (long long) now.tv_sec * NS_PER_SEC + now.tv_nsec;
+    long long next_ns = (long long) r->next_tick.tv_sec * NS_PER_SEC + r->next_tick.tv_nsec;
+
+    if (now_ns >= next_ns) {
+        const long long expirations = (now_ns - next_ns) / r->period_ns + 1;
+        r->ticks += (uint64_t) expirations;
+        next_ns += expirations * r->period_ns;
+    }
+    r->next_tick.tv_sec = next_ns / NS_PER_SEC;
+    r->next_tick.tv_nsec = next_ns % NS_PER_SEC;
+    arm_timeout(r, &r->next_tick, 1, TAG_TICK);
+}
+
+static void on_signal(t_uring *r, const struct io_uring_cqe *cqe) {
+    g_io_syscalls++;
+    if (signal_read(r->sig_fd))
+        should_stop = 1;
+    if (!(cqe->flags & IORING_CQE_F_MORE))
+        arm_poll(r, r->sig_fd, POLLIN, TAG_SIGNAL);
+}
+
+/*
+** Handles every completion in the CQ ring, returns how many there were.
+** Never sends: ticks are only counted here, so uring_send() can reap too.
+*/
+static int uring_reap(t_uring *r) {
+    unsigned head = *r->cq_head;
+    int n = 0;
+
+    r->errq_read = 0;
+    while (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+        const struct io_uring_cqe cqe = r->cqes[head & r->cq_mask];
+
+        __atomic_store_n(r->cq_head, ++head, __ATOMIC_RELEASE);
+        n++;
+        switch (TAG(cqe.user_data)) {
+            case TAG_RECV:
+                on_recv(r, &cqe);
+                break;
+            case TAG_SEND:
+                on_send(r, &cqe);
+                break;
+            case TAG_TICK:
+                on_tick(r);
+                break;
+            case TAG_DEADLINE:
+                should_stop = 1;
+                break;
+            case TAG_SIGNAL:
+                on_signal(r, &cqe);
+                break;
+            case TAG_ERRQ:
+                r->errq_read += transport_drain_errqueue(r->sock);
+                if (!(cqe.flags & IORING_CQE_F_MORE))
+                    arm_poll(r, r->sock, POLLERR, TAG_ERRQ);
+                break;
+            case TAG_RING:
+                rxring_drain(r->id);
+                if (!(cqe.flags & IORING_CQE_F_MORE))
+                    arm_poll(r, r->ring_fd, POLLIN, TAG_RING);
+                break;
+            case TAG_RESOLVE:
+                resolver_poll();
+                if (!(cqe.flags & IORING_CQE_F_MORE))
+                    arm_poll(r, resolver_fd(), POLLIN, TAG_RESOLVE);
+                break;
+        }
+    }
+    return n;
+}
+
+/*
+** Sets up the ring, the receive buffers and the multishot receive. The
+** receive is submitted alone first: a kernel without multishot RECVMSG
+** rejects it at once, before anything else is queued.
+*/
+static int uring_setup(t_uring *r, int sock, int id, int sig_fd, size_t payload_len) {
+    ft_memset(r, 0, sizeof(*r));
+    r->fd = -1;
+    r->sock = sock;
+    r->id = id;
+    r->sig_fd = sig_fd;
+
+    if (ring_open(r) < 0 || rx_ring_setup(r, payload_len) < 0)
+        return -1;
+
+    arm_recv(r);
+    const int ret = ring_enter(r, 0, NULL);
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+    const unsigned head = *r->cq_head;
+    if (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+        const int res = r->cqes[head & r->cq_mask].res;
+        __atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+        errno = res < 0 ? -res : EOPNOTSUPP;
+        return -1;
+    }
+
+    for (int k = 0; k < SEND_SLOTS; k++)
+        r->free_slots[k] = SEND_SLOTS - 1 - k;
+    r->nfree = SEND_SLOTS;
+    return 0;
+}
+
+/*
+** The ping_loop() schedule driven by io_uring. Returns -1, having sent
+** nothing, if io_uring cannot be used; 0 once the run is over.
+*/
+int uring_loop(int sock, int id, int sig_fd) {
+    t_uring *r = &g_ring;
+    t_sched sched = {
+        .id = id,
+        .end = g_ntargets,
+        .limit = flags.count > 0 ? (long long) flags.count * (long long) g_ntargets : -1
+    };
+    const int adaptive = flags.flood && flags.interval_ns == 0;
+    const struct __kernel_timespec flood_wait = {.tv_sec = 0, .tv_nsec = FLOOD_WAIT_MS * NS_PER_MS};
+    t_tx_batch tx;
+    t_rx_batch rx;
+
+    io_batch_init(&tx, &rx, sched.id);
+    if (uring_setup(r, sock, id, sig_fd, rx.buf_len) < 0) {
+        const int err = errno;
+        io_batch_free(&tx, &rx);
+        ring_close(r);
+        ping_msg(MSG_IO_FALLBACK, strerror(err));
+        return -1;
+    }
+
+    /* Same transport, but sends go through the ring */
+    const t_transport *saved = g_transport;
+    g_uring_transport = *g_transport;
+    g_uring_transport.send = uring_send;
+    g_transport = &g_uring_transport;
+
+    arm_poll(r, sig_fd, POLLIN, TAG_SIGNAL);
+    arm_poll(r, sock, POLLERR, TAG_ERRQ);
+    r->ring_fd = -1;
+    if (flags.rx_ring) {
+        r->ring_fd = rxring_open(sock, id);
+        arm_poll(r, r->ring_fd, POLLIN, TAG_RING);
+    }
+    if (resolver_fd() >= 0)
+        arm_poll(r, resolver_fd(), POLLIN, TAG_RESOLVE);
+
+    g_stats.start_ns = now_ns();
+
+    t_pacer pacer;
+    pacer_init(&pacer, now_ns());
+    r->period_ns = (long long) pacer.period_ns;
+    if (!adaptive) {
+        const struct timespec start = ns_to_timespec(pacer.next_ns);
+        r->next_tick = (struct __kernel_timespec){start.tv_sec, start.tv_nsec};
+        arm_timeout(r, &r->next_tick, 1, TAG_TICK);
+    }
+    if (flags.timeout > 0) {
+        r->deadline = (struct __kernel_timespec){.tv_sec = flags.timeout, .tv_nsec = 0};
+        arm_timeout(r, &r->deadline, 0, TAG_DEADLINE);
+    }
+
+    while (!should_stop) {
+        const struct __kernel_timespec *wait_ts = NULL;
+
+        probes_expire(now_ns());
+        if (!adaptive && pacer_finished(&pacer, &sched, now_ns()))
+            break;
+
+        if (adaptive) {
+            const int done = sched_done(&sched);
+            /* Probes given up on (-W) or refused (ICMP error) no longer hold a window slot */
+            const long outstanding = g_stats.tx - g_stats.rx - g_stats.timeouts - g_stats.errors;
+
+            if (done && outstanding <= 0)
+                break;
+            if (!done && outstanding < FLOOD_WINDOW)
+                send_probes(sock, &sched, &tx, FLOOD_WINDOW - (int) outstanding);
+            wait_ts = &flood_wait;
+        }
+        out_poll(wait_ts ? FLOOD_WAIT_MS * NS_PER_MS : (uint64_t) r->period_ns);
+        statsfile_poll(wait_ts ? FLOOD_WAIT_MS * NS_PER_MS : (uint64_t) r->period_ns);
+
+        if (!r->recv_armed)
+            arm_recv(r);
+
+        /* Wake up for the next probe deadline if it comes first */
+        struct __kernel_timespec expire_ts;
+        const int64_t until = probes_until(now_ns());
+        if (until >= 0 && (!wait_ts || until < FLOOD_WAIT_MS * NS_PER_MS)) {
+            expire_ts = (struct __kernel_timespec){.tv_sec = until / NS_PER_SEC, .tv_nsec = until % NS_PER_SEC};
+            wait_ts = &expire_ts;
+        }
+
+        /* The sends queued above go out with this wait */
+        const int ret = ring_enter(r, 1, wait_ts);
+        if (ret < 0 && ret != -ETIME && ret != -EINTR && ret != -EBUSY)
+            ping_fatal(MSG_ERR_URING, strerror(-ret));
+
+        const int n = uring_reap(r);
+
+        /* Flood: nothing came back in time, send anyway (or give up at the end) */
+        if (n == 0 && adaptive) {
+            if (sched_done(&sched))
+                break;
+            send_probes(sock, &sched, &tx, 1);
+            continue;
+        }
+
+        if (r->ticks > 0 && !should_stop) {
+            r->ticks = 0;
+            if (!sched_done(&sched))
+                pacer_send(&pacer, sock, &sched, &tx);
+        }
+    }
+
+    /* The send slots point into tx: let the last sends complete */
+    while (r->nfree < SEND_SLOTS || r->pending > 0) {
+        const int ret = ring_enter(r, r->nfree < SEND_SLOTS, NULL);
+        if (ret < 0 && ret != -EINTR)
+            break;
+        uring_reap(r);
+    }
+
+    if (flags.flood)
+        flood_mark('\n');
+    out_flush();
+    statsfile_flush();
+    g_transport = saved;
+    io_batch_free(&tx, &rx);
+    ring_close(r);
+    rxring_close();
+    return 0;
+}
@@ -4,80 +4,94 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <sys/socket.h>
-#include <sys/time.h>
+#include <time.h>
 #include <netdb.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netinet/ip.h>
 
 
-/*
-** Function: checksum
-** ------------------
-** Calculates the 16-bit One's Complement checksum for ICMP/IP headers.
-**
-** This implementation is designed for safety and portability:
-** 1. Alignment Safety: Instead of casting `void *data` directly to `uint16_t*`
-** (which causes undefined behavior or SIGBUS on non-aligned memory on
-** strict architectures like ARM/SPARC), we use `ft_memcpy` to copy
-** bytes into a local `uint16_t` variable.
-** 2. Endianness: The logic handles both Big and Little Endian architectures
-** correctly by processing the buffer as a stream of bytes.
-**
-** @param data  Pointer to the buffer to checksum.
-** @param len   Length of the buffer in bytes.
-**
-** @return      The 1's complement of the 1's complement sum (network byte order).
-*/
-uint16_t checksum(void *b, int len) {
-    unsigned char *buf = b;
-    unsigned int sum = 0;
-    uint16_t word;
-
-    while (len > 1) {
-        ft_memcpy(&word, buf, 2);
-        sum += word;
-        buf += 2;
-        len -= 2;
-    }
-
-    if (len == 1) {
-        word = 0;
-        ft_memcpy(&word, buf, 1);
-        sum += word;
-    }
-
-    while (sum >> 16) {
-        sum = (sum & 0xFFFF) + (sum >> 16);
-    }
-
-    return (uint16_t) (~sum);
-}
-
-void resolve_destination(const char *hostname) {
+int resolve_destination(const char *hostname, struct sockaddr_in *out) {
     struct addrinfo hints, *res;
     ft_memset(&hints, 0, sizeof(hints));
     hints.ai_family = AF_INET;
     hints.ai_socktype = SOCK_RAW;
     hints.ai_protocol = IPPROTO_ICMP;
 
-    if (getaddrinfo(hostname, NULL, &hints, &res) != 0) {
-        ping_fatal(MSG_ERR_UNKNOWN_HOST, hostname);
-    }
-    ft_memcpy(&dest_addr, res->ai_addr, sizeof(struct sockaddr_in));
+    if (getaddrinfo(hostname, NULL, &hints, &res) != 0)
+        return -1;
+    ft_memcpy(out, res->ai_addr, sizeof(struct sockaddr_in));
     freeaddrinfo(res);
+    return 0;
+}
+
+/* CLOCK_MONOTONIC never steps with NTP, so intervals measured with it are exact */
+uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * NS_PER_SEC + (uint64_t) ts.tv_nsec;
 }
 
 double get_time_ms(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (tv.tv_sec * 1000.0) + (tv.tv_usec / 1000.0);
+    return (double) now_ns() / NS_PER_MS;
 }
 
-void update_stats(const double rtt) {
+/*
+** Welford's online algorithm: the mean and the sum of squared deviations are
+** updated per sample, which stays accurate where sq_sum/n - avg^2 cancels
+** (long runs with a small spread around a large mean).
+*/
+void update_stats(t_stats *stats, const int64_t rtt) {
+    if (rtt < 0) return;
+    if (stats->rx == 1 || rtt < stats->min) stats->min = rtt;
+    if (stats->rx == 1 || rtt > stats->max) stats->max = rtt;
+
+    const double delta = (double) rtt - stats->mean;
+    stats->mean += delta / (double) stats->rx;
+    stats->m2 += delta * ((double) rtt - stats->mean);
+
+    if (stats->hist)
+        hist_record(stats->hist, rtt);
+}
+
+/*
+** Folds another thread's accumulator into `dst`. Counters add up and the
+** Welford means and m2 combine exactly (Chan et al.), so the merged mdev is
+** the one a single accumulator would have computed.
+*/
+void stats_merge(t_stats *dst, const t_stats *src) {
+    if (src->rx > 0) {
+        const double na = (double) dst->rx;
+        const double nb = (double) src->rx;
+        const double delta = src->mean - dst->mean;
+
+        if (dst->rx == 0 || src->min < dst->min) dst->min = src->min;
+        if (dst->rx == 0 || src->max > dst->max) dst->max = src->max;
+        dst->mean += delta * nb / (na + nb);
+        dst->m2 += src->m2 + delta * delta * na * nb / (na + nb);
+    }
+    dst->tx += src->tx;
+    dst->rx += src->rx;
+    dst->dup += src->dup;
+    dst->reorder += src->reorder;
+    dst->late += src->late;
+    dst->timeouts += src->timeouts;
+    dst->errors += src->errors;
+    if (dst->hist && src->hist)
+        hist_merge(dst->hist, src->hist);
+}
+
+/* Per-target RTTs without a lock: the sum for the mean, min/max by CAS */
+void target_stats_add(t_target_stats *ts, const int64_t rtt) {
     if (rtt < 0) return;
-    if (g_stats.rx == 1 || rtt < g_stats.min) g_stats.min = rtt;
-    if (g_stats.rx == 1 || rtt > g_stats.max) g_stats.max = rtt;
-    g_stats.sum += rtt;
-    g_stats.sq_sum += rtt * rtt;
+    atomic_fetch_add_explicit(&ts->sum, rtt, memory_order_relaxed);
+
+    int64_t cur = atomic_load_explicit(&ts->min, memory_order_relaxed);
+    while (rtt < cur && !atomic_compare_exchange_weak_explicit(&ts->min, &cur, rtt,
+                                                               memory_order_relaxed, memory_order_relaxed))
+        ;
+    cur = atomic_load_explicit(&ts->max, memory_order_relaxed);
+    while (rtt > cur && !atomic_compare_exchange_weak_explicit(&ts->max, &cur, rtt,
+                                                               memory_order_relaxed, memory_order_relaxed))
+        ;
 }
@@ -0,0 +1,265 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "libft/libft.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+/*
+** Interval summaries (--summary, --window)
+** ----------------------------------------
+** Sends, replies, duplicates and timeouts are counted into a ring of
+** one-second slots, picked by the CLOCK_MONOTONIC second they happen in. A
+** slot has the counters, the RTT min/max/sum, an RTT histogram with the
+** buckets of histogram.c and the jitter: how far each reply's RTT moved
+** from the previous reply of the same target. Every --summary seconds a
+** thread adds up the last --window seconds that are over and prints them.
+** Loss is the share of the probes settled in the window (answered, timed
+** out or refused with an ICMP error) that got no reply, so probes sent near
+** its start or answered after its end do not skew it. Both kinds of loss
+** go into the timeouts counter.
+**
+** The ring has --window + 2 slots, allocated at start: memory and the work
+** per summary depend on the window, not on how long the run has gone on.
+** Any thread bumps the slots with relaxed atomics. The summary thread wipes
+** the slot of the next second while the current one runs, so a slot is not
+** wiped while it is written to (unless that thread is held up for a whole
+** second) and the seconds it adds up are no longer written to.
+*/
+
+typedef struct s_win_slot {
+    _Atomic uint64_t sec;         /* second the slot is counting */
+    _Atomic long     tx;
+    _Atomic long     rx;
+    _Atomic long     dup;
+    _Atomic long     timeouts;
+    _Atomic int64_t  min;         /* INT64_MAX before the first reply */
+    _Atomic int64_t  max;
+    _Atomic int64_t  sum;
+    _Atomic int64_t  jitter_sum;
+    _Atomic long     jitter_n;
+    _Atomic uint32_t hist[HIST_BUCKETS];
+} t_win_slot;
+
+static t_win_slot *g_ring = NULL;
+static uint64_t g_nslots = 0;
+static uint64_t g_first_sec = 0;     /* the run's first second */
+static uint64_t g_wiped_sec = 0;     /* last second whose slot is ready */
+static t_hist g_sum;                 /* scratch for window_collect() */
+
+static pthread_t g_thread;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond;
+static int g_stop = 0;
+
+#define RELAXED memory_order_relaxed
+
+static t_win_slot *slot_of(uint64_t sec) {
+    return &g_ring[sec % g_nslots];
+}
+
+static void slot_wipe(uint64_t sec) {
+    t_win_slot *s = slot_of(sec);
+
+    atomic_store_explicit(&s->tx, 0, RELAXED);
+    atomic_store_explicit(&s->rx, 0, RELAXED);
+    atomic_store_explicit(&s->dup, 0, RELAXED);
+    atomic_store_explicit(&s->timeouts, 0, RELAXED);
+    atomic_store_explicit(&s->min, INT64_MAX, RELAXED);
+    atomic_store_explicit(&s->max, 0, RELAXED);
+    atomic_store_explicit(&s->sum, 0, RELAXED);
+    atomic_store_explicit(&s->jitter_sum, 0, RELAXED);
+    atomic_store_explicit(&s->jitter_n, 0, RELAXED);
+    for (size_t i = 0; i < HIST_BUCKETS; i++)
+        atomic_store_explicit(&s->hist[i], 0, RELAXED);
+    atomic_store_explicit(&s->sec, sec, memory_order_release);
+}
+
+/* Sets up the ring with the seconds of `now` and the next ready */
+void window_init(uint64_t now) {
+    const uint64_t sec = now / NS_PER_SEC;
+
+    free(g_ring);
+    g_nslots = (uint64_t) (flags.window_s > 0 ? flags.window_s : flags.summary_s) + 2;
+    g_ring = calloc(g_nslots, sizeof(*g_ring));
+    if (!g_ring)
+        ping_fatal(MSG_ERR_OUT_OF_MEMORY);
+    g_first_sec = sec;
+    slot_wipe(sec);
+    slot_wipe(sec + 1);
+    g_wiped_sec = sec + 1;
+}
+
+/* Readies the slot of the second after `now`'s, and any skipped before it */
+void window_advance(uint64_t now) {
+    const uint64_t next = now / NS_PER_SEC + 1;
+
+    if (!g_ring)
+        return;
+    if (next - g_wiped_sec > g_nslots)
+        g_wiped_sec = next - g_nslots;
+    while (g_wiped_sec < next)
+        slot_wipe(++g_wiped_sec);
+}
+
+/* Adds up the last --window seconds before `now`'s */
+void window_collect(uint64_t now, t_window_stats *w) {
+    const uint64_t end = now / NS_PER_SEC;
+    const uint64_t span = (uint64_t) (g_nslots - 2);
+    const uint64_t first = end - g_first_sec > span ? end - span : g_first_sec;
+    int64_t min = INT64_MAX;
+    int64_t sum = 0;
+    int64_t jitter_sum = 0;
+    long jitter_n = 0;
+
+    *w = (t_window_stats){.end_ns = end * NS_PER_SEC, .seconds = (long) (end - first), .jitter = -1};
+    ft_memset(&g_sum, 0, sizeof(g_sum));
+    for (uint64_t sec = first; sec < end; sec++) {
+        const t_win_slot *s = slot_of(sec);
+
+        if (atomic_load_explicit(&s->sec, memory_order_acquire) != sec)
+            continue;
+        w->tx += atomic_load_explicit(&s->tx, RELAXED);
+        w->rx += atomic_load_explicit(&s->rx, RELAXED);
+        w->dup += atomic_load_explicit(&s->dup, RELAXED);
+        w->timeouts += atomic_load_explicit(&s->timeouts, RELAXED);
+        sum += atomic_load_explicit(&s->sum, RELAXED);
+        jitter_sum += atomic_load_explicit(&s->jitter_sum, RELAXED);
+        jitter_n += atomic_load_explicit(&s->jitter_n, RELAXED);
+
+        const int64_t smin = atomic_load_explicit(&s->min, RELAXED);
+        const int64_t smax = atomic_load_explicit(&s->max, RELAXED);
+        if (smin < min)
+            min = smin;
+        if (smax > w->rtt_max)
+            w->rtt_max = smax;
+        for (size_t i = 0; i < HIST_BUCKETS; i++)
+            g_sum.counts[i] += atomic_load_explicit(&s->hist[i], RELAXED);
+    }
+
+    for (size_t i = 0; i < HIST_BUCKETS; i++)
+        g_sum.total += g_sum.counts[i];
+    if (w->rx > 0) {
+        w->rtt_min = min;
+        w->rtt_avg = (int64_t) ((double) sum / (double) w->rx + 0.5);
+        w->rtt_p50 = hist_clamp(hist_percentile(&g_sum, 0.50), min, w->rtt_max);
+        w->rtt_p90 = hist_clamp(hist_percentile(&g_sum, 0.90), min, w->rtt_max);
+        w->rtt_p99 = hist_clamp(hist_percentile(&g_sum, 0.99), min, w->rtt_max);
+    }
+    if (jitter_n > 0)
+        w->jitter = (int64_t) ((double) jitter_sum / (double) jitter_n + 0.5);
+}
+
+void window_sent(long n, uint64_t now) {
+    if (g_ring && n > 0)
+        atomic_fetch_add_explicit(&slot_of(now / NS_PER_SEC)->tx, n, RELAXED);
+}
+
+void window_reply(t_target *t, int64_t rtt, uint64_t now) {
+    if (!g_ring || rtt < 0)
+        return;
+
+    t_win_slot *s = slot_of(now / NS_PER_SEC);
+    atomic_fetch_add_explicit(&s->rx, 1, RELAXED);
+    atomic_fetch_add_explicit(&s->sum, rtt, RELAXED);
+    atomic_fetch_add_explicit(&s->hist[hist_bucket(rtt)], 1, RELAXED);
+
+    int64_t cur = atomic_load_explicit(&s->min, RELAXED);
+    while (rtt < cur && !atomic_compare_exchange_weak_explicit(&s->min, &cur, rtt, RELAXED, RELAXED))
+        ;
+    cur = atomic_load_explicit(&s->max, RELAXED);
+    while (rtt > cur && !atomic_compare_exchange_weak_explicit(&s->max, &cur, rtt, RELAXED, RELAXED))
+        ;
+
+    const int64_t prev = atomic_exchange_explicit(&t->stats.last_rtt, rtt, RELAXED);
+    if (prev > 0) {
+        atomic_fetch_add_explicit(&s->jitter_sum, rtt > prev ? rtt - prev : prev - rtt, RELAXED);
+        atomic_fetch_add_explicit(&s->jitter_n, 1, RELAXED);
+    }
+}
+
+void window_dup(uint64_t now) {
+    if (g_ring)
+        atomic_fetch_add_explicit(&slot_of(now / NS_PER_SEC)->dup, 1, RELAXED);
+}
+
+void window_timeout(uint64_t now) {
+    if (g_ring)
+        atomic_fetch_add_explicit(&slot_of(now / NS_PER_SEC)->timeouts, 1, RELAXED);
+}
+
+static void print_window(const t_window_stats *w) {
+    const long settled = w->rx + w->timeouts;
+    const double loss = settled > 0 ? (double) w->timeouts * 100.0 / (double) settled : 0.0;
+    const long stamp = (long) time(NULL);
+
+    if (flags.format != FORMAT_TEXT) {
+        record_window(w);
+    } else if (w->rx > 0) {
+        ping_msg(MSG_WINDOW_RTT, stamp, w->seconds, w->tx, w->rx, loss,
+                 (double) w->rtt_min / NS_PER_MS, (double) w->rtt_p50 / NS_PER_MS,
+                 (double) w->rtt_p90 / NS_PER_MS, (double) w->rtt_p99 / NS_PER_MS,
+                 (double) w->rtt_max / NS_PER_MS,
+                 w->jitter >= 0 ? (double) w->jitter / NS_PER_MS : 0.0);
+    } else {
+        ping_msg(MSG_WINDOW, stamp, w->seconds, w->tx, w->rx, loss);
+    }
+    /* The loop may sleep for a while yet */
+    out_flush();
+}
+
+/* Wakes just after each second, readies the next slot and prints on schedule */
+static void *window_main(void *arg) {
+    uint64_t sec = g_first_sec;
+    t_window_stats w;
+
+    (void) arg;
+    pthread_mutex_lock(&g_lock);
+    while (!g_stop) {
+        const struct timespec wake = ns_to_timespec((sec + 1) * NS_PER_SEC + NS_PER_SEC / 1000);
+
+        if (pthread_cond_timedwait(&g_cond, &g_lock, &wake) == 0 || g_stop)
+            continue;
+        const uint64_t now = now_ns();
+        if (now / NS_PER_SEC <= sec)
+            continue;
+        sec = now / NS_PER_SEC;
+        window_advance(now);
+        if ((sec - g_first_sec) % (uint64_t) flags.summary_s == 0) {
+            window_collect(now, &w);
+            print_window(&w);
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+    return NULL;
+}
+
+void window_start(void) {
+    pthread_condattr_t attr;
+
+    if (flags.summary_s <= 0)
+        return;
+    window_init(now_ns());
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    const int err = pthread_create(&g_thread, NULL, window_main, NULL);
+    if (err)
+        ping_fatal(MSG_ERR_THREAD, strerror(err));
+}
+
+/* Stops the summaries; the run's own summary follows */
+void window_stop(void) {
+    if (!g_ring)
+        return;
+    pthread_mutex_lock(&g_lock);
+    g_stop = 1;
+    pthread_cond_signal(&g_cond);
+    pthread_mutex_unlock(&g_lock);
+    pthread_join(g_thread, NULL);
+    pthread_cond_destroy(&g_cond);
+}
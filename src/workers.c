@@ -0,0 +1,319 @@
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "ft_instr.h"
+#include "libft/libft.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/*
+** Worker pool (--threads N)
+** -------------------------
+** Every worker owns a socket with its own ICMP id (and socket filter for
+** it), its own probe ring and its own stats, so the send and receive paths
+** share nothing but the read-only target table and the per-target atomics.
+**
+** Targets are cut into chunks of WORKER_CHUNK, one send batch each. Worker
+** k owns a contiguous shard of chunks and queues all of it on every tick of
+** the interval (one sweep per interval). The chunks still to send are a
+** range [lo, hi) packed into one atomic word: the owner takes chunks from
+** the front, and a worker done with its own shard steals the back half of
+** another worker's range with a CAS (into a private range nobody else can
+** take from), so a slow shard does not hold up the sweep. A probe is sent
+** on the socket of whoever took its chunk, and its reply comes back there.
+**
+** On exit each worker copies its accumulators out; the main thread merges
+** them into g_stats after the join, so nothing is shared while probing.
+*/
+
+#define WORKER_CHUNK IO_BATCH
+
+#define RANGE(lo, hi) (((uint64_t) (lo) << 32) | (uint32_t) (hi))
+#define RANGE_LO(r)   ((uint32_t) ((r) >> 32))
+#define RANGE_HI(r)   ((uint32_t) (r))
+
+typedef struct s_worker {
+    _Alignas(64) _Atomic uint64_t range;  /* chunks left this sweep */
+    pthread_t   thread;
+    int         index;
+    int         sock;
+    int         id;
+    uint32_t    shard_lo;   /* own chunks: [shard_lo, shard_hi) */
+    uint32_t    shard_hi;
+    uint32_t    stolen_lo;  /* stolen chunks still to send, private */
+    uint32_t    stolen_hi;
+    t_stats     stats;      /* accumulators copied out on exit */
+    t_hist      hist;
+    t_kts_stats kts;
+    long        rx_reads;
+    long        io_syscalls;
+} t_worker;
+
+static t_worker *g_workers = NULL;
+static int g_nworkers = 0;
+static int g_stop_fd = -1;   /* eventfd: readable once the run must end */
+static int g_done_fd = -1;   /* eventfd: each worker adds 1 when it exits */
+static struct timespec g_start;
+
+/* Opens one socket per worker and splits the chunks into even shards */
+void workers_init(void) {
+    const size_t nchunks = (g_ntargets + WORKER_CHUNK - 1) / WORKER_CHUNK;
+
+    g_nworkers = flags.threads < (int) nchunks ? flags.threads : (int) nchunks;
+    g_workers = aligned_alloc(64, sizeof(*g_workers) * (size_t) g_nworkers);
+    if (!g_workers)
+        ping_fatal(MSG_ERR_OUT_OF_MEMORY);
+    ft_memset(g_workers, 0, sizeof(*g_workers) * (size_t) g_nworkers);
+
+    for (int k = 0; k < g_nworkers; k++) {
+        t_worker *w = &g_workers[k];
+
+        w->index = k;
+        w->sock = transport_socket(k, &w->id);
+        w->shard_lo = (uint32_t) (nchunks * (size_t) k / (size_t) g_nworkers);
+        w->shard_hi = (uint32_t) (nchunks * (size_t) (k + 1) / (size_t) g_nworkers);
+        atomic_init(&w->range, RANGE(0, 0));
+    }
+}
+
+/* Takes the next chunk of the own range, then of the stolen one, then steals */
+static int take_chunk(t_worker *w, uint32_t *chunk) {
+    uint64_t r = atomic_load(&w->range);
+
+    while (RANGE_LO(r) < RANGE_HI(r)) {
+        if (atomic_compare_exchange_weak(&w->range, &r, RANGE(RANGE_LO(r) + 1, RANGE_HI(r)))) {
+            *chunk = RANGE_LO(r);
+            return 1;
+        }
+    }
+    if (w->stolen_lo < w->stolen_hi) {
+        *chunk = w->stolen_lo++;
+        return 1;
+    }
+
+    for (int k = 1; k < g_nworkers; k++) {
+        t_worker *v = &g_workers[(w->index + k) % g_nworkers];
+        uint64_t vr = atomic_load(&v->range);
+
+        while (RANGE_LO(vr) < RANGE_HI(vr)) {
+            const uint32_t lo = RANGE_LO(vr);
+            const uint32_t hi = RANGE_HI(vr);
+            const uint32_t mid = lo + (hi - lo) / 2;
+
+            /* The victim keeps [lo, mid), we send mid and keep the rest */
+            if (atomic_compare_exchange_weak(&v->range, &vr, RANGE(lo, mid))) {
+                w->stolen_lo = mid + 1;
+                w->stolen_hi = hi;
+                *chunk = mid;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void send_chunk(t_worker *w, t_sched *s, t_tx_batch *tx, uint32_t chunk) {
+    const size_t first = (size_t) chunk * WORKER_CHUNK;
+    const size_t end = first + WORKER_CHUNK < g_ntargets ? first + WORKER_CHUNK : g_ntargets;
+
+    s->first = first;
+    s->end = end;
+    s->next = first;
+    send_probes(w->sock, s, tx, (int) (end - first));
+}
+
+/* With -c: a target of the shard still owes probes (its name resolved late) */
+static int shard_owed(const t_worker *w) {
+    const size_t first = (size_t) w->shard_lo * WORKER_CHUNK;
+    const size_t end = (size_t) w->shard_hi * WORKER_CHUNK;
+
+    for (size_t i = first; i < end && i < g_ntargets; i++) {
+        const t_target *t = &g_targets[i];
+
+        if (t->state != TARGET_FAILED && t->seq < (uint32_t) flags.count)
+            return 1;
+    }
+    return 0;
+}
+
+static void *worker_main(void *arg) {
+    t_worker *w = arg;
+    t_sched sched = {.id = w->id, .limit = -1};
+    t_tx_batch tx;
+    t_rx_batch rx;
+    long long sweeps = 0;
+
+    stats_thread_init();
+    statsfile_attach(w->index);
+    io_batch_init(&tx, &rx, w->id);
+
+    const struct timespec period = ns_to_timespec(flags.interval_ns > 0 ? (uint64_t) flags.interval_ns : 1);
+    const int tick_fd = timer_open(1, &g_start, &period);
+    const int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0)
+        ping_fatal(MSG_ERR_EPOLL, strerror(errno));
+    epoll_watch(epfd, w->sock);
+    epoll_watch(epfd, tick_fd);
+    epoll_watch(epfd, g_stop_fd);
+
+    for (int done = 0; !done;) {
+        uint32_t chunk;
+        const int busy = take_chunk(w, &chunk);
+
+        if (busy)
+            send_chunk(w, &sched, &tx, chunk);
+        probes_expire(now_ns());
+
+        out_poll(busy ? 0 : (uint64_t) flags.interval_ns);
+        statsfile_poll(busy ? 0 : (uint64_t) flags.interval_ns);
+
+        struct epoll_event events[3];
+        INSTR_START(t_wait);
+        int n = epoll_wait(epfd, events, 3, probes_wait_ms(busy ? 0 : -1, now_ns()));
+        INSTR_STOP(STAGE_WAIT, t_wait, 1);
+        g_io_syscalls++;
+        if (n < 0 && errno != EINTR)
+            ping_fatal(MSG_ERR_EPOLL, strerror(errno));
+
+        for (int i = 0; i < n; i++) {
+            const int fd = events[i].data.fd;
+
+            if (fd == w->sock) {
+                if (events[i].events & EPOLLERR)
+                    transport_drain_errqueue(w->sock);
+                recv_packets(w->sock, w->id, &rx);
+            } else if (fd == tick_fd) {
+                if (timer_drain(tick_fd) == 0)
+                    continue;
+                /* Still busy with the last sweep: skip this one, like a timer overrun */
+                const uint64_t r = atomic_load(&w->range);
+                if (RANGE_LO(r) < RANGE_HI(r) || w->stolen_lo < w->stolen_hi)
+                    continue;
+                if (flags.count > 0 && sweeps >= flags.count && !shard_owed(w)) {
+                    done = 1;
+                } else {
+                    atomic_store(&w->range, RANGE(w->shard_lo, w->shard_hi));
+                    sweeps++;
+                }
+            } else if (fd == g_stop_fd) {
+                done = 1;
+            }
+        }
+    }
+
+    statsfile_flush();
+
+    /* Copy the thread-local accumulators out before they go away */
+    w->stats = g_stats;
+    w->hist = *g_stats.hist;
+    w->stats.hist = &w->hist;
+    w->kts = g_kts;
+    w->rx_reads = g_rx_reads;
+    w->io_syscalls = g_io_syscalls;
+
+    io_batch_free(&tx, &rx);
+    probes_thread_free();
+    close(epfd);
+    close(tick_fd);
+
+    const uint64_t one = 1;
+    ssize_t r = write(g_done_fd, &one, sizeof(one));
+    (void) r;
+    return NULL;
+}
+
+/*
+** Runs the workers until they have all finished their sweeps, or until
+** SIGINT or the -w deadline, then merges their stats into g_stats.
+*/
+void workers_run(int sig_fd) {
+    g_stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    g_done_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_stop_fd < 0 || g_done_fd < 0)
+        ping_fatal(MSG_ERR_EVENTFD, strerror(errno));
+
+    g_stats.start_ns = now_ns();
+    clock_gettime(CLOCK_MONOTONIC, &g_start);
+
+    for (int k = 0; k < g_nworkers; k++) {
+        const int err = pthread_create(&g_workers[k].thread, NULL, worker_main, &g_workers[k]);
+        if (err)
+            ping_fatal(MSG_ERR_THREAD, strerror(err));
+    }
+
+    const struct timespec none = {0, 0};
+    int deadline_fd = -1;
+    const int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0)
+        ping_fatal(MSG_ERR_EPOLL, strerror(errno));
+    epoll_watch(epfd, g_done_fd);
+    if (sig_fd >= 0)
+        epoll_watch(epfd, sig_fd);
+    if (flags.timeout > 0) {
+        const struct timespec deadline = {.tv_sec = flags.timeout, .tv_nsec = 0};
+        deadline_fd = timer_open(0, &deadline, &none);
+        epoll_watch(epfd, deadline_fd);
+    }
+    const int resolve_fd = resolver_fd();
+    if (resolve_fd >= 0)
+        epoll_watch(epfd, resolve_fd);
+
+    int running = g_nworkers;
+    while (running > 0) {
+        struct epoll_event events[4];
+        const int n = epoll_wait(epfd, events, 4, -1);
+
+        for (int i = 0; i < n; i++) {
+            const int fd = events[i].data.fd;
+            uint64_t v = 0;
+
+            if (fd == g_done_fd) {
+                if (read(g_done_fd, &v, sizeof(v)) == sizeof(v))
+                    running -= (int) v;
+                continue;
+            }
+            if (fd == resolve_fd) {
+                resolver_poll();
+                continue;
+            }
+            if (fd == sig_fd) {
+                if (!signal_read(sig_fd))
+                    continue;
+            } else {
+                timer_drain(deadline_fd);
+            }
+            /* SIGINT or deadline: every worker sees the eventfd readable */
+            v = 1;
+            ssize_t r = write(g_stop_fd, &v, sizeof(v));
+            (void) r;
+        }
+    }
+
+    for (int k = 0; k < g_nworkers; k++) {
+        t_worker *w = &g_workers[k];
+
+        pthread_join(w->thread, NULL);
+        stats_merge(&g_stats, &w->stats);
+        stats_merge(&g_kts.rtt, &w->kts.rtt);
+        stats_merge(&g_kts.overhead, &w->kts.overhead);
+        g_rx_reads += w->rx_reads;
+        g_io_syscalls += w->io_syscalls;
+        close(w->sock);
+    }
+
+    close(epfd);
+    if (deadline_fd >= 0)
+        close(deadline_fd);
+    close(g_stop_fd);
+    close(g_done_fd);
+    free(g_workers);
+    g_workers = NULL;
+    g_nworkers = 0;
+}
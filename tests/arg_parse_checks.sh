@@ -3,7 +3,12 @@
 #
 # All flags in src/globals.c are covered:
 #   -v/--verbose, -q/--quiet, -?/--help,
-#   --ttl <N>, -c/--count <N>, -i/--interval <SEC>, -s/--size <N>, -w/--timeout <N>
+#   --ttl <N>, -c/--count <N>, -i/--interval <SEC>, -s/--size <N>, -w/--timeout <N>,
+#   -W/--linger <SEC>, --multi, --file <FILE>, -f/--flood, --kernel-ts,
+#   --no-filter, --transport <TYPE>, --threads <N>, --io <TYPE>, --rx-ring,
+#   --format <FMT>, --rate <PPS>, --burst <N>, --resolve-limit <N>,
+#   --resolve-ttl <SEC>, --sim <SPEC>, --stats-file <FILE>, --summary <SEC>,
+#   --window <SEC>, --rto, --pmtu, --sweep <N>
 #
 # This script supports two execution modes:
 #   1) Unprivileged (e.g. macOS without sudo/cap_net_raw):
@@ -81,9 +86,15 @@ expect_not_contains() {
 # ----- Parse-success detection -----
 # macOS/unprivileged indicator
 SOCKET_PERM_ERR="socket: Operation not permitted"
+# ICMP datagram socket outside net.ipv4.ping_group_range (Linux default "1 0")
+SOCKET_ACCES_ERR="socket: Permission denied"
 # privileged indicator (Linux/macOS with rights)
 PING_HEADER_RE="^PING "
 PING_REPLY_RE="bytes from"
+# --format jsonl replaces the header with a start record
+PING_START_JSON='"type":"start"'
+# --pmtu and --sweep print their own header
+MODE_HEADER_RE="^(PMTU|SWEEP) "
 
 is_parse_success_output() {
   local out="$1"
@@ -92,6 +103,9 @@ is_parse_success_output() {
   if contains "$out" "$SOCKET_PERM_ERR"; then
     return 0
   fi
+  if contains "$out" "$SOCKET_ACCES_ERR"; then
+    return 0
+  fi
 
   # 2) privileged run => should print ping header and/or replies
   if print -- "$out" | grep -Eq "$PING_HEADER_RE"; then
@@ -100,6 +114,12 @@ is_parse_success_output() {
   if contains "$out" "$PING_REPLY_RE"; then
     return 0
   fi
+  if contains "$out" "$PING_START_JSON"; then
+    return 0
+  fi
+  if print -- "$out" | grep -Eq "$MODE_HEADER_RE"; then
+    return 0
+  fi
 
   return 1
 }
@@ -157,6 +177,10 @@ expect_contains "unknown option prints usage" "$out" "Usage: ft_ping"
 # --- no-arg flags (should parse OK and attempt to run) ---
 run_expect_parse_ok "-v (verbose)" -v
 run_expect_parse_ok "--verbose" --verbose
+run_expect_parse_ok "--kernel-ts" --kernel-ts
+run_expect_parse_ok "--no-filter" --no-filter
+run_expect_parse_ok "--rto" --rto
+run_expect_parse_ok "--pmtu" --pmtu
 run_expect_parse_ok "-q (quiet)" -q
 run_expect_parse_ok "--quiet" --quiet
 
@@ -169,6 +193,14 @@ expect_contains "missing destination" "$out" "destination required"
 out=$(run_cmd 1.1.1.1 8.8.8.8)
 expect_contains "multiple destinations" "$out" "multiple destinations provided"
 
+# --multi accepts several destinations
+run_expect_parse_ok "--multi two destinations" --multi 127.0.0.2
+
+# --file reads destinations (implies --multi); missing file => error
+run_expect_parse_ok "--file /dev/null (plus positional)" --file /dev/null
+out=$(run_cmd --file /nonexistent/targets.txt)
+expect_contains "--file missing file" "$out" "No such file or directory"
+
 # --- count (-c): min 1 ---
 run_expect_parse_ok   "-c min (1)" -c 1
 run_expect_parse_fail "-c below min (0)" -c 0
@@ -198,6 +230,95 @@ run_expect_parse_ok   "-w small" -w 1
 run_expect_parse_fail "-w negative" -w -1
 run_expect_parse_fail "-w huge (overflow)" -w 999999999999999999999999
 
+# --- transport: raw, dgram, sim or auto ---
+run_expect_parse_ok   "--transport auto" --transport auto
+run_expect_parse_ok   "--transport raw" --transport raw
+run_expect_parse_ok   "--transport dgram" --transport dgram
+run_expect_parse_ok   "--transport sim" --transport sim
+run_expect_parse_fail "--transport junk" --transport udp
+
+# --- sim: key=value list, percentages 0..100, not with io_uring ---
+run_expect_parse_ok   "--sim loss and delay" --sim loss=1,delay=0.5
+run_expect_parse_ok   "--sim every key" --sim delay=2,jitter=1,dist=exp,loss=1,dup=1,reorder=1,ttl=1,unreach=1,seed=9
+run_expect_parse_fail "--sim unknown key" --sim bogus=1
+run_expect_parse_fail "--sim loss above 100" --sim loss=200
+run_expect_parse_fail "--sim no value" --sim x
+run_expect_parse_fail "--sim bad dist" --sim dist=pareto
+run_expect_parse_fail "--sim with uring" --sim loss=1 --io uring
+
+# --- stats-file: created before the sockets; an unwritable path is fatal ---
+run_expect_parse_ok   "--stats-file" --stats-file /tmp/ft_ping_apc.stats
+run_expect_parse_fail "--stats-file missing dir" --stats-file /nonexistent/dir/stats
+run_expect_parse_fail "--stats-file missing value" --stats-file
+
+# --- summary/window: 1..3600 seconds; --window needs --summary ---
+run_expect_parse_ok   "--summary 1" --summary 1
+run_expect_parse_ok   "--summary with --window" --summary 10 --window 60
+run_expect_parse_ok   "--summary 3600" --summary 3600
+run_expect_parse_fail "--summary 0" --summary 0
+run_expect_parse_fail "--summary 3601" --summary 3601
+run_expect_parse_fail "--summary junk" --summary 1s
+run_expect_parse_fail "--window 0" --summary 1 --window 0
+run_expect_parse_fail "--window 3601" --summary 1 --window 3601
+run_expect_parse_fail "--window without --summary" --window 10
+
+# --- pmtu: one target, epoll loop, -s of 40 or more ---
+run_expect_parse_ok   "--pmtu with -s" --pmtu -s 1472
+run_expect_parse_ok   "--pmtu with -s 40" --pmtu -s 40
+run_expect_parse_fail "--pmtu with -s 39" --pmtu -s 39
+run_expect_parse_fail "--pmtu with -f" --pmtu -f
+run_expect_parse_fail "--pmtu with threads" --pmtu --threads 2
+run_expect_parse_fail "--pmtu with --io uring" --pmtu --io uring
+run_expect_parse_fail "--pmtu with --rx-ring" --pmtu --rx-ring
+run_expect_parse_fail "--pmtu with --summary" --pmtu --summary 1
+run_expect_parse_fail "--pmtu with two destinations" --pmtu --multi 127.0.0.2
+
+# --- sweep: TTLs 1..255, one target, epoll loop ---
+run_expect_parse_ok   "--sweep 1" --sweep 1
+run_expect_parse_ok   "--sweep 255" --sweep 255
+run_expect_parse_ok   "--sweep with -i 0" --sweep 4 -i 0
+run_expect_parse_fail "--sweep 0" --sweep 0
+run_expect_parse_fail "--sweep 256" --sweep 256
+run_expect_parse_fail "--sweep junk" --sweep far
+run_expect_parse_fail "--sweep with -f" --sweep 4 -f
+run_expect_parse_fail "--sweep with threads" --sweep 4 --threads 2
+run_expect_parse_fail "--sweep with --rate" --sweep 4 --rate 10
+run_expect_parse_fail "--sweep with --pmtu" --sweep 4 --pmtu
+run_expect_parse_fail "--sweep with two destinations" --sweep 4 --multi 127.0.0.2
+
+# --- threads: 1..256, not with flood ---
+run_expect_parse_ok   "--threads 1" --threads 1
+run_expect_parse_ok   "--threads 4" --threads 4
+run_expect_parse_fail "--threads zero" --threads 0
+run_expect_parse_fail "--threads above max" --threads 257
+run_expect_parse_fail "--threads with flood" --threads 2 -f
+
+# --- io: epoll or uring, uring single-threaded only ---
+run_expect_parse_ok   "--io epoll" --io epoll
+run_expect_parse_ok   "--io uring" --io uring
+run_expect_parse_fail "--io junk" --io poll
+run_expect_parse_fail "--io uring with threads" --io uring --threads 2
+
+# --- rx-ring: single-threaded only ---
+run_expect_parse_ok   "--rx-ring" --rx-ring
+run_expect_parse_fail "--rx-ring with threads" --rx-ring --threads 2
+
+# --- format: text, jsonl or binary ---
+run_expect_parse_ok   "--format text" --format text
+run_expect_parse_ok   "--format jsonl" --format jsonl
+run_expect_parse_ok   "--format=jsonl" --format=jsonl
+run_expect_parse_fail "--format junk" --format xml
+out=$(run_cmd --format jsonl -c 1 -w 1 127.0.0.1)
+expect_not_contains "--format jsonl prints no text lines" "$out" "$PING_REPLY_RE"
+
+# --- wait (-W): seconds, must be > 0 ---
+run_expect_parse_ok   "-W small" -W 0.5
+run_expect_parse_ok   "--linger" --linger 2
+run_expect_parse_ok   "--rto with -W" --rto -W 0.5
+run_expect_parse_fail "-W zero" -W 0
+run_expect_parse_fail "-W negative" -W -1
+run_expect_parse_fail "-W junk" -W abc
+
 # --- interval (-i): allow 0, or >=0.002; reject short non-zero ---
 run_expect_parse_ok   "-i zero" -i 0
 run_expect_parse_ok   "-i min non-zero (0.002)" -i 0.002
@@ -205,6 +326,38 @@ run_expect_parse_fail "-i too short (0.001)" -i 0.001
 run_expect_parse_fail "-i negative" -i -1
 run_expect_parse_fail "-i junk" -i abc
 
+# --- rate: probes/s over all targets, no 2 ms floor, not with -i ---
+run_expect_parse_ok   "--rate 10" --rate 10
+run_expect_parse_ok   "--rate fractional" --rate 0.5
+run_expect_parse_ok   "--rate above 500 pps" --rate 2000
+run_expect_parse_fail "--rate zero" --rate 0
+run_expect_parse_fail "--rate negative" --rate -5
+run_expect_parse_fail "--rate junk" --rate fast
+run_expect_parse_fail "--rate with -i" --rate 10 -i 1
+
+# --- burst: 1..1024 ---
+run_expect_parse_ok   "--burst 1" --burst 1
+run_expect_parse_ok   "--burst max (1024)" --burst 1024
+run_expect_parse_fail "--burst zero" --burst 0
+run_expect_parse_fail "--burst above max" --burst 1025
+
+# --- resolver: 1..1024 lookups at once, TTL in seconds (0 = never) ---
+run_expect_parse_ok   "--resolve-limit 1" --resolve-limit 1
+run_expect_parse_ok   "--resolve-limit max (1024)" --resolve-limit 1024
+run_expect_parse_fail "--resolve-limit zero" --resolve-limit 0
+run_expect_parse_fail "--resolve-limit above max" --resolve-limit 1025
+run_expect_parse_ok   "--resolve-ttl 60" --resolve-ttl 60
+run_expect_parse_ok   "--resolve-ttl 0 (never)" --resolve-ttl 0
+run_expect_parse_ok   "--resolve-ttl fractional" --resolve-ttl 0.5
+run_expect_parse_fail "--resolve-ttl negative" --resolve-ttl -1
+run_expect_parse_fail "--resolve-ttl junk" --resolve-ttl soon
+
+# --- flood (-f): lifts the 2 ms interval floor ---
+run_expect_parse_ok   "-f (flood)" -f
+run_expect_parse_ok   "--flood" --flood
+run_expect_parse_ok   "-f with short interval (0.001)" -f -i 0.001
+run_expect_parse_ok   "short interval before -f" -i 0.001 -f
+
 # --- option requires argument (missing) ---
 out=$(run_cmd -c)
 expect_contains "-c missing arg" "$out" "option requires an argument"
@@ -0,0 +1,100 @@
+/*
+** Discard checks: datagrams that are too short, fail the checksum, answer
+** another process, are not an echo reply or an error, or match no probe
+** are dropped without touching the stats, and a good reply still counts.
+** In an instrumented build (make INSTRUMENT=1) each must also land in its
+** drop counter and the stages it went through must have counted it.
+*/
+#include "ft_ping.h"
+#include "ft_instr.h"
+#include "test.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/ip.h>
+
+#define ID 0x1234
+
+/* An IPv4 datagram from 127.0.0.1 holding an ICMP message with a good checksum */
+static size_t datagram(char *buf, uint8_t type, uint16_t id, uint16_t seq) {
+    struct ip *ip = (struct ip *) buf;
+    struct my_icmp_header *icmp = (struct my_icmp_header *) (ip + 1);
+
+    memset(buf, 0, sizeof(*ip) + PKT_HDR_LEN + 8);
+    ip->ip_v = 4;
+    ip->ip_hl = 5;
+    ip->ip_ttl = 64;
+    ip->ip_p = IPPROTO_ICMP;
+    ip->ip_src.s_addr = htonl(INADDR_LOOPBACK);
+    icmp->type = type;
+    icmp->id = htons(id);
+    icmp->sequence = htons(seq);
+    icmp->checksum = csum_fold(csum_partial(icmp, PKT_HDR_LEN + 8, 0));
+    return sizeof(*ip) + PKT_HDR_LEN + 8;
+}
+
+/* Only instrumented builds count the drops */
+static void check_drop(const char *what, t_drop reason, long long want) {
+#ifdef FT_INSTRUMENT
+    check(what, (long long) g_instr->drops[reason], want);
+#else
+    (void) what;
+    (void) reason;
+    (void) want;
+#endif
+}
+
+int main(void) {
+    char buf[128];
+    size_t len;
+
+    stats_thread_init();
+    flags.quiet = 1;
+    flags.wait_ms = 1000;
+    target_add("127.0.0.1");
+    g_targets[0].addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    g_targets[0].stats.min = INT64_MAX;
+    probe_track(1, 0, 1, now_ns());
+
+    /* 1. Each kind of stray datagram is dropped */
+    len = datagram(buf, ICMP_ECHOREPLY, ID, 1);
+    pkt_parse_ip(buf, 12, ID, 0, now_ns());
+    pkt_parse_ip(buf, sizeof(struct ip) + 4, ID, 0, now_ns());
+    check_drop("short", DROP_SHORT, 2);
+
+    len = datagram(buf, ICMP_ECHOREPLY, ID, 1);
+    buf[len - 1] ^= 0x55;
+    pkt_parse_ip(buf, len, ID, 0, now_ns());
+    check_drop("bad checksum", DROP_CHECKSUM, 1);
+
+    len = datagram(buf, ICMP_ECHOREPLY, ID + 1, 1);
+    pkt_parse_ip(buf, len, ID, 0, now_ns());
+    check_drop("foreign id", DROP_FOREIGN_ID, 1);
+
+    len = datagram(buf, ICMP_ECHO, ID, 1);
+    pkt_parse_ip(buf, len, ID, 0, now_ns());
+    check_drop("other ICMP type", DROP_ICMP_TYPE, 1);
+
+    len = datagram(buf, ICMP_ECHOREPLY, ID, 2);
+    pkt_parse_ip(buf, len, ID, 0, now_ns());
+    check_drop("no such probe", DROP_UNMATCHED, 1);
+
+    check("nothing counted", g_stats.rx, 0);
+
+    /* 2. The real reply still gets through */
+    len = datagram(buf, ICMP_ECHOREPLY, ID, 1);
+    pkt_parse_ip(buf, len, ID, 0, now_ns());
+    check("reply counted", g_stats.rx, 1);
+    check("target rx", g_targets[0].stats.rx, 1);
+
+#ifdef FT_INSTRUMENT
+    check("checksums verified", (long long) g_instr->count[STAGE_CHECKSUM], 5);
+    check("stats updated once", (long long) g_instr->count[STAGE_STATS], 1);
+    check("output once", (long long) g_instr->count[STAGE_OUTPUT], 1);
+#else
+    printf("[SKIP] counters: built without FT_INSTRUMENT\n");
+#endif
+
+    TEST_DONE("instr_test");
+}
@@ -0,0 +1,79 @@
+/*
+** Output sink checks: the integer, fixed-point and address formatters agree
+** with printf / inet_ntop, and a reply line built from its compiled
+** template reads the same as vsnprintf() of the table format.
+*/
+#include "ft_ping.h"
+#include "ft_messages.h"
+#include "test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+int main(void) {
+    char got[64];
+    char want[64];
+
+    /* 1. Integers, edges included */
+    const uint64_t ints[] = {0, 9, 10, 99, 100, 65535, 4294967295ULL, UINT64_MAX};
+    for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++) {
+        got[fmt_u64(got, ints[i])] = '\0';
+        snprintf(want, sizeof(want), "%llu", (unsigned long long) ints[i]);
+        check_str("u64", got, want);
+    }
+
+    /* 2. RTT-like values: nanoseconds shown in ms, 3 and 0 decimals */
+    int mismatches = 0;
+    for (int i = 0; i < 200000; i++) {
+        const double ms = (double) (rnd() % 5000000000ULL) / NS_PER_MS;
+        const int d = (i & 1) ? 3 : 0;
+
+        got[fmt_fixed(got, ms, d)] = '\0';
+        snprintf(want, sizeof(want), "%.*f", d, ms);
+        if (strcmp(got, want) != 0 && mismatches++ < 5)
+            check_str("-fixed", got, want);
+    }
+    got[fmt_fixed(got, 0.0625, 3)] = '\0';
+    check_str("tie rounds to even", got, "0.062");
+    got[fmt_fixed(got, -0.0001, 3)] = '\0';
+    check_str("negative zero", got, "-0.000");
+    snprintf(want, sizeof(want), "%d", 0);
+    got[fmt_u64(got, (uint64_t) mismatches)] = '\0';
+    check_str("fixed mismatches", got, want);
+
+    /* 3. Addresses */
+    const char *addrs[] = {"0.0.0.0", "127.0.0.1", "10.20.30.40", "255.255.255.255"};
+    for (size_t i = 0; i < sizeof(addrs) / sizeof(addrs[0]); i++) {
+        struct in_addr a;
+        inet_pton(AF_INET, addrs[i], &a);
+        fmt_ipv4(got, a);
+        check_str("ipv4", got, addrs[i]);
+    }
+
+    /* 4. A reply line through the sink, read back from a pipe */
+    int fds[2];
+    if (pipe(fds) < 0)
+        return 1;
+    const int saved = dup(STDOUT_FILENO);
+    dup2(fds[1], STDOUT_FILENO);
+    ping_msg(MSG_PING_REPLY, 64L, "127.0.0.1", 7, 64, 1.2345, " (DUP!)");
+    ping_msg(MSG_STATS_TARGET_NORTT, "host", 3L, 0L, 100.0);
+    out_flush();
+    dup2(saved, STDOUT_FILENO);
+    close(fds[1]);
+
+    char line[256] = {0};
+    char expect[256];
+    const ssize_t n = read(fds[0], line, sizeof(line) - 1);
+    close(fds[0]);
+    line[n > 0 ? n : 0] = '\0';
+    snprintf(expect, sizeof(expect), "%ld bytes from %s: icmp_seq=%d ttl=%d time=%.3f ms%s\n"
+             "%s : xmt/rcv/%%loss = %ld/%ld/%.0f%%\n",
+             64L, "127.0.0.1", 7, 64, 1.2345, " (DUP!)", "host", 3L, 0L, 100.0);
+    check_str("template lines", line, expect);
+
+    TEST_DONE("output_test");
+}
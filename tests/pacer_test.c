@@ -0,0 +1,67 @@
+/*
+** Pacing checks: -i and --rate end up as exact nanosecond intervals, a
+** probe is due on the schedule and not before, and a late wakeup sends at
+** most --burst probes and drops the rest from the schedule.
+*/
+#include "ft_ping.h"
+#include "test.h"
+
+#include <stdio.h>
+
+static void parse(char *a1, char *a2) {
+    char *argv[] = {"ft_ping", a1, a2, "127.0.0.1", NULL};
+    parse_args(4, argv);
+}
+
+int main(void) {
+    /* 1. Intervals in nanoseconds, no truncation to milliseconds */
+    parse("-i", "0.0025");
+    check("-i 0.0025", flags.interval_ns, 2500000);
+    parse("-i", "1.5");
+    check("-i 1.5", flags.interval_ns, 1500000000);
+    parse("--rate", "2500");
+    check("--rate 2500", flags.interval_ns, 400000);
+    parse("--rate", "3");
+    check("--rate 3", flags.interval_ns, 333333333);
+
+    /* 2. Due on the schedule, not before; one probe per period */
+    const uint64_t t0 = 1000000;
+    const uint64_t period = 1000000;
+    t_pacer p;
+
+    flags.interval_ns = (int64_t) period;
+    flags.burst = 0;
+    flags.flood = 0;
+    pacer_init(&p, t0);
+    check("period", (long long) p.period_ns, (long long) period);
+    check("not yet due", pacer_due(&p, t0 - 1), 0);
+    check("due at start", pacer_due(&p, t0), 1);
+    p.next_ns += period;
+    check("due next period", pacer_due(&p, t0 + period + 10), 1);
+    p.next_ns += period;
+
+    /* 3. Burst 1: a wakeup 3.5 periods late sends one, the schedule moves on */
+    check("late, burst 1", pacer_due(&p, t0 + 5 * period + period / 2), 1);
+    check("missed ones dropped", (long long) p.next_ns, (long long) (t0 + 5 * period));
+
+    /* 4. Burst 4: ten periods late, four go out to catch up */
+    flags.burst = 4;
+    pacer_init(&p, t0);
+    check("late, burst 4", pacer_due(&p, t0 + 10 * period), 4);
+    check("oldest kept is 3 back", (long long) p.next_ns, (long long) (t0 + 7 * period));
+
+    /* 5. Flooding with an interval catches up a whole batch by default */
+    flags.burst = 0;
+    flags.flood = 1;
+    pacer_init(&p, t0);
+    check("flood burst", pacer_due(&p, t0 + 1000 * period), IO_BATCH);
+
+    /* 6. Several targets share the interval */
+    flags.flood = 0;
+    target_add("127.0.0.2");
+    flags.interval_ns = 3000000;
+    pacer_init(&p, t0);
+    check("period per target", (long long) p.period_ns, 1500000);
+
+    TEST_DONE("pacer_test");
+}
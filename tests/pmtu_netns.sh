@@ -0,0 +1,112 @@
+#!/bin/bash
+# Path MTU discovery (--pmtu) across real routers, in three network
+# namespaces joined by veth pairs:
+#
+#   cli 10.253.1.1 --(1500)-- 10.253.1.2 rtr 10.253.2.1 --(MTU)-- 10.253.2.2 srv
+#
+# rtr forwards, and sends Fragmentation Needed for what does not fit the
+# smaller link unless a tc filter drops those (a black hole). Each scenario
+# builds the namespaces anew, so no path MTU the kernel learned carries over.
+#
+# Usage: tests/pmtu_netns.sh [BIN]
+# Needs root (ip netns); the black hole needs tc. What cannot run is
+# reported as skipped. Exit status 1 if a check failed.
+
+set -u
+
+ROOT_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BIN="${1:-$ROOT_DIR/ft_ping}"
+CLI=ftpmtu_cli
+RTR=ftpmtu_rtr
+SRV=ftpmtu_srv
+SRV_IP=10.253.2.2
+
+pass=0
+fail=0
+
+netns_down() {
+  ip netns del "$CLI" 2>/dev/null
+  ip netns del "$RTR" 2>/dev/null
+  ip netns del "$SRV" 2>/dev/null
+}
+trap netns_down EXIT
+
+# Builds the three namespaces with MTU on the rtr-srv link
+netns_up() {
+  local mtu="$1"
+
+  netns_down
+  ip netns add "$CLI" && ip netns add "$RTR" && ip netns add "$SRV" || return 1
+  ip -n "$CLI" link add c0 type veth peer name r0 netns "$RTR" || return 1
+  ip -n "$RTR" link add r1 type veth peer name s0 netns "$SRV" || return 1
+  ip -n "$RTR" link set r1 mtu "$mtu" && ip -n "$SRV" link set s0 mtu "$mtu" || return 1
+
+  ip -n "$CLI" addr add 10.253.1.1/24 dev c0
+  ip -n "$RTR" addr add 10.253.1.2/24 dev r0
+  ip -n "$RTR" addr add 10.253.2.1/24 dev r1
+  ip -n "$SRV" addr add "$SRV_IP/24" dev s0
+  for ns in "$CLI" "$RTR" "$SRV"; do
+    ip -n "$ns" link set lo up
+  done
+  ip -n "$CLI" link set c0 up && ip -n "$RTR" link set r0 up
+  ip -n "$RTR" link set r1 up && ip -n "$SRV" link set s0 up
+  ip -n "$CLI" route add default via 10.253.1.2 || return 1
+  ip -n "$SRV" route add default via 10.253.2.1 || return 1
+  ip netns exec "$RTR" sysctl -qw net.ipv4.ip_forward=1 || return 1
+  # Lets --transport dgram open ICMP datagram sockets
+  ip netns exec "$CLI" sysctl -qw net.ipv4.ping_group_range="0 2147483647"
+}
+
+# rtr drops the Fragmentation Needed it sends back (ICMP type 3 code 4)
+blackhole() {
+  tc -n "$RTR" qdisc add dev r0 root handle 1: prio 2>/dev/null || return 1
+  tc -n "$RTR" filter add dev r0 parent 1: protocol ip u32 \
+    match ip protocol 1 0xff match u8 3 0xff at 20 match u8 4 0xff at 21 action drop 2>/dev/null
+}
+
+# Runs ft_ping --pmtu in cli with the rest of the arguments, expects WANT
+check() {
+  local desc="$1"; shift
+  local want="$1"; shift
+  local out
+
+  out=$(timeout 60 ip netns exec "$CLI" "$BIN" --pmtu "$@" "$SRV_IP" 2>&1)
+  if grep -q "path mtu to $SRV_IP: $want bytes" <<< "$out"; then
+    echo "[OK]   $desc"
+    ((pass++))
+  else
+    echo "[FAIL] $desc"
+    echo "       expected: path mtu $want"
+    echo "       out: $out"
+    ((fail++))
+  fi
+}
+
+if [[ ! -x "$BIN" ]]; then
+  echo "pmtu_netns: skipped (no binary: $BIN)"
+  exit 0
+fi
+if ! netns_up 1400; then
+  echo "pmtu_netns: skipped (cannot create network namespaces)"
+  exit 0
+fi
+
+check "Frag Needed from the router" 1400 -W 1
+netns_up 1400
+check "Frag Needed, datagram socket" 1400 -W 1 --transport dgram
+netns_up 1280
+check "IPv6 minimum on the far link" 1280 -W 1
+netns_up 9000
+check "interface MTU is the limit" 1500 -W 1
+netns_up 1400
+check "-s caps the sizes tried" 1000 -W 1 -s 972
+
+netns_up 1400
+if blackhole; then
+  check "black hole: timeouts only" 1400 -W 0.2
+else
+  echo "[SKIP] black hole (no tc prio/u32)"
+fi
+
+echo "pmtu_netns: $pass passed, $fail failed"
+(( fail == 0 ))
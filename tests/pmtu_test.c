@@ -0,0 +1,138 @@
+/*
+** Path MTU search checks: the range narrows to the exact path MTU for
+** every MTU from PMTU_MIN to 1500, whether routers send Fragmentation
+** Needed or drop what does not fit, in a few rounds either way, and a
+** target that answers nothing comes out as no MTU at all. Then whole runs
+** through the simulator: a router's next-hop MTU, a black hole with
+** timeouts only and sends larger than the interface failing with EMSGSIZE.
+*/
+#include "ft_ping.h"
+#include "test.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <netinet/ip_icmp.h>
+#include <sys/eventfd.h>
+
+enum { PATH_FRAG, PATH_BLACKHOLE, PATH_DEAD };
+
+static int g_quiet_fd = -1;
+
+/* Runs the search against a path of MTU `mtu` without any I/O; returns lo */
+static int search(int mtu, int kind, int *rounds) {
+    t_pmtu m;
+
+    pmtu_init(&m, 1500);
+    while (pmtu_plan(&m) > 0) {
+        for (int i = 0; i < m.nsizes; i++) {
+            if (kind != PATH_DEAD && m.sizes[i] <= mtu) {
+                m.verdicts[i] = PMTU_FITS;
+            } else if (kind == PATH_FRAG) {
+                m.verdicts[i] = PMTU_TOO_BIG;
+                m.next_mtus[i] = (uint16_t) mtu;
+            } else {
+                m.verdicts[i] = PMTU_LOST;
+            }
+        }
+        pmtu_update(&m);
+        if (m.rounds > 20)
+            break;
+    }
+    *rounds = m.rounds;
+    return m.lo;
+}
+
+/* Every MTU of the range; reports the first miss and the most rounds taken */
+static void sweep(const char *what, int kind, int max_rounds) {
+    char name[64];
+    int worst = 0;
+    int wrong = 0;
+
+    for (int mtu = PMTU_MIN; mtu <= 1500; mtu++) {
+        int rounds;
+        const int got = search(mtu, kind, &rounds);
+
+        if (rounds > worst)
+            worst = rounds;
+        if (got != mtu && !wrong) {
+            snprintf(name, sizeof(name), "%s: mtu %d", what, mtu);
+            check(name, got, mtu);
+            wrong = 1;
+        }
+    }
+    snprintf(name, sizeof(name), "%s: exact", what);
+    check(name, wrong, 0);
+    snprintf(name, sizeof(name), "%s: rounds", what);
+    check(name, worst <= max_rounds, 1);
+}
+
+/* One --pmtu run through a fresh simulated socket */
+static int run(const char *spec, int wait_ms) {
+    stats_thread_init();
+    g_stats = (t_stats){.hist = g_stats.hist};
+    g_targets[0].stats = (t_target_stats){.min = INT64_MAX};
+    g_targets[0].seq = 0;
+    g_targets[0].last_seq = 0;
+    for (int i = 0; i < ICMP_TYPES; i++)
+        g_icmp_errors[i] = 0;
+    probes_reset();
+    g_sim = (t_sim_conf){.seed = 1};
+    if (sim_configure(spec) != 0) {
+        printf("[FAIL] sim_configure(\"%s\")\n", spec);
+        g_fail++;
+        return -2;
+    }
+    flags.wait_ms = wait_ms;
+    should_stop = 0;
+
+    int id;
+    const int sock = transport_socket(0, &id);
+    const int mtu = pmtu_run(sock, id, g_quiet_fd);
+    close(sock);
+    return mtu;
+}
+
+int main(void) {
+    int rounds;
+
+    /* 1. Routers that say how much fits: usually found in the second round */
+    sweep("frag needed", PATH_FRAG, 3);
+    search(1400, PATH_FRAG, &rounds);
+    check("frag needed 1400: rounds", rounds, 2);
+
+    /* 2. Black holes: only the sizes that come back narrow it down */
+    sweep("black hole", PATH_BLACKHOLE, 5);
+
+    /* 3. Nothing ever answers */
+    check("dead: no mtu", search(1500, PATH_DEAD, &rounds), PMTU_MIN - 1);
+    check("dead: one round", rounds, 1);
+
+    /* 4. The whole loop through the simulator */
+    t_target *t = target_add("10.0.0.1");
+    t->addr.sin_family = AF_INET;
+    t->addr.sin_addr.s_addr = htonl(0x0A000001);
+    flags.transport = TRANSPORT_SIM;
+    flags.quiet = 1;
+    flags.ttl = 64;
+    flags.pmtu = 1;
+    flags.size_set = 1;
+    flags.payload_size = 1500 - 28;
+    /* Stands in for the signalfd: never readable */
+    g_quiet_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    check("sim: clean path", run("", 1000), 1500);
+    flags.payload_size = 1500 - 28;
+    check("sim: frag needed", run("mtu=1400,delay=1", 1000), 1400);
+    check("sim: icmp errors", g_icmp_errors[ICMP_DEST_UNREACH] > 0, 1);
+    flags.payload_size = 1500 - 28;
+    check("sim: black hole", run("mtu=1280,blackhole=1,delay=1", 50), 1280);
+    check("sim: timeouts", g_stats.timeouts > 0, 1);
+    check("sim: no errors", g_icmp_errors[ICMP_DEST_UNREACH], 0);
+    flags.payload_size = 9000 - 28;
+    check("sim: interface mtu", run("ifmtu=1500", 1000), 1500);
+    flags.payload_size = 1500 - 28;
+    check("sim: all lost", run("loss=100", 50), 0);
+
+    close(g_quiet_fd);
+    TEST_DONE("pmtu_test");
+}
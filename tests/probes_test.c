@@ -0,0 +1,47 @@
+/*
+** Probe ring checks: a reply is OK the first time and DUP after that, an
+** older sequence after a newer one is out of order, and probes older than
+** -W are expired by the sweep and reported as late if they still answer.
+*/
+#include "ft_ping.h"
+#include "test.h"
+
+#include <stdio.h>
+
+int main(void) {
+    const uint64_t ms = NS_PER_MS;
+
+    flags.wait_ms = 100;
+    target_add("127.0.0.1");
+    g_targets[0].addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    const struct in_addr src = g_targets[0].addr.sin_addr;
+    const struct in_addr other = {.s_addr = htonl(0x7f000002)};
+
+    for (uint16_t s = 0; s < 4; s++)
+        probe_track(s, 0, s, s * ms);
+
+    /* 1. Demux on (source, sequence) */
+    check("unknown seq", probe_lookup(9, src) != NULL, 0);
+    check("wrong source", probe_lookup(0, other) != NULL, 0);
+
+    /* 2. First reply, duplicate, then an older sequence after a newer one */
+    check("seq 1 ok", probe_reply(probe_lookup(1, src), 5 * ms), REPLY_OK);
+    check("seq 1 dup", probe_reply(probe_lookup(1, src), 6 * ms), REPLY_DUP);
+    check("seq 2 ok", probe_reply(probe_lookup(2, src), 7 * ms), REPLY_OK);
+    check("seq 0 reordered", probe_reply(probe_lookup(0, src), 8 * ms), REPLY_REORDERED);
+
+    /* 3. Seq 3 is still pending: the sweep expires it, the reply is late */
+    probes_expire(50 * ms);
+    check("not expired yet", g_stats.timeouts, 0);
+    probes_expire(200 * ms);
+    check("expired", g_stats.timeouts, 1);
+    check("seq 3 late", probe_reply(probe_lookup(3, src), 210 * ms), REPLY_LATE);
+
+    check("rx", g_stats.rx, 3);
+    check("dup", g_stats.dup, 1);
+    check("reorder", g_stats.reorder, 1);
+    check("late", g_stats.late, 1);
+    check("timeouts", g_stats.timeouts, 1);
+
+    TEST_DONE("probes_test");
+}
@@ -0,0 +1,118 @@
+/*
+** Structured output checks: the binary record layout stays fixed, records
+** read back from stdout carry what was passed in, and JSON Lines output
+** escapes target names and reads the same as the record fields.
+*/
+#include "ft_ping.h"
+#include "ft_records.h"
+#include "test.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+/* Runs `fn` with stdout going to a pipe; returns the bytes read back */
+static ssize_t capture(void (*fn)(void), char *buf, size_t len) {
+    int fds[2];
+    if (pipe(fds) < 0)
+        return -1;
+    const int saved = dup(STDOUT_FILENO);
+    dup2(fds[1], STDOUT_FILENO);
+    fn();
+    out_flush();
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    close(fds[1]);
+
+    ssize_t n = 0;
+    ssize_t r;
+    while ((r = read(fds[0], buf + n, len - (size_t) n)) > 0)
+        n += r;
+    close(fds[0]);
+    return n;
+}
+
+static t_probe g_probe = {.target = 0, .seq = 7};
+
+static void emit_events(void) {
+    const struct in_addr from = {.s_addr = htonl(0x0A000001)};
+
+    records_start();
+    record_reply(&g_probe, REPLY_OK, from, 63, 64, 1234567, -1, now_ns());
+    record_reply(&g_probe, REPLY_DUP, from, 63, 64, 2345678, -1, now_ns());
+    record_timeout(&g_probe, now_ns());
+    record_error(&g_probe, from, ICMP_DEST_UNREACH, 1, 0);
+    records_summary();
+}
+
+int main(void) {
+    /* 1. Layout: fields a reader indexes by offset */
+    check("record size", sizeof(t_record), REC_SIZE);
+    check("time_ns offset", offsetof(t_record, time_ns), 8);
+    check("probe.rtt_ns offset", offsetof(t_record, probe.rtt_ns), 16);
+    check("probe.addr offset", offsetof(t_record, probe.addr), 32);
+    check("summary.tx offset", offsetof(t_record, summary.tx), 16);
+    check("summary.rtt_min offset", offsetof(t_record, summary.rtt_min_ns), 48);
+
+    t_target *t = target_add("he said \"hi\"\n");
+    t->addr.sin_family = AF_INET;
+    t->addr.sin_addr.s_addr = htonl(0x0A000001);
+    stats_thread_init();
+    g_stats.tx = 3;
+    g_stats.rx = 1;
+    g_stats.dup = 1;
+    g_stats.errors = 1;
+    g_stats.min = g_stats.max = 1234567;
+    g_stats.mean = 1234567.0;
+
+    /* 2. Binary: a header and one fixed-size record per event */
+    static char buf[8192];
+    flags.format = FORMAT_BINARY;
+    ssize_t n = capture(emit_events, buf, sizeof(buf));
+    check("binary bytes", n, 6 * REC_SIZE);
+
+    const t_record *r = (const t_record *) buf;
+    check("start type", r[0].type, REC_START);
+    check("start magic", memcmp(r[0].start.magic, REC_MAGIC, 8), 0);
+    check("version", r[0].version, REC_VERSION);
+    check("reply rtt", r[1].probe.rtt_ns, 1234567);
+    check("reply seq", r[1].probe.seq, 7);
+    check("reply ttl", r[1].probe.ttl, 63);
+    check("duplicate type", r[2].type, REC_DUPLICATE);
+    check("timeout type", r[3].type, REC_TIMEOUT);
+    check("timeout rtt", r[3].probe.rtt_ns, -1);
+    check("error code", r[4].probe.icmp_code, 1);
+    check("summary target", r[5].target, REC_ALL);
+    check("summary tx", (long long) r[5].summary.tx, 3);
+    check("summary min", (long long) r[5].summary.rtt_min_ns, 1234567);
+    check("time order", r[1].time_ns >= r[0].time_ns, 1);
+
+    /* 3. JSON Lines: one object per event, the name escaped */
+    flags.format = FORMAT_JSONL;
+    n = capture(emit_events, buf, sizeof(buf) - 1);
+    buf[n > 0 ? n : 0] = '\0';
+
+    int lines = 0;
+    for (char *p = buf; *p; p++)
+        lines += *p == '\n';
+    check("jsonl lines", lines, 6);
+
+    char *reply = strstr(buf, "{\"type\":\"reply\"");
+    char *end = reply ? strchr(reply, '\n') : NULL;
+    if (end)
+        *end = '\0';
+    /* time_ns varies: compare what follows it */
+    const char *tail = reply ? strstr(reply, ",\"target\"") : NULL;
+    check_str("jsonl reply", tail ? tail : "",
+              ",\"target\":\"he said \\\"hi\\\"\\u000a\",\"addr\":\"10.0.0.1\",\"seq\":7,"
+              "\"bytes\":64,\"ttl\":63,\"rtt_ns\":1234567}");
+    if (end) {
+        const char *summary = strstr(end + 1, "{\"type\":\"summary\"");
+        check("jsonl summary rtt", summary && strstr(summary, "\"rtt_min_ns\":1234567,") != NULL, 1);
+        check("jsonl summary errors", summary && strstr(summary, "\"timeouts\":0,\"errors\":1,") != NULL, 1);
+    }
+
+    TEST_DONE("records_test");
+}
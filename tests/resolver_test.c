@@ -0,0 +1,242 @@
+/*
+** Background resolver checks, offline: names from /etc/hosts and numeric
+** addresses, a name that does not resolve, and a stub DNS server on
+** 127.0.0.1:53 (the resolv.conf nameserver) answering one name late and
+** another with a different address each time. A fast name must be ready
+** while the slow one is still out, resolver_poll() must never wait for an
+** answer, and a re-resolution must move the target to the new address.
+** The stub part is skipped when port 53 cannot be bound. First of all the
+** defaults parse_args() starts from must re-resolve names.
+*/
+#include "ft_ping.h"
+#include "test.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#define SLOW_MS 400
+
+/* --- Stub DNS server: A records for *.stub.test, NXDOMAIN for the rest --- */
+
+static int g_stub_fd = -1;
+static volatile int g_stub_stop = 0;
+static _Atomic int g_fast_queries = 0;
+static _Atomic int g_moving_queries = 0;
+
+typedef struct s_reply {
+    uint8_t            buf[512];
+    size_t             len;
+    struct sockaddr_in to;
+    uint64_t           due_ns;
+} t_reply;
+
+/* Reads the question name as "a.b.c"; returns the offset past QTYPE/QCLASS */
+static size_t read_qname(const uint8_t *q, size_t len, char *name, uint16_t *qtype) {
+    size_t off = 12;
+    size_t n = 0;
+
+    while (off < len && q[off] != 0) {
+        const size_t l = q[off++];
+        if (n)
+            name[n++] = '.';
+        for (size_t i = 0; i < l && off < len && n < 250; i++)
+            name[n++] = (char) q[off++];
+    }
+    name[n] = '\0';
+    *qtype = (uint16_t) (q[off + 1] << 8 | q[off + 2]);
+    return off + 5;
+}
+
+static void build_reply(t_reply *r, const uint8_t *q, size_t len) {
+    char name[256];
+    uint16_t qtype;
+    const size_t qend = read_qname(q, len, name, &qtype);
+    uint32_t addr = 0;
+
+    if (strcmp(name, "fast.stub.test") == 0) {
+        addr = 0x0A090001;
+        g_fast_queries++;
+    } else if (strcmp(name, "slow.stub.test") == 0) {
+        addr = 0x0A090002;
+        r->due_ns = now_ns() + SLOW_MS * 1000000ULL;
+    } else if (strcmp(name, "moving.stub.test") == 0) {
+        addr = g_moving_queries++ == 0 ? 0x0A090003 : 0x0A090004;
+    }
+
+    memcpy(r->buf, q, qend);
+    r->buf[2] = 0x81;                          /* QR, RD */
+    r->buf[3] = addr ? 0x80 : 0x83;            /* RA, NOERROR or NXDOMAIN */
+    r->buf[6] = 0;
+    r->buf[7] = addr && qtype == 1;            /* ANCOUNT */
+    memset(r->buf + 8, 0, 4);
+    r->len = qend;
+    if (r->buf[7]) {
+        const uint8_t answer[] = {0xC0, 0x0C, 0, 1, 0, 1, 0, 0, 0, 60, 0, 4,
+                                  addr >> 24, (addr >> 16) & 0xFF, (addr >> 8) & 0xFF, addr & 0xFF};
+        memcpy(r->buf + r->len, answer, sizeof(answer));
+        r->len += sizeof(answer);
+    }
+}
+
+static void *stub_main(void *arg) {
+    static t_reply late[16];
+    int nlate = 0;
+
+    (void) arg;
+    while (!g_stub_stop) {
+        struct pollfd pfd = {.fd = g_stub_fd, .events = POLLIN};
+        uint8_t q[512];
+        t_reply r = {0};
+        socklen_t alen = sizeof(r.to);
+
+        if (poll(&pfd, 1, 10) > 0) {
+            const ssize_t n = recvfrom(g_stub_fd, q, sizeof(q), 0, (struct sockaddr *) &r.to, &alen);
+            if (n > 12) {
+                build_reply(&r, q, (size_t) n);
+                if (r.due_ns && nlate < 16)
+                    late[nlate++] = r;
+                else
+                    sendto(g_stub_fd, r.buf, r.len, 0, (struct sockaddr *) &r.to, alen);
+            }
+        }
+        for (int i = 0; i < nlate; i++) {
+            if (now_ns() < late[i].due_ns)
+                continue;
+            sendto(g_stub_fd, late[i].buf, late[i].len, 0, (struct sockaddr *) &late[i].to,
+                   sizeof(late[i].to));
+            late[i--] = late[--nlate];
+        }
+    }
+    return NULL;
+}
+
+static int stub_start(pthread_t *thread) {
+    const struct sockaddr_in a = {.sin_family = AF_INET, .sin_port = htons(53),
+                                  .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+
+    g_stub_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (g_stub_fd < 0 || bind(g_stub_fd, (const struct sockaddr *) &a, sizeof(a)) < 0) {
+        perror("[SKIP] stub resolver: bind 127.0.0.1:53");
+        return -1;
+    }
+    return pthread_create(thread, NULL, stub_main, NULL) == 0 ? 0 : -1;
+}
+
+/* --- Driver --- */
+
+static int state(size_t i) {
+    return g_targets[i].state;
+}
+
+static uint32_t addr(size_t i) {
+    return ntohl(g_targets[i].addr.sin_addr.s_addr);
+}
+
+static uint64_t g_poll_max_ns = 0;
+
+/* Waits on resolver_fd() like the event loop, until `done` or `ms` pass */
+static void run(int ms, int (*done)(void)) {
+    const uint64_t end = now_ns() + (uint64_t) ms * 1000000ULL;
+
+    while (now_ns() < end && !(done && done())) {
+        struct pollfd pfd = {.fd = resolver_fd(), .events = POLLIN};
+        if (poll(&pfd, 1, 5) <= 0)
+            continue;
+        const uint64_t t0 = now_ns();
+        resolver_poll();
+        if (now_ns() - t0 > g_poll_max_ns)
+            g_poll_max_ns = now_ns() - t0;
+    }
+}
+
+static int g_stub = 0;
+
+static int fast_ready(void) {
+    return state(0) != TARGET_PENDING && (!g_stub || state(5) == TARGET_READY);
+}
+
+static int all_settled(void) {
+    for (size_t i = 0; i < g_ntargets; i++)
+        if (state(i) == TARGET_PENDING)
+            return 0;
+    return 1;
+}
+
+int main(void) {
+    pthread_t stub;
+    g_stub = stub_start(&stub) == 0;
+
+    /* 0. Names are re-resolved every RESOLVE_TTL_DEFAULT unless --resolve-ttl says otherwise */
+    char *plain[] = {"ft_ping", "127.0.0.1", NULL};
+    parse_args(2, plain);
+    check("default resolve ttl", flags.resolve_ttl_ns, RESOLVE_TTL_DEFAULT);
+    check("default resolve limit", flags.resolve_limit, RESOLVE_LIMIT_DEFAULT);
+    char *never[] = {"ft_ping", "--resolve-ttl", "0", "127.0.0.1", NULL};
+    parse_args(4, never);
+    check("resolve ttl 0 kept", flags.resolve_ttl_ns, 0);
+    g_ntargets = 0;
+
+    target_add("localhost");        /* 0: /etc/hosts */
+    target_add("10.1.2.3");         /* 1: numeric */
+    target_add("localhost");        /* 2: same name, one lookup */
+    target_add("nosuch.invalid");   /* 3: NXDOMAIN, or no server at all */
+    target_add("vm");               /* 4: /etc/hosts */
+    if (g_stub) {
+        target_add("fast.stub.test");    /* 5 */
+        target_add("fast.stub.test");    /* 6 */
+        target_add("slow.stub.test");    /* 7 */
+        target_add("moving.stub.test");  /* 8 */
+    }
+    flags.resolve_limit = 4;
+    flags.resolve_ttl_ns = g_stub ? 2 * SLOW_MS * 1000000LL : 0;
+
+    /* 1. Numeric addresses need no lookup; names start out pending */
+    const uint64_t t0 = now_ns();
+    resolver_start();
+    check("start does not wait", now_ns() - t0 < 50000000ULL, 1);
+    check("numeric ready", state(1), TARGET_READY);
+    check("numeric addr", addr(1), 0x0A010203);
+    check("name pending", state(0), TARGET_PENDING);
+
+    /* 2. Fast names resolve while the slow one is still being answered */
+    run(SLOW_MS / 2, fast_ready);
+    check("localhost ready", state(0), TARGET_READY);
+    check("localhost addr", addr(0), 0x7F000001);
+    check("duplicate name shares it", state(2) == TARGET_READY && addr(2) == addr(0), 1);
+    if (g_stub) {
+        check("fast ready", state(5), TARGET_READY);
+        check("fast addr", addr(5), 0x0A090001);
+        check("fast looked up once", g_fast_queries, 1);
+        check("both fast targets ready", state(6), TARGET_READY);
+        check("slow still pending", state(7), TARGET_PENDING);
+    }
+
+    /* 3. Everything settles; the unknown name is dropped */
+    run(4 * SLOW_MS, all_settled);
+    check("vm ready", state(4), TARGET_READY);
+    check("unknown name failed", state(3), TARGET_FAILED);
+    check("failed count", (long long) g_targets_failed, 1);
+    if (g_stub) {
+        check("slow ready", state(7), TARGET_READY);
+        check("slow addr", addr(7), 0x0A090002);
+        check("moving first addr", addr(8), 0x0A090003);
+
+        /* 4. After the TTL the names are looked up again in the background */
+        run(4 * SLOW_MS, NULL);
+        check("moving re-resolved", addr(8), 0x0A090004);
+        check("fast re-resolved", g_fast_queries >= 2, 1);
+        check("still ready", state(8), TARGET_READY);
+        check("poll never waits", g_poll_max_ns < 20000000ULL, 1);
+
+        g_stub_stop = 1;
+        pthread_join(stub, NULL);
+    }
+    if (g_stub_fd >= 0)
+        close(g_stub_fd);
+
+    TEST_DONE("resolver_test");
+}
@@ -0,0 +1,115 @@
+/*
+** Adaptive timeout checks: the estimator follows RFC 6298 on exact
+** samples and stays within RTO_MIN_NS and -W, a timeout doubles the RTO
+** once however many probes it took, and the deadline heap expires the
+** probes of a fast target before those of a slow one sent earlier, takes
+** answered probes out and tells the loops how long they may sleep.
+*/
+#include "ft_ping.h"
+#include "test.h"
+
+#include <stdio.h>
+
+#define MS(ms)  ((int64_t) (ms) * NS_PER_MS)
+
+int main(void) {
+    t_rto r = {0};
+
+    flags.wait_ms = 1000;
+    flags.rto = 1;
+    flags.quiet = 1;
+    target_add("10.0.0.1");
+    target_add("10.0.0.2");
+    g_targets[0].addr.sin_addr.s_addr = htonl(0x0A000001);
+    g_targets[1].addr.sin_addr.s_addr = htonl(0x0A000002);
+
+    /* 1. Before any sample a probe gets the whole -W */
+    check("no sample: -W", rto_get(&r), MS(1000));
+
+    /* 2. First sample: SRTT = R, RTTVAR = R/2, RTO = R + 4 R/2 */
+    rto_sample(&r, MS(40));
+    check("first: srtt", r.srtt, MS(40));
+    check("first: rttvar", r.rttvar, MS(20));
+    check("first: rto", rto_get(&r), MS(120));
+
+    /* 3. Then 7/8 and 3/4 smoothing */
+    rto_sample(&r, MS(48));
+    check("second: srtt", r.srtt, MS(41));
+    check("second: rttvar", r.rttvar, MS(17));
+    check("second: rto", rto_get(&r), MS(41) + 4 * MS(17));
+
+    /* 4. Steady samples shrink it down to the floor */
+    for (int i = 0; i < 200; i++)
+        rto_sample(&r, MS(2));
+    check("steady: srtt", r.srtt / 1000, MS(2) / 1000);
+    check("steady: floor", rto_get(&r), RTO_MIN_NS);
+
+    /* 5. A huge sample is capped at -W */
+    rto_sample(&r, MS(5000));
+    check("capped at -W", rto_get(&r), MS(1000));
+
+    /* 6. Backoff doubles the RTO the lost probe had, once */
+    t_rto b = {0};
+    rto_sample(&b, MS(10));
+    check("backoff: before", rto_get(&b), MS(30));
+    rto_backoff(&b, MS(30));
+    rto_backoff(&b, MS(30));
+    check("backoff: doubled once", rto_get(&b), MS(60));
+    rto_backoff(&b, MS(60));
+    check("backoff: again", rto_get(&b), MS(120));
+    rto_backoff(&b, MS(800));
+    check("backoff: capped at -W", rto_get(&b), MS(1000));
+    rto_sample(&b, MS(10));
+    check("sample after backoff", rto_get(&b) < MS(1000), 1);
+
+    /* 7. Without --rto it is -W whatever was sampled */
+    flags.rto = 0;
+    check("off: -W", rto_get(&b), MS(1000));
+    flags.rto = 1;
+
+    /* 8. Deadlines out of send order: a slow target sent first expires last */
+    g_targets[0].rto = (t_rto){0};
+    g_targets[1].rto = (t_rto){0};
+    rto_sample(&g_targets[0].rto, MS(200));   /* RTO 600 ms */
+    rto_sample(&g_targets[1].rto, MS(5));     /* RTO 15 ms */
+    probe_track(0, 0, 0, (uint64_t) MS(0));
+    probe_track(1, 1, 0, (uint64_t) MS(1));
+    probe_track(2, 1, 1, (uint64_t) MS(2));
+    probe_track(3, 1, 2, (uint64_t) MS(3));
+    check("until: fast target", probes_until((uint64_t) MS(1)), MS(15));
+    check("wait cut short", probes_wait_ms(-1, (uint64_t) MS(1)), 15);
+    check("shorter wait kept", probes_wait_ms(5, (uint64_t) MS(1)), 5);
+    check("rounded up", probes_wait_ms(-1, (uint64_t) MS(1) + 1), 15);
+
+    /* A reply takes its probe out of the heap */
+    check("seq 1 ok", probe_reply(probe_lookup(1, g_targets[1].addr.sin_addr), (uint64_t) MS(6)), REPLY_OK);
+    check("next deadline", probes_until((uint64_t) MS(6)), MS(11));
+
+    probes_expire((uint64_t) MS(20));
+    check("fast probes expired", g_stats.timeouts, 2);
+    check("slow probe pending", g_probes[0].state, PROBE_PENDING);
+    check("fast target backed off", rto_get(&g_targets[1].rto), MS(30));
+    check("until: slow target", probes_until((uint64_t) MS(20)), MS(580));
+    check("late reply", probe_reply(probe_lookup(3, g_targets[1].addr.sin_addr), (uint64_t) MS(25)),
+          REPLY_LATE);
+
+    /* 9. A reply after the deadline but before the sweep is late too */
+    check("late before sweep", probe_reply(probe_lookup(0, g_targets[0].addr.sin_addr), (uint64_t) MS(700)),
+          REPLY_LATE);
+    check("timeouts", g_stats.timeouts, 3);
+    check("late", g_stats.late, 2);
+    check("heap empty", probes_until((uint64_t) MS(700)), -1);
+    check("no deadline: wait kept", probes_wait_ms(-1, (uint64_t) MS(700)), -1);
+
+    /* 10. Many probes, answered in a scrambled order, leave nothing behind */
+    probes_reset();
+    for (uint16_t s = 0; s < 1000; s++)
+        probe_track(s, s % 2, s, (uint64_t) MS(1000) + s);
+    for (uint16_t s = 0; s < 1000; s++) {
+        const uint16_t seq = (uint16_t) (s * 7 % 1000);
+        probe_reply(probe_lookup(seq, g_targets[seq % 2].addr.sin_addr), (uint64_t) MS(1002));
+    }
+    check("scrambled: heap empty", probes_until((uint64_t) MS(1002)), -1);
+
+    TEST_DONE("rto_test");
+}
@@ -0,0 +1,192 @@
+/*
+** Simulator checks: the epoll loop floods a simulated network, no socket or
+** privileges needed. The same seed must lose and duplicate the same probes
+** every run, the odds must come out near what was asked, and delay,
+** duplicates and reordering must show up in the statistics as they would
+** from a real network. Injected ICMP errors are read straight from the
+** transport and must be well-formed errors quoting the probe.
+** Which replies overtake one another depends on when the loop reads them,
+** so the reorder count is only checked to be there.
+*/
+#include "ft_ping.h"
+#include "test.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/ip_icmp.h>
+#include <sys/eventfd.h>
+
+#define PROBES 10000
+
+static int g_quiet_fd = -1;
+
+static int configure(const char *spec) {
+    g_sim = (t_sim_conf){.seed = 1};
+    if (sim_configure(spec) == 0)
+        return 0;
+    printf("[FAIL] sim_configure(\"%s\")\n", spec);
+    g_fail++;
+    return -1;
+}
+
+/* One flood of `count` probes through a fresh simulated socket */
+static void run(const char *spec, long count) {
+    stats_thread_init();
+    g_stats = (t_stats){.hist = g_stats.hist};
+    g_targets[0].stats = (t_target_stats){.min = INT64_MAX};
+    g_targets[0].seq = 0;
+    g_targets[0].last_seq = 0;
+    probes_reset();
+    if (configure(spec) < 0)
+        return;
+    flags.count = count;
+    should_stop = 0;
+
+    int id;
+    const int sock = transport_socket(0, &id);
+    ping_loop(sock, id, g_quiet_fd);
+    close(sock);
+}
+
+/* Sends one echo request by hand and checks the error that comes back */
+static void error_reply(const char *spec, uint8_t type) {
+    if (configure(spec) < 0)
+        return;
+
+    int id;
+    const int sock = transport_socket(0, &id);
+    struct my_icmp_header req = {.type = ICMP_ECHO, .id = htons((uint16_t) id), .sequence = htons(7)};
+    char payload[56] = {0};
+    struct iovec out[2] = {{&req, sizeof(req)}, {payload, sizeof(payload)}};
+    struct mmsghdr msg = {.msg_hdr = {.msg_name = &g_targets[0].addr,
+                                      .msg_namelen = sizeof(g_targets[0].addr),
+                                      .msg_iov = out, .msg_iovlen = 2}};
+    check("error sent", g_transport->send(sock, &msg, 1), 1);
+
+    char buf[512];
+    struct sockaddr_in from;
+    struct iovec in = {buf, sizeof(buf)};
+    struct mmsghdr rmsg = {.msg_hdr = {.msg_name = &from, .msg_namelen = sizeof(from),
+                                       .msg_iov = &in, .msg_iovlen = 1}};
+    struct pollfd pfd = {.fd = sock, .events = POLLIN};
+    int got = -1;
+    for (int tries = 0; tries < 100 && got < 0; tries++) {
+        poll(&pfd, 1, 10);
+        got = g_transport->recv(sock, &rmsg, 1);
+    }
+    close(sock);
+    check("error received", got, 1);
+    if (got != 1)
+        return;
+
+    const struct ip *ip = (const struct ip *) buf;
+    const struct my_icmp_header *icmp = (const struct my_icmp_header *) (buf + ip->ip_hl * 4);
+    const size_t icmp_len = rmsg.msg_len - ip->ip_hl * 4;
+    const struct ip *orig = (const struct ip *) (icmp + 1);
+    const struct my_icmp_header *orig_icmp = (const struct my_icmp_header *) (orig + 1);
+
+    check("error type", icmp->type, type);
+    check("error checksum", csum_fold(csum_partial(icmp, icmp_len, 0)), 0);
+    check("error from a router", from.sin_addr.s_addr != g_targets[0].addr.sin_addr.s_addr, 1);
+    check("quotes the destination", orig->ip_dst.s_addr == g_targets[0].addr.sin_addr.s_addr, 1);
+    check("quotes the sequence", ntohs(orig_icmp->sequence), 7);
+}
+
+int main(void) {
+    t_target *t = target_add("10.0.0.1");
+    t->addr.sin_family = AF_INET;
+    t->addr.sin_addr.s_addr = htonl(0x0A000001);
+
+    flags.transport = TRANSPORT_SIM;
+    flags.quiet = 1;
+    flags.flood = 1;
+    flags.ttl = 64;
+    flags.payload_size = 56;
+    flags.wait_ms = 100;
+    flags.interval_ns = 0;
+    /* Stands in for the signalfd: never readable */
+    g_quiet_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    /* 1. A clean network answers everything */
+    run("", PROBES);
+    check("clean tx", g_stats.tx, PROBES);
+    check("clean rx", g_stats.rx, PROBES);
+    check("clean timeouts", g_stats.timeouts, 0);
+
+    /* 2. Odds near what was asked, and the same every run */
+    run("loss=10,dup=5,reorder=5,seed=42", PROBES);
+    const t_stats first = g_stats;
+    check("lossy tx", first.tx, PROBES);
+    check_range("lossy rx (~90%)", first.rx, PROBES * 87 / 100, PROBES * 93 / 100);
+    check_range("lossy dup (~5% of rx)", first.dup, first.rx * 3 / 100, first.rx * 7 / 100);
+    run("loss=10,dup=5,reorder=5,seed=42", PROBES);
+    check("same seed rx", g_stats.rx, first.rx);
+    check("same seed dup", g_stats.dup, first.dup);
+    run("loss=10,dup=5,reorder=5,seed=43", PROBES);
+    check("other seed differs", g_stats.rx != first.rx || g_stats.dup != first.dup, 1);
+
+    /* 3. Every reply duplicated; some held back past the next one */
+    run("dup=100", 1000);
+    check("dup=100 dups", g_stats.dup, g_stats.tx);
+    run("reorder=50", 1000);
+    check("reorder=50 seen", g_stats.reorder > 0, 1);
+    check("reorder=50 rx", g_stats.rx, 1000);
+
+    /* 4. Delay and jitter shape the RTT */
+    run("delay=2,jitter=1,dist=uniform", 200);
+    check("delay min >= 2 ms", g_stats.min >= 2000000, 1);
+    check_range("delay mean (2.5 ms), us", (long long) g_stats.mean / 1000, 2000, 6000);
+
+    /* 5. Injected errors answer instead of the target */
+    run("ttl=100", 50);
+    check("ttl=100 tx", g_stats.tx, 50);
+    check("ttl=100 rx", g_stats.rx, 0);
+    check("ttl=100 errors", g_stats.errors, 50);
+    check("ttl=100 not timed out", g_stats.timeouts, 0);
+    error_reply("ttl=100", ICMP_TIME_EXCEEDED);
+    error_reply("unreach=100", ICMP_DEST_UNREACH);
+
+    /* 5b. A send the interface refuses never left: nothing to time out */
+    run("ifmtu=68", 50);
+    check("refused tx", g_stats.tx, 0);
+    check("refused not timed out", g_stats.timeouts, 0);
+    check("refused not pending", probes_until(now_ns()) < 0, 1);
+
+    /* 5c. Faster than the ring per -W: sends wait for a wire sequence to free up */
+    flags.flood = 0;
+    flags.interval_ns = 1000;
+    flags.burst = IO_BATCH;
+    flags.wait_ms = 300;
+    const uint64_t full_start = now_ns();
+    run("loss=100", PROBE_MAP_SIZE + 1000);
+    check("full ring tx", g_stats.tx, PROBE_MAP_SIZE + 1000);
+    check_range("full ring waits for -W, ms", (long long) ((now_ns() - full_start) / NS_PER_MS), 300, 5000);
+    flags.burst = 0;
+
+    /* 6. Several targets with -c: the last of the round gets a whole interval too */
+    static const char *more[] = {"10.0.0.2", "10.0.0.3", "10.0.0.4", "10.0.0.5"};
+    for (uint32_t i = 0; i < 4; i++) {
+        t_target *m = target_add(more[i]);
+        m->addr.sin_family = AF_INET;
+        m->addr.sin_addr.s_addr = htonl(0x0A000002 + i);
+    }
+    flags.flood = 0;
+    flags.multi = 1;
+    flags.interval_ns = 100000000;
+    flags.wait_ms = 1000;
+    run("delay=30", 1);
+    check("multi -c 1 tx", g_stats.tx, 5);
+    check("multi -c 1 rx", g_stats.rx, 5);
+    check("multi last target rx", g_targets[4].stats.rx, 1);
+    check("multi timeouts", g_stats.timeouts, 0);
+
+    /* 7. Bad settings are refused */
+    check("unknown key", sim_configure("bogus=1"), -1);
+    check("loss above 100", sim_configure("loss=101"), -1);
+    check("no value", sim_configure("delay"), -1);
+
+    close(g_quiet_fd);
+    TEST_DONE("sim_test");
+}
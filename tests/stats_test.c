@@ -0,0 +1,89 @@
+/*
+** Statistics checks: Welford mdev on a large mean with a tiny spread (where
+** sq_sum/n - avg^2 cancels), histogram percentiles within bucket error and
+** within the exact extremes, and merging per-thread accumulators.
+*/
+#include "ft_ping.h"
+#include "libft/libft.h"
+#include "test.h"
+
+#include <math.h>
+#include <stdio.h>
+
+static void check_near(const char *what, double got, double want, double tol) {
+    const int ok = fabs(got - want) <= tol;
+    printf("[%s] %-28s got %.6f want %.6f (tol %.6f)\n", ok ? "OK" : "FAIL", what, got, want, tol);
+    if (!ok)
+        g_fail++;
+}
+
+static t_hist g_h;
+static t_hist g_ha, g_hb, g_hall;
+
+int main(void) {
+    /* 1. 3M samples of 1 s + {0,1,2} ns: mean 1 s + 1 ns, stddev sqrt(2/3) ns */
+    t_stats st = {0};
+    for (long i = 0; i < 3000000; i++) {
+        st.rx++;
+        update_stats(&st, 1000000000LL + i % 3);
+    }
+    check_near("welford mean", st.mean, 1000000001.0, 1e-3);
+    check_near("welford mdev", sqrt(st.m2 / (double) st.rx), sqrt(2.0 / 3.0), 1e-3);
+    check_near("min", (double) st.min, 1000000000.0, 0);
+    check_near("max", (double) st.max, 1000000002.0, 0);
+
+    /* 2. Uniform 1..1e6 ns: percentiles within the 1/64 bucket width */
+    t_stats hs = {.hist = &g_h};
+    for (long v = 1; v <= 1000000; v++) {
+        hs.rx++;
+        update_stats(&hs, v);
+    }
+    check_near("hist total", (double) g_h.total, 1000000.0, 0);
+    check_near("p50", (double) hist_percentile(&g_h, 0.50), 500000.0, 500000.0 / 64);
+    check_near("p90", (double) hist_percentile(&g_h, 0.90), 900000.0, 900000.0 / 64);
+    check_near("p99", (double) hist_percentile(&g_h, 0.99), 990000.0, 990000.0 / 64);
+    check_near("p99.9", (double) hist_percentile(&g_h, 0.999), 999000.0, 999000.0 / 64);
+
+    /* 3. Small values are exact, huge ones clamp into the last bucket */
+    t_hist small = {0};
+    hist_record(&small, 7);
+    check_near("exact below 128", (double) hist_percentile(&small, 0.5), 7.0, 0);
+    hist_record(&small, INT64_MAX);
+    hist_record(&small, INT64_MAX);
+    check_near("clamped max", (double) hist_percentile(&small, 1.0), (double) HIST_MAX_VALUE, HIST_MAX_VALUE / 64.0);
+
+    /* 4. Midpoints past the extremes (1020 for 1023, 1028 for 1025) are clamped to them */
+    t_stats narrow = {.hist = &g_ha};
+    for (long v = 1023; v <= 1025; v += 2) {
+        narrow.rx++;
+        update_stats(&narrow, v);
+    }
+    check_near("midpoint below min", (double) hist_percentile(narrow.hist, 0.0), 1020.0, 0);
+    check_near("p0 is min", (double) stats_percentile(&narrow, 0.0), 1023.0, 0);
+    check_near("p100 is max", (double) stats_percentile(&narrow, 1.0), 1025.0, 0);
+    ft_bzero(&g_ha, sizeof(g_ha));
+
+    /* 5. Two threads' accumulators merge into what one would have computed */
+    t_stats a = {.hist = &g_ha}, b = {.hist = &g_hb}, all = {.hist = &g_hall};
+    for (long v = 1; v <= 1000; v++) {
+        t_stats *half = v % 3 ? &a : &b;
+        const int64_t rtt = 50000 + v * v;
+        half->rx++;
+        update_stats(half, rtt);
+        all.rx++;
+        update_stats(&all, rtt);
+    }
+    t_stats merged = {.hist = &small};
+    ft_bzero(&small, sizeof(small));
+    stats_merge(&merged, &a);
+    stats_merge(&merged, &b);
+    check_near("merged rx", (double) merged.rx, (double) all.rx, 0);
+    check_near("merged min", (double) merged.min, (double) all.min, 0);
+    check_near("merged max", (double) merged.max, (double) all.max, 0);
+    check_near("merged mean", merged.mean, all.mean, 1e-6 * all.mean);
+    check_near("merged m2", merged.m2, all.m2, 1e-9 * all.m2);
+    check_near("merged p99", (double) hist_percentile(merged.hist, 0.99),
+          (double) hist_percentile(all.hist, 0.99), 0);
+
+    TEST_DONE("stats_test");
+}
@@ -0,0 +1,166 @@
+/*
+** Stats file checks: the epoll loop floods the simulator with losses and
+** ICMP errors while another thread maps the file and reads snapshots under
+** the seqlock as fast as it can. Every snapshot must be consistent (the
+** histogram holds exactly the replies, nothing received exceeds what was
+** sent, counters never go back) and the last must equal the final stats.
+*/
+#include "ft_ping.h"
+#include "ft_statsfile.h"
+#include "test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/ip_icmp.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+
+#define PROBES 30000
+
+static char g_path[] = "/tmp/ft_ping_statsfile_XXXXXX";
+static volatile int g_done = 0;
+
+typedef struct s_snap {
+    t_sf_block b;
+    uint64_t   hist_sum;
+} t_snap;
+
+/* The reader side of the protocol in ft_statsfile.h */
+static void snapshot(const t_sf_header *h, t_snap *s) {
+    const t_sf_block *b = (const t_sf_block *) ((const char *) h + h->header_size);
+    uint64_t seq;
+
+    do {
+        while ((seq = __atomic_load_n(&b->seq, __ATOMIC_ACQUIRE)) & 1)
+            ;
+        memcpy(&s->b, b, sizeof(s->b));
+        s->hist_sum = 0;
+        for (uint32_t i = 0; i < h->hist_buckets; i++)
+            s->hist_sum += b->hist[i];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&b->seq, __ATOMIC_RELAXED) != seq);
+}
+
+typedef struct s_reader {
+    long snapshots;
+    long distinct;
+    long torn;        /* snapshots whose fields disagree */
+    long backwards;   /* counters lower than in an earlier snapshot */
+} t_reader;
+
+static void *reader_main(void *arg) {
+    t_reader *r = arg;
+    const int fd = open(g_path, O_RDONLY);
+    t_snap s;
+    uint64_t last_seq = 0;
+    uint64_t last_tx = 0;
+
+    if (fd < 0)
+        return NULL;
+    const size_t len = (size_t) lseek(fd, 0, SEEK_END);
+    const t_sf_header *h = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (h == MAP_FAILED)
+        return NULL;
+
+    while (!g_done) {
+        snapshot(h, &s);
+        r->snapshots++;
+        if (s.b.seq == last_seq)
+            continue;
+        r->distinct++;
+        if (s.hist_sum != s.b.hist_total || s.b.hist_total != s.b.rx || s.b.rx > s.b.tx)
+            r->torn++;
+        if (s.b.tx < last_tx)
+            r->backwards++;
+        last_seq = s.b.seq;
+        last_tx = s.b.tx;
+    }
+    munmap((void *) h, len);
+    return NULL;
+}
+
+int main(void) {
+    const int tmp = mkstemp(g_path);
+    if (tmp < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(tmp);
+
+    t_target *t = target_add("10.0.0.1");
+    t->addr.sin_family = AF_INET;
+    t->addr.sin_addr.s_addr = htonl(0x0A000001);
+    flags.transport = TRANSPORT_SIM;
+    flags.quiet = 1;
+    flags.flood = 1;
+    flags.ttl = 64;
+    flags.payload_size = 56;
+    flags.wait_ms = 100;
+    flags.count = PROBES;
+    flags.stats_file = g_path;
+    sim_configure("loss=2,ttl=1,unreach=1,delay=0.02,jitter=0.02");
+
+    stats_thread_init();
+    statsfile_open();
+    statsfile_attach(0);
+
+    /* 1. The header describes the blocks */
+    const int fd = open(g_path, O_RDONLY);
+    t_sf_header h;
+    check("header read", read(fd, &h, sizeof(h)), sizeof(h));
+    close(fd);
+    check("magic", memcmp(h.magic, SF_MAGIC, sizeof(h.magic)), 0);
+    check("version", h.version, SF_VERSION);
+    check("one block", h.nblocks, 1);
+    check("hist buckets", h.hist_buckets, HIST_BUCKETS);
+    check("running", h.state, SF_RUNNING);
+    check("pid", h.pid, getpid());
+
+    /* 2. Snapshots while the loop runs are consistent */
+    t_reader r = {0};
+    pthread_t reader;
+    pthread_create(&reader, NULL, reader_main, &r);
+
+    int id;
+    const int sock = transport_socket(0, &id);
+    const int quiet_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ping_loop(sock, id, quiet_fd);
+    g_done = 1;
+    pthread_join(reader, NULL);
+    close(sock);
+    close(quiet_fd);
+
+    printf("reader: %ld snapshots, %ld distinct\n", r.snapshots, r.distinct);
+    check("several updates seen", r.distinct > 1, 1);
+    check("no torn snapshot", r.torn, 0);
+    check("never backwards", r.backwards, 0);
+
+    /* 3. The last snapshot is the final count */
+    const int fd2 = open(g_path, O_RDONLY);
+    const t_sf_header *m = mmap(NULL, sizeof(h) + h.block_size, PROT_READ, MAP_SHARED, fd2, 0);
+    close(fd2);
+    t_snap s;
+    snapshot(m, &s);
+    check("tx", (long long) s.b.tx, g_stats.tx);
+    check("rx", (long long) s.b.rx, g_stats.rx);
+    check("timeouts", (long long) s.b.timeouts, g_stats.timeouts);
+    check("min", s.b.min_ns, g_stats.min);
+    check("max", s.b.max_ns, g_stats.max);
+    check("hist total", (long long) s.b.hist_total, g_stats.rx);
+    check("time exceeded counted", s.b.errors[ICMP_TIME_EXCEEDED] > 0, 1);
+    check("unreachable counted", s.b.errors[ICMP_DEST_UNREACH] > 0, 1);
+    check("errors match", (long long) s.b.errors[ICMP_TIME_EXCEEDED], g_icmp_errors[ICMP_TIME_EXCEEDED]);
+
+    statsfile_close();
+    check("finished", m->state, SF_FINISHED);
+    munmap((void *) m, sizeof(h) + h.block_size);
+    unlink(g_path);
+
+    TEST_DONE("statsfile_test");
+}
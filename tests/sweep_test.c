@@ -0,0 +1,99 @@
+/*
+** TTL sweep checks, through the simulator: one burst maps every hop in
+** about one round trip, each router is found from the TTL its probe went
+** out with, later rounds stop at the target's hop, and the per-hop counts
+** and RTTs add up over several rounds. A target further away than the
+** sweep reaches, and hops that never answer, are reported as such.
+*/
+#include "ft_ping.h"
+#include "test.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/eventfd.h>
+
+#define MS(ms)  ((int64_t) (ms) * 1000000LL)
+
+static int g_quiet_fd = -1;
+
+/* One --sweep of `hops` TTLs, `rounds` rounds back to back, through a fresh simulated socket */
+static int run(const char *spec, int hops, int rounds, int wait_ms) {
+    stats_thread_init();
+    g_stats = (t_stats){.hist = g_stats.hist};
+    g_targets[0].stats = (t_target_stats){.min = INT64_MAX};
+    g_targets[0].seq = 0;
+    g_targets[0].last_seq = 0;
+    probes_reset();
+    g_sim = (t_sim_conf){.seed = 1};
+    if (sim_configure(spec) != 0) {
+        printf("[FAIL] sim_configure(\"%s\")\n", spec);
+        g_fail++;
+        return -1;
+    }
+    flags.sweep = hops;
+    flags.count = rounds;
+    flags.wait_ms = wait_ms;
+    should_stop = 0;
+
+    int id;
+    const int sock = transport_socket(0, &id);
+    const int reached = sweep_run(sock, id, g_quiet_fd);
+    close(sock);
+    return reached;
+}
+
+static uint32_t router(int ttl) {
+    return htonl(0xC0000200 + (uint32_t) ttl);   /* 192.0.2.TTL */
+}
+
+int main(void) {
+    t_target *t = target_add("10.0.0.1");
+    t->addr.sin_family = AF_INET;
+    t->addr.sin_addr.s_addr = htonl(0x0A000001);
+    flags.transport = TRANSPORT_SIM;
+    flags.quiet = 1;
+    flags.ttl = 64;
+    flags.payload_size = 56;
+    flags.interval_ns = 0;
+    /* Stands in for the signalfd: never readable */
+    g_quiet_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    /* 1. One round: every hop in one round trip, not one per TTL */
+    const uint64_t start = now_ns();
+    check("target hop", run("hops=5,delay=20", 8, 1, 1000), 5);
+    check_range("one round trip", (long long) (now_ns() - start), MS(20), MS(35));
+    check("probes sent", g_stats.tx, 8);
+    for (int ttl = 1; ttl < 5; ttl++) {
+        char name[32];
+
+        snprintf(name, sizeof(name), "hop %d router", ttl);
+        check(name, sweep_hop(ttl)->addr.s_addr, router(ttl));
+    }
+    check("hop 5 is the target", sweep_hop(5)->addr.s_addr, t->addr.sin_addr.s_addr);
+    check("hop 3 answered", sweep_hop(3)->stats.rx, 1);
+    check_range("hop 3 rtt", sweep_hop(3)->stats.min, MS(12), MS(18));
+    check("no timeouts", g_stats.timeouts, 0);
+
+    /* 2. Later rounds stop at the target's hop */
+    check("rounds: target hop", run("hops=5,delay=2", 8, 3, 1000), 5);
+    check("rounds: probes sent", g_stats.tx, 8 + 5 + 5);
+    check("rounds: hop 2 sent", sweep_hop(2)->stats.tx, 3);
+    check("rounds: hop 2 answered", sweep_hop(2)->stats.rx, 3);
+    check("rounds: hop 5 answered", sweep_hop(5)->stats.rx, 3);
+    check("rounds: one address", sweep_hop(2)->changes, 0);
+
+    /* 3. The target is further than the sweep goes */
+    check("unreached", run("hops=6,delay=2", 3, 2, 1000), 0);
+    check("unreached: hop 3 router", sweep_hop(3)->addr.s_addr, router(3));
+    check("unreached: hop 3 answered", sweep_hop(3)->stats.rx, 2);
+
+    /* 4. Nothing answers: every probe settles as a timeout */
+    check("silent path", run("hops=4,loss=100", 6, 2, 20), 0);
+    check("silent: hop 1 sent", sweep_hop(1)->stats.tx, 2);
+    check("silent: hop 1 answered", sweep_hop(1)->stats.rx, 0);
+    check("silent: timeouts", g_stats.timeouts, 12);
+
+    close(g_quiet_fd);
+    TEST_DONE("sweep_test");
+}
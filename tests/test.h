@@ -0,0 +1,64 @@
+/* tests/test.h */
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+** Unit test helpers
+** -----------------
+** Every test in tests/ is one program: each check prints an [OK] or [FAIL]
+** line and counts the failures, and TEST_DONE() ends main() with a
+** "<name>: OK" or "<name>: FAIL" line and the matching exit status, which
+** is what `make test` stops on. A check whose name starts with '-' prints
+** only when it fails, for checks run in a loop.
+*/
+
+static int g_fail = 0;
+
+static inline void check(const char *what, long long got, long long want) {
+    const int ok = got == want;
+
+    if (!ok || what[0] != '-')
+        printf("[%s] %-28s got %lld want %lld\n", ok ? "OK" : "FAIL", what, got, want);
+    if (!ok)
+        g_fail++;
+}
+
+static inline void check_range(const char *what, long long got, long long lo, long long hi) {
+    const int ok = got >= lo && got <= hi;
+
+    if (!ok || what[0] != '-')
+        printf("[%s] %-28s got %lld want %lld..%lld\n", ok ? "OK" : "FAIL", what, got, lo, hi);
+    if (!ok)
+        g_fail++;
+}
+
+static inline void check_str(const char *what, const char *got, const char *want) {
+    const int ok = strcmp(got, want) == 0;
+
+    if (!ok || what[0] != '-')
+        printf("[%s] %-28s got '%s' want '%s'\n", ok ? "OK" : "FAIL", what, got, want);
+    if (!ok)
+        g_fail++;
+}
+
+/* xorshift64: deterministic, so failures are reproducible */
+static inline uint64_t rnd(void) {
+    static uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+#define TEST_DONE(name)                                          \
+    do {                                                         \
+        printf("%s: %s\n", (name), g_fail ? "FAIL" : "OK");      \
+        return g_fail ? 1 : 0;                                   \
+    } while (0)
+
+#endif
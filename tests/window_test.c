@@ -0,0 +1,120 @@
+/*
+** Interval summary checks on a made-up clock: events land in the second
+** they happen in, a window adds up exactly the seconds it covers and drops
+** them once they are older, percentiles and jitter come out of the slots,
+** a long pause leaves nothing stale behind, and replies counted from
+** several threads at once all arrive.
+*/
+#include "ft_ping.h"
+#include "test.h"
+
+#include <stdio.h>
+#include <pthread.h>
+
+#define SEC(s)      ((uint64_t) (s) * NS_PER_SEC)
+#define MS(ms)      ((int64_t) (ms) * 1000000)
+#define T0          1000
+#define THREADS     4
+#define PER_THREAD  100000
+
+/* Within the ~1.6% the histogram buckets allow */
+static void check_near(const char *what, int64_t got, int64_t want) {
+    const int ok = got >= want - want / 64 && got <= want + want / 64;
+    printf("[%s] %-28s got %lld want ~%lld\n", ok ? "OK" : "FAIL", what, (long long) got,
+           (long long) want);
+    if (!ok)
+        g_fail++;
+}
+
+/* One second of the run, ended by the summary thread's tick */
+static void tick(uint64_t sec) {
+    window_advance(SEC(sec) + 1000);
+}
+
+static void *replier(void *arg) {
+    t_target *t = arg;
+
+    for (int i = 0; i < PER_THREAD; i++)
+        window_reply(t, MS(1) + i % 1000, SEC(T0 + 600) + 5);
+    return NULL;
+}
+
+int main(void) {
+    t_window_stats w;
+
+    target_add("10.0.0.1");
+    target_add("10.0.0.2");
+    flags.summary_s = 2;
+    flags.window_s = 3;
+    window_init(SEC(T0) + 500);
+
+    /* 1. Each second counts its own events */
+    window_sent(10, SEC(T0) + 1);
+    for (int i = 1; i <= 10; i++)
+        window_reply(&g_targets[0], MS(i), SEC(T0) + 2);
+    window_timeout(SEC(T0) + 3);
+    tick(T0 + 1);
+    window_sent(5, SEC(T0 + 1) + 1);
+    window_reply(&g_targets[1], MS(100), SEC(T0 + 1) + 2);
+    window_dup(SEC(T0 + 1) + 3);
+    tick(T0 + 2);
+
+    window_collect(SEC(T0 + 1), &w);
+    check("first second: seconds", w.seconds, 1);
+    check("first second: tx", w.tx, 10);
+    check("first second: rx", w.rx, 10);
+    check("first second: timeouts", w.timeouts, 1);
+    check("first second: min", w.rtt_min, MS(1));
+    check("first second: max", w.rtt_max, MS(10));
+    check("first second: avg", w.rtt_avg, 5500000);
+    check_near("first second: p50", w.rtt_p50, MS(5));
+    check_near("first second: p90", w.rtt_p90, MS(9));
+    check("jitter: 1 ms steps", w.jitter, MS(1));
+
+    window_collect(SEC(T0 + 2), &w);
+    check("two seconds: seconds", w.seconds, 2);
+    check("two seconds: tx", w.tx, 15);
+    check("two seconds: rx", w.rx, 11);
+    check("two seconds: dup", w.dup, 1);
+    check("two seconds: max", w.rtt_max, MS(100));
+    check("first reply of a target", w.jitter, MS(1));
+
+    /* 2. The window slides: after three more seconds only they are left */
+    for (uint64_t s = T0 + 2; s < T0 + 5; s++) {
+        window_sent(1, SEC(s) + 1);
+        window_reply(&g_targets[0], MS(20), SEC(s) + 2);
+        tick(s + 1);
+    }
+    window_collect(SEC(T0 + 5), &w);
+    check("slid: seconds", w.seconds, 3);
+    check("slid: tx", w.tx, 3);
+    check("slid: rx", w.rx, 3);
+    check("slid: timeouts", w.timeouts, 0);
+    check("slid: min", w.rtt_min, MS(20));
+    check("slid: p99 within max", w.rtt_p99, MS(20));
+    /* 10 ms then 20, 20, 20 for the first target */
+    check("slid: jitter", w.jitter, MS(10) / 3);
+
+    /* 3. A long pause wipes every slot on the way */
+    tick(T0 + 500);
+    window_collect(SEC(T0 + 500), &w);
+    check("after a pause: tx", w.tx, 0);
+    check("after a pause: rx", w.rx, 0);
+    check("after a pause: no jitter", w.jitter, -1);
+    check("after a pause: no rtt", w.rtt_min, 0);
+
+    /* 4. Replies from several threads at once are all counted */
+    tick(T0 + 600);
+    pthread_t threads[THREADS];
+    for (int k = 0; k < THREADS; k++)
+        pthread_create(&threads[k], NULL, replier, &g_targets[k % 2]);
+    for (int k = 0; k < THREADS; k++)
+        pthread_join(threads[k], NULL);
+    tick(T0 + 601);
+    window_collect(SEC(T0 + 601), &w);
+    check("threads: rx", w.rx, (long long) THREADS * PER_THREAD);
+    check("threads: min", w.rtt_min, MS(1));
+    check("threads: max", w.rtt_max, MS(1) + 999);
+
+    TEST_DONE("window_test");
+}